@@ -0,0 +1,99 @@
+#include "animation.h"
+
+#include <esp_timer.h>
+
+#include "log.h"
+
+// Letters used by the status screens
+#define GLYPH_A (SEG_A | SEG_B | SEG_C | SEG_E | SEG_F | SEG_G)
+#define GLYPH_P (SEG_A | SEG_B | SEG_E | SEG_F | SEG_G)
+#define GLYPH_E (SEG_A | SEG_D | SEG_E | SEG_F | SEG_G)
+#define GLYPH_r (SEG_E | SEG_G)
+#define GLYPH_t (SEG_D | SEG_E | SEG_F | SEG_G)
+#define GLYPH_c (SEG_D | SEG_E | SEG_G)
+#define GLYPH_n (SEG_C | SEG_E | SEG_G)
+
+// Keyframe tables (flash)
+static constexpr AnimationFrame CONNECTING_FRAMES[] = {
+  {{SEG_A, SEG_A, SEG_A, SEG_A}, 80},
+  {{SEG_B, SEG_B, SEG_B, SEG_B}, 80},
+  {{SEG_C, SEG_C, SEG_C, SEG_C}, 80},
+  {{SEG_D, SEG_D, SEG_D, SEG_D}, 80},
+  {{SEG_E, SEG_E, SEG_E, SEG_E}, 80},
+  {{SEG_F, SEG_F, SEG_F, SEG_F}, 80}
+};
+
+static constexpr AnimationFrame NTP_SYNC_FRAMES[] = {
+  {{SEG_G, 0, 0, 0}, 120},
+  {{0, SEG_G, 0, 0}, 120},
+  {{0, 0, SEG_G, 0}, 120},
+  {{0, 0, 0, SEG_G}, 120},
+  {{0, 0, SEG_G, 0}, 120},
+  {{0, SEG_G, 0, 0}, 120}
+};
+
+static constexpr AnimationFrame CONFIG_PORTAL_FRAMES[] = {
+  {{0, GLYPH_A, GLYPH_P, 0}, 700},
+  {{0, 0, 0, 0}, 300}
+};
+
+static constexpr AnimationFrame RTC_FAILURE_FRAMES[] = {
+  {{GLYPH_E, GLYPH_r, GLYPH_r, 0}, 800},
+  {{GLYPH_r, GLYPH_t, GLYPH_c, 0}, 800},
+  {{0, 0, 0, 0}, 200}
+};
+
+static constexpr AnimationFrame SYNC_ERROR_FRAMES[] = {
+  {{GLYPH_E, GLYPH_r, GLYPH_r, 0}, 800},
+  {{GLYPH_n, GLYPH_t, GLYPH_P, 0}, 800},
+  {{0, 0, 0, 0}, 200}
+};
+
+#define SEQUENCE(name, frames) {name, frames, sizeof(frames) / sizeof(frames[0])}
+
+// Indexed by AnimationId
+static constexpr AnimationSequence SEQUENCES[] = {
+  SEQUENCE("connecting", CONNECTING_FRAMES),
+  SEQUENCE("ntp_sync", NTP_SYNC_FRAMES),
+  SEQUENCE("config_portal", CONFIG_PORTAL_FRAMES),
+  SEQUENCE("rtc_failure", RTC_FAILURE_FRAMES),
+  SEQUENCE("sync_error", SYNC_ERROR_FRAMES)
+};
+
+static_assert(sizeof(SEQUENCES) / sizeof(SEQUENCES[0]) == ANIMATION_COUNT,
+              "one sequence per AnimationId");
+
+AnimationPlayer::AnimationPlayer()
+  : id(ANIMATION_CONNECTING), sequence(&SEQUENCES[ANIMATION_CONNECTING]), frameIndex(0), dueUs(0) {}
+
+void AnimationPlayer::play(AnimationId newId) {
+  if (newId == id || newId >= ANIMATION_COUNT) {
+    return;
+  }
+  id = newId;
+  sequence = &SEQUENCES[newId];
+  frameIndex = 0;
+  dueUs = 0;
+  LOGI("[Display] → Status animation: %s", sequence->name);
+}
+
+const uint8_t *AnimationPlayer::next(TickType_t &wait) {
+  int64_t nowUs = esp_timer_get_time();
+  const uint8_t *segments = NULL;
+  if (nowUs >= dueUs) {
+    const AnimationFrame &frame = sequence->frames[frameIndex];
+    segments = frame.segments;
+    // Keep the cadence from the previous due time unless we fell a frame behind
+    int64_t durationUs = (int64_t)frame.durationMs * 1000LL;
+    dueUs = (dueUs != 0 && nowUs - dueUs < durationUs) ? dueUs + durationUs : nowUs + durationUs;
+    frameIndex = (frameIndex + 1) % sequence->frameCount;
+  }
+
+  // Rounded up so the task never wakes just before the frame is due
+  uint32_t waitMs = (uint32_t)((dueUs - nowUs + 999) / 1000);
+  wait = pdMS_TO_TICKS(waitMs);
+  if (wait == 0) {
+    wait = 1;
+  }
+  return segments;
+}
@@ -0,0 +1,66 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <Arduino.h>
+
+#include "tm1637_frame.h"
+
+// Status animations for the display, driven from keyframe tables.
+//
+// Every sequence is a constexpr table of raw segment frames (one byte per
+// digit) with a duration per frame, so the tables live in flash and showing
+// a frame is a copy into the framebuffer. The player tells the caller how
+// long it may sleep until the next frame is due; nothing runs in between.
+
+// Segment bits, see tm1637_frame.h
+#define SEG_A 0x01
+#define SEG_B 0x02
+#define SEG_C 0x04
+#define SEG_D 0x08
+#define SEG_E 0x10
+#define SEG_F 0x20
+#define SEG_G 0x40
+#define SEG_COLON TM1637_COLON_BIT  // On the second digit
+
+// One keyframe: the four digits and how long they stay up
+struct AnimationFrame {
+  uint8_t segments[TM1637_DIGITS];
+  uint16_t durationMs;
+};
+
+struct AnimationSequence {
+  const char *name;
+  const AnimationFrame *frames;
+  uint8_t frameCount;
+};
+
+// Named sequences; loops until another one is played
+enum AnimationId {
+  ANIMATION_CONNECTING,     // Joining WiFi: segment running around each digit
+  ANIMATION_NTP_SYNC,       // Waiting for NTP: dash sweeping across
+  ANIMATION_CONFIG_PORTAL,  // Setup access point open: blinking "AP"
+  ANIMATION_RTC_FAILURE,    // DS1307 missing: "Err" / "rtc"
+  ANIMATION_SYNC_ERROR,     // NTP round failed: "Err" / "ntP"
+  ANIMATION_COUNT
+};
+
+class AnimationPlayer {
+public:
+  AnimationPlayer();
+
+  // Switch sequence; playing the current one again keeps its position
+  void play(AnimationId id);
+  AnimationId current() const { return id; }
+
+  // Returns the frame to show if one is due (NULL otherwise) and sets `wait`
+  // to the ticks until the next one
+  const uint8_t *next(TickType_t &wait);
+
+private:
+  AnimationId id;
+  const AnimationSequence *sequence;
+  uint8_t frameIndex;
+  int64_t dueUs;  // 0: show the current frame right away
+};
+
+#endif
@@ -0,0 +1,44 @@
+#include "bench.h"
+
+#ifdef CLOCK_BENCH
+
+#include <esp_timer.h>
+
+#include "bus_stats.h"
+#include "log.h"
+
+void benchBegin() {
+  logFlush();
+  Serial.printf("{\"bench_run\":{\"build\":\"%s %s\",\"cpu_mhz\":%u}}\n",
+                __DATE__, __TIME__, (unsigned)ESP.getCpuFreqMHz());
+}
+
+void benchRun(const char *name, uint32_t iterations, void (*fn)()) {
+  // One warm-up call so flash cache misses are not billed to the first iteration
+  fn();
+  logFlush();
+
+  // Counted by the allocator wrapper in bus_stats.cpp
+  uint32_t allocsBefore, bytesBefore;
+  busStatsAllocations(allocsBefore, bytesBefore);
+  int64_t startUs = esp_timer_get_time();
+
+  for (uint32_t i = 0; i < iterations; i++) {
+    fn();
+  }
+
+  int64_t elapsedUs = esp_timer_get_time() - startUs;
+  uint32_t allocs, bytes;
+  busStatsAllocations(allocs, bytes);
+  allocs -= allocsBefore;
+  bytes -= bytesBefore;
+
+  logFlush();
+  Serial.printf("{\"bench\":\"%s\",\"iterations\":%u,\"ns_per_call\":%llu,"
+                "\"allocs_per_call\":%.2f,\"alloc_bytes_per_call\":%.1f}\n",
+                name, (unsigned)iterations,
+                (unsigned long long)(elapsedUs * 1000 / iterations),
+                (float)allocs / iterations, (float)bytes / iterations);
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// On-target microbenchmarks, built only with -DCLOCK_BENCH (see the
+// esp32-s3-bench environment in platformio.ini).
+//
+// Each case prints one JSON object per line over serial so results from
+// different firmware builds can be diffed by a script.
+
+#ifdef CLOCK_BENCH
+
+#include <Arduino.h>
+
+// Print the run header (firmware build, CPU clock)
+void benchBegin();
+
+// Time `iterations` calls of fn and print the per-call cost and allocations
+void benchRun(const char *name, uint32_t iterations, void (*fn)());
+
+#endif
+
+#endif
@@ -0,0 +1,146 @@
+#include "boot_diag.h"
+
+#include <atomic>
+#include <esp_timer.h>
+#include <nvs_flash.h>
+
+#include "config_store.h"
+#include "log.h"
+
+static const char *const bootPhaseNames[BOOT_PHASE_COUNT] = {
+  "setup_start",
+  "display_task_started",
+  "hardware_ready",
+  "first_frame",
+  "wifi_connected",
+  "first_ntp_sync"
+};
+
+static std::atomic<uint32_t> bootPhases[BOOT_PHASE_COUNT];
+
+struct SystemDiagnostics {
+  const char *chipModel;
+  uint8_t cores;
+  uint32_t cpuMHz;
+  uint32_t flashMB;
+  uint32_t freeHeapKB;
+  bool psram;
+  uint32_t psramKB;
+  uint32_t psramFreeKB;
+  bool nvsStats;
+  nvs_stats_t nvs;
+};
+
+static SystemDiagnostics diagnostics;
+static std::atomic<bool> diagnosticsReady{false};
+static portMUX_TYPE collectLock = portMUX_INITIALIZER_UNLOCKED;
+static bool collecting = false;
+
+void bootMark(BootPhase phase) {
+  // Never store 0: it means "not reached"
+  uint32_t nowMs = (uint32_t)(esp_timer_get_time() / 1000) + 1;
+  uint32_t expected = 0;
+  bootPhases[phase].compare_exchange_strong(expected, nowMs, std::memory_order_relaxed);
+}
+
+uint32_t bootPhaseMs(BootPhase phase) {
+  uint32_t value = bootPhases[phase].load(std::memory_order_relaxed);
+  return value == 0 ? 0 : value - 1;
+}
+
+void bootDiagCollect() {
+  portENTER_CRITICAL(&collectLock);
+  bool alreadyCollecting = collecting;
+  collecting = true;
+  portEXIT_CRITICAL(&collectLock);
+  if (alreadyCollecting) {
+    return;
+  }
+
+  SystemDiagnostics &d = diagnostics;
+  d.chipModel = ESP.getChipModel();
+  d.cores = ESP.getChipCores();
+  d.cpuMHz = ESP.getCpuFreqMHz();
+  d.flashMB = ESP.getFlashChipSize() / 1024 / 1024;
+  d.freeHeapKB = ESP.getFreeHeap() / 1024;
+  d.psram = psramFound();
+  d.psramKB = d.psram ? ESP.getPsramSize() / 1024 : 0;
+  d.psramFreeKB = d.psram ? ESP.getFreePsram() / 1024 : 0;
+  d.nvsStats = nvs_get_stats(NULL, &d.nvs) == ESP_OK;
+  diagnosticsReady.store(true, std::memory_order_release);
+
+  // System Information
+  LOGI("[SYSTEM] Hardware Information:");
+  LOGI("  → Chip Model: %s", d.chipModel);
+  LOGI("  → CPU Cores: %u", (unsigned)d.cores);
+  LOGI("  → CPU Frequency: %u MHz", (unsigned)d.cpuMHz);
+  LOGI("  → Flash Size: %u MB", (unsigned)d.flashMB);
+  LOGI("  → Free Heap: %u KB", (unsigned)d.freeHeapKB);
+  if (d.psram) {
+    LOGI("  → PSRAM: %u KB (Free: %u KB)", (unsigned)d.psramKB, (unsigned)d.psramFreeKB);
+  } else {
+    LOGI("  → PSRAM: NOT FOUND");
+  }
+  if (d.nvsStats) {
+    LOGI("[NVS] → Used entries: %u / %u",
+         (unsigned)d.nvs.used_entries, (unsigned)d.nvs.total_entries);
+    LOGI("[NVS] → Free entries: %u", (unsigned)d.nvs.free_entries);
+    LOGI("[NVS] → Namespace count: %u", (unsigned)d.nvs.namespace_count);
+  }
+
+  LOGI("[BOOT] Phase timestamps (ms since reset):");
+  for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+    LOGI("  → %s: %lu", bootPhaseNames[i], (unsigned long)bootPhaseMs((BootPhase)i));
+  }
+}
+
+static void bootDiagTask(void *parameter) {
+  vTaskDelay(pdMS_TO_TICKS(BOOT_DIAG_DEFER_MS));
+  bootDiagCollect();
+  vTaskDelete(NULL);
+}
+
+void bootDiagCollectDeferred() {
+  xTaskCreate(bootDiagTask, "Diag Task", 3072, NULL, tskIDLE_PRIORITY, NULL);
+}
+
+size_t bootDiagToJson(char *buffer, size_t size) {
+  if (!diagnosticsReady.load(std::memory_order_acquire)) {
+    bootDiagCollect();
+  }
+  const SystemDiagnostics &d = diagnostics;
+
+  size_t length = snprintf(buffer, size,
+      "{\"chip\":\"%s\",\"cores\":%u,\"cpu_mhz\":%u,\"flash_mb\":%u,"
+      "\"free_heap_kb\":%u,\"psram_kb\":%u,\"psram_free_kb\":%u",
+      d.chipModel ? d.chipModel : "", (unsigned)d.cores, (unsigned)d.cpuMHz,
+      (unsigned)d.flashMB, (unsigned)(ESP.getFreeHeap() / 1024),
+      (unsigned)d.psramKB, (unsigned)(d.psram ? ESP.getFreePsram() / 1024 : 0));
+  if (d.nvsStats && length < size) {
+    length += snprintf(buffer + length, size - length,
+        ",\"nvs_used\":%u,\"nvs_free\":%u,\"nvs_total\":%u",
+        (unsigned)d.nvs.used_entries, (unsigned)d.nvs.free_entries,
+        (unsigned)d.nvs.total_entries);
+  }
+  // Live NVS wear figures from the settings store
+  ConfigStats config = configStats();
+  if (length < size) {
+    length += snprintf(buffer + length, size - length,
+        ",\"nvs_writes\":%lu,\"nvs_commits\":%lu,\"nvs_free_entries\":%u,"
+        "\"config_dirty\":%s",
+        (unsigned long)config.nvsWrites, (unsigned long)config.commits,
+        (unsigned)config.nvsFreeEntries, config.dirtyMask ? "true" : "false");
+  }
+  if (length < size) {
+    length += snprintf(buffer + length, size - length, ",\"boot_ms\":{");
+  }
+  for (int i = 0; i < BOOT_PHASE_COUNT && length < size; i++) {
+    length += snprintf(buffer + length, size - length, "%s\"%s\":%lu",
+                       i ? "," : "", bootPhaseNames[i],
+                       (unsigned long)bootPhaseMs((BootPhase)i));
+  }
+  if (length < size) {
+    length += snprintf(buffer + length, size - length, "}}");
+  }
+  return length < size ? length : size - 1;
+}
@@ -0,0 +1,47 @@
+#ifndef BOOT_DIAG_H
+#define BOOT_DIAG_H
+
+#include <Arduino.h>
+
+// Boot-phase timing and deferred hardware diagnostics.
+//
+// bootMark() records the first time each phase is reached, in milliseconds
+// since the esp_timer started (shortly after reset, before setup()). Chip,
+// PSRAM and NVS statistics are gathered off the boot path and reported on
+// demand.
+
+// Fast boot: no settle delays, display task first, diagnostics deferred.
+// Build with -DCLOCK_FAST_BOOT=0 for the old serial-friendly sequence.
+#ifndef CLOCK_FAST_BOOT
+#define CLOCK_FAST_BOOT 1
+#endif
+
+// Delay before the background task collects diagnostics
+#define BOOT_DIAG_DEFER_MS 3000
+
+enum BootPhase {
+  BOOT_SETUP_START,
+  BOOT_DISPLAY_TASK_STARTED,
+  BOOT_HARDWARE_READY,
+  BOOT_FIRST_FRAME,
+  BOOT_WIFI_CONNECTED,
+  BOOT_FIRST_NTP_SYNC,
+  BOOT_PHASE_COUNT
+};
+
+// Record a phase (only the first call per phase counts)
+void bootMark(BootPhase phase);
+
+// Milliseconds at which a phase was reached, 0 if not yet
+uint32_t bootPhaseMs(BootPhase phase);
+
+// Collect chip, PSRAM and NVS statistics now and log them
+void bootDiagCollect();
+
+// Collect them from a low-priority task once boot has settled
+void bootDiagCollectDeferred();
+
+// Write diagnostics and boot phases as JSON, collecting first if needed
+size_t bootDiagToJson(char *buffer, size_t size);
+
+#endif
@@ -0,0 +1,160 @@
+#include "bus_stats.h"
+
+#include <atomic>
+#include <esp_timer.h>
+
+#include "latency.h"
+#include "log.h"
+
+static std::atomic<uint32_t> i2cTransactions{0};
+static std::atomic<uint32_t> gpioCycles{0};
+static std::atomic<uint32_t> mutexTakes{0};
+static std::atomic<uint32_t> mutexContended{0};
+
+struct WaitStats {
+  std::atomic<uint32_t> count;
+  std::atomic<uint32_t> totalUs;
+  std::atomic<uint32_t> maxUs;
+};
+
+static WaitStats waits[BUS_WAIT_COUNT];
+static const char *const waitNames[BUS_WAIT_COUNT] = {
+  "mutex",
+  "time queue",
+  "display queue",
+  "frame late",
+  "frame render"
+};
+
+#if CLOCK_LATENCY
+static const LatencyProbe waitProbes[BUS_WAIT_COUNT] = {
+  LATENCY_MUTEX_WAIT,
+  LATENCY_TIME_QUEUE,
+  LATENCY_DISPLAY_QUEUE,
+  LATENCY_FRAME_LATE,
+  LATENCY_FRAME_RENDER
+};
+#endif
+
+static int64_t intervalStartUs = 0;
+static uint32_t intervalStartFreeHeap = 0;
+
+#if CLOCK_ALLOC_STATS
+static std::atomic<uint32_t> allocCount{0};
+static std::atomic<uint32_t> allocBytes{0};
+static uint32_t intervalStartAllocs = 0;
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+  allocCount.fetch_add(1, std::memory_order_relaxed);
+  allocBytes.fetch_add(size, std::memory_order_relaxed);
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  allocCount.fetch_add(1, std::memory_order_relaxed);
+  allocBytes.fetch_add(count * size, std::memory_order_relaxed);
+  return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  allocCount.fetch_add(1, std::memory_order_relaxed);
+  allocBytes.fetch_add(size, std::memory_order_relaxed);
+  return __real_realloc(ptr, size);
+}
+}
+#endif
+
+void busStatsCountI2c(uint32_t transactions) {
+  i2cTransactions.fetch_add(transactions, std::memory_order_relaxed);
+}
+
+void busStatsCountGpioCycles(uint32_t cycles) {
+  gpioCycles.fetch_add(cycles, std::memory_order_relaxed);
+}
+
+BaseType_t busStatsTakeMutex(SemaphoreHandle_t mutex, TickType_t timeout) {
+  // Fast path: uncontended take does not touch the timer
+  if (xSemaphoreTake(mutex, 0) == pdTRUE) {
+    mutexTakes.fetch_add(1, std::memory_order_relaxed);
+    LATENCY_RECORD(LATENCY_MUTEX_WAIT, 0);
+    return pdTRUE;
+  }
+
+  int64_t startUs = esp_timer_get_time();
+  BaseType_t taken = xSemaphoreTake(mutex, timeout);
+  uint32_t waitedUs = (uint32_t)(esp_timer_get_time() - startUs);
+
+  mutexTakes.fetch_add(1, std::memory_order_relaxed);
+  mutexContended.fetch_add(1, std::memory_order_relaxed);
+  busStatsRecordWait(BUS_WAIT_MUTEX, waitedUs);
+  return taken;
+}
+
+void busStatsRecordWait(BusWait kind, uint32_t waitedUs) {
+  WaitStats &stats = waits[kind];
+  stats.count.fetch_add(1, std::memory_order_relaxed);
+  stats.totalUs.fetch_add(waitedUs, std::memory_order_relaxed);
+  uint32_t maxUs = stats.maxUs.load(std::memory_order_relaxed);
+  while (waitedUs > maxUs &&
+         !stats.maxUs.compare_exchange_weak(maxUs, waitedUs, std::memory_order_relaxed)) {
+  }
+#if CLOCK_LATENCY
+  latencyRecord(waitProbes[kind], waitedUs);
+#endif
+}
+
+void busStatsAllocations(uint32_t &count, uint32_t &bytes) {
+#if CLOCK_ALLOC_STATS
+  count = allocCount.load(std::memory_order_relaxed);
+  bytes = allocBytes.load(std::memory_order_relaxed);
+#else
+  count = 0;
+  bytes = 0;
+#endif
+}
+
+void busStatsReport() {
+  int64_t nowUs = esp_timer_get_time();
+  uint32_t freeHeap = ESP.getFreeHeap();
+
+  uint32_t i2c = i2cTransactions.exchange(0, std::memory_order_relaxed);
+  uint32_t gpio = gpioCycles.exchange(0, std::memory_order_relaxed);
+  uint32_t takes = mutexTakes.exchange(0, std::memory_order_relaxed);
+  uint32_t contended = mutexContended.exchange(0, std::memory_order_relaxed);
+
+  // Scale to per-hour rates so reports taken at odd intervals stay comparable
+  float hours = (nowUs - intervalStartUs) / 3600e6f;
+  if (hours <= 0.0f) {
+    hours = 1.0f;
+  }
+
+  LOGI("[STATS] Bus traffic per hour:");
+  LOGI("[STATS] → I2C transactions: %u", (unsigned)(i2c / hours));
+  LOGI("[STATS] → TM1637 clock cycles: %u", (unsigned)(gpio / hours));
+  LOGI("[STATS] → Mutex takes: %u (contended: %u)",
+       (unsigned)(takes / hours), (unsigned)(contended / hours));
+  for (int kind = 0; kind < BUS_WAIT_COUNT; kind++) {
+    uint32_t count = waits[kind].count.exchange(0, std::memory_order_relaxed);
+    uint32_t totalUs = waits[kind].totalUs.exchange(0, std::memory_order_relaxed);
+    uint32_t maxUs = waits[kind].maxUs.exchange(0, std::memory_order_relaxed);
+    LOGI("[STATS] → Wait %s: %u (avg: %u us, max: %u us)", waitNames[kind],
+         (unsigned)(count / hours), (unsigned)(count ? totalUs / count : 0),
+         (unsigned)maxUs);
+  }
+  LOGI("[STATS] → Free heap: %u bytes (change: %d, largest block: %u)",
+       (unsigned)freeHeap, (int)(freeHeap - intervalStartFreeHeap),
+       (unsigned)ESP.getMaxAllocHeap());
+#if CLOCK_ALLOC_STATS
+  uint32_t allocs = allocCount.load(std::memory_order_relaxed);
+  LOGI("[STATS] → Allocations: %u", (unsigned)((allocs - intervalStartAllocs) / hours));
+  intervalStartAllocs = allocs;
+#endif
+
+  intervalStartUs = nowUs;
+  intervalStartFreeHeap = freeHeap;
+}
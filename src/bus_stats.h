@@ -0,0 +1,54 @@
+#ifndef BUS_STATS_H
+#define BUS_STATS_H
+
+#include <Arduino.h>
+
+// Traffic counters for the shared buses, locks and cross-task queues.
+//
+// Every counter is a relaxed atomic so both cores can bump them without
+// locking. busStatsReport() prints the rates over the interval since the
+// previous report and starts a new interval.
+//
+// Waits are recorded per kind as count, total and maximum, so a report shows
+// whether the display task on core 1 was ever held up: its frames should
+// start on the half-second edge no matter what the network side is doing.
+
+#define BUS_STATS_REPORT_INTERVAL_MS 3600000  // 1 hour
+
+// Heap allocation counting. Needs the link to wrap the allocator,
+// -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc, so every allocation,
+// including those made by String and the Arduino core, is counted; the bench
+// and native environments do.
+#ifndef CLOCK_ALLOC_STATS
+#ifdef CLOCK_BENCH
+#define CLOCK_ALLOC_STATS 1
+#else
+#define CLOCK_ALLOC_STATS 0
+#endif
+#endif
+
+enum BusWait {
+  BUS_WAIT_MUTEX,          // Blocked in busStatsTakeMutex()
+  BUS_WAIT_TIME_QUEUE,     // Time-service command, post to receive
+  BUS_WAIT_DISPLAY_QUEUE,  // Display command, push to pop
+  BUS_WAIT_FRAME_LATE,     // Display wake-up after its half-second edge
+  BUS_WAIT_FRAME_RENDER,   // Display frame, wake-up to flushed
+  BUS_WAIT_COUNT
+};
+
+void busStatsCountI2c(uint32_t transactions = 1);
+void busStatsCountGpioCycles(uint32_t cycles);
+
+// Take a FreeRTOS mutex and record how long the caller waited for it
+BaseType_t busStatsTakeMutex(SemaphoreHandle_t mutex, TickType_t timeout);
+
+// Record one wait of the given kind
+void busStatsRecordWait(BusWait kind, uint32_t waitedUs);
+
+// Allocations and bytes requested since boot; zero without CLOCK_ALLOC_STATS
+void busStatsAllocations(uint32_t &count, uint32_t &bytes);
+
+// Print counters accumulated since the previous report and reset them
+void busStatsReport();
+
+#endif
@@ -0,0 +1,295 @@
+#include "config_store.h"
+
+#include <nvs.h>
+#include <nvs_flash.h>
+
+#include "log.h"
+
+// NVS keys (at most 15 characters)
+#define CONFIG_KEY_SCHEMA "schema"
+#define CONFIG_KEY_TZ "tz"
+#define CONFIG_KEY_BRIGHTNESS "brightness"
+#define CONFIG_KEY_LOW_POWER "low_power"
+#define CONFIG_KEY_NIGHT_LEVEL "night_level"
+#define CONFIG_KEY_NIGHT_FROM "night_from"
+#define CONFIG_KEY_NIGHT_TO "night_to"
+#define CONFIG_KEY_WRITES "nvs_writes"
+#define CONFIG_KEY_RTC_UTC "rtc_utc"  // 0: RTC still on schema 1 local time
+#define CONFIG_KEY_LEGACY_TIMEZONE "timezone"  // Schema 1
+
+enum ConfigField {
+  CONFIG_FIELD_TZ,
+  CONFIG_FIELD_BRIGHTNESS,
+  CONFIG_FIELD_POWER,  // All four power keys
+  CONFIG_FIELD_RTC_UTC, // Migration flag, and the schema 1 key once done
+  CONFIG_FIELD_COUNT
+};
+
+// Settings and dirty state, shared by the setters (any task) and the writer
+static ClockConfig current = {CONFIG_DEFAULT_TZ, CONFIG_DEFAULT_BRIGHTNESS, CONFIG_DEFAULT_POWER};
+static uint32_t dirtyMask = 0;
+static uint32_t firstDirtyMs = 0;
+static uint32_t lastChangeMs = 0;
+static portMUX_TYPE configLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Writer state (configBegin, then the task calling configService)
+static uint16_t storedSchema = 0;
+static int32_t rtcLocalOffsetS = 0;  // Until the RTC is rewritten in UTC
+static uint32_t nvsWrites = 0;
+static uint32_t commits = 0;
+
+// Function to mark a field changed and restart the debounce
+static void markDirty(ConfigField field) {
+  uint32_t now = millis();
+  if (dirtyMask == 0) {
+    firstDirtyMs = now;
+  }
+  dirtyMask |= 1UL << field;
+  lastChangeMs = now;
+}
+
+uint16_t configBegin() {
+  nvs_handle_t handle;
+  if (nvs_open(CONFIG_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+    LOGE("[CONFIG] ✗ Failed to open NVS namespace, using defaults");
+    return 0;
+  }
+
+  uint16_t schema = 0;
+  if (nvs_get_u16(handle, CONFIG_KEY_SCHEMA, &schema) == ESP_OK) {
+    storedSchema = schema;
+  }
+  nvs_get_u32(handle, CONFIG_KEY_WRITES, &nvsWrites);
+
+  char tz[TZ_POSIX_MAX];
+  size_t length = sizeof(tz);
+  int32_t legacyHours = 0;
+  bool legacyFound = nvs_get_i32(handle, CONFIG_KEY_LEGACY_TIMEZONE, &legacyHours) == ESP_OK;
+  uint8_t rtcUtc = 1;
+  bool rtcFlagFound = nvs_get_u8(handle, CONFIG_KEY_RTC_UTC, &rtcUtc) == ESP_OK;
+  if (nvs_get_str(handle, CONFIG_KEY_TZ, tz, &length) == ESP_OK) {
+    // Written by schema 2, possibly before the schema key existed
+    if (schema == 0) {
+      schema = 2;
+    }
+    snprintf(current.tz, sizeof(current.tz), "%s", tz);
+    // A restart before the RTC was rewritten: the legacy key still holds
+    // the offset the RTC is in
+    if (rtcFlagFound && rtcUtc == 0 && legacyFound) {
+      rtcLocalOffsetS = legacyHours * 3600;
+      LOGW("[CONFIG] ⚠ RTC still on local time (UTC%+d), converting again", (int)legacyHours);
+    } else if (rtcFlagFound || legacyFound) {
+      dirtyMask |= 1UL << CONFIG_FIELD_RTC_UTC;
+    }
+  } else if (legacyFound) {
+    schema = 1;
+    tzFromUtcOffsetHours(legacyHours, current.tz, sizeof(current.tz));
+    rtcLocalOffsetS = legacyHours * 3600;
+    dirtyMask |= 1UL << CONFIG_FIELD_TZ | 1UL << CONFIG_FIELD_RTC_UTC;
+    LOGI("[CONFIG] ✓ Migrated timezone UTC%+d to %s", (int)legacyHours, current.tz);
+  }
+
+  uint8_t brightness;
+  if (nvs_get_u8(handle, CONFIG_KEY_BRIGHTNESS, &brightness) == ESP_OK) {
+    current.brightness = brightness > 7 ? 7 : brightness;
+  }
+
+  // Optional keys, added without a schema change: absent means the default
+  uint8_t value;
+  if (nvs_get_u8(handle, CONFIG_KEY_LOW_POWER, &value) == ESP_OK) {
+    current.power.lowPower = value != 0;
+  }
+  if (nvs_get_u8(handle, CONFIG_KEY_NIGHT_LEVEL, &value) == ESP_OK) {
+    current.power.nightLevel = value > 7 ? 7 : value;
+  }
+  if (nvs_get_u8(handle, CONFIG_KEY_NIGHT_FROM, &value) == ESP_OK) {
+    current.power.nightFrom = value % 24;
+  }
+  if (nvs_get_u8(handle, CONFIG_KEY_NIGHT_TO, &value) == ESP_OK) {
+    current.power.nightTo = value % 24;
+  }
+  nvs_close(handle);
+
+  LOGI("[CONFIG] ✓ Loaded schema %u: tz=%s brightness=%u low_power=%u (%lu NVS writes so far)",
+       (unsigned)schema, current.tz, (unsigned)current.brightness,
+       (unsigned)current.power.lowPower, (unsigned long)nvsWrites);
+
+  // Write the new layout and the migration flag right away; the legacy key
+  // stays until configRtcMigrated(), so a restart before the RTC has been
+  // rewritten converts it again instead of leaving it on local time
+  if (dirtyMask & (1UL << CONFIG_FIELD_RTC_UTC)) {
+    configFlush();
+  }
+  return schema;
+}
+
+int32_t configRtcLocalOffsetS() {
+  return rtcLocalOffsetS;
+}
+
+bool configRtcMigrated() {
+  rtcLocalOffsetS = 0;
+  portENTER_CRITICAL(&configLock);
+  markDirty(CONFIG_FIELD_RTC_UTC);
+  portEXIT_CRITICAL(&configLock);
+  return configFlush();
+}
+
+void configGet(ClockConfig &config) {
+  portENTER_CRITICAL(&configLock);
+  config = current;
+  portEXIT_CRITICAL(&configLock);
+}
+
+void configSetTimezone(const char *tz) {
+  portENTER_CRITICAL(&configLock);
+  if (strncmp(current.tz, tz, sizeof(current.tz)) != 0) {
+    snprintf(current.tz, sizeof(current.tz), "%s", tz);
+    markDirty(CONFIG_FIELD_TZ);
+  }
+  portEXIT_CRITICAL(&configLock);
+}
+
+void configSetBrightness(uint8_t level) {
+  if (level > 7) {
+    level = 7;
+  }
+  portENTER_CRITICAL(&configLock);
+  if (current.brightness != level) {
+    current.brightness = level;
+    markDirty(CONFIG_FIELD_BRIGHTNESS);
+  }
+  portEXIT_CRITICAL(&configLock);
+}
+
+void configSetPower(const PowerConfig &power) {
+  PowerConfig clamped = power;
+  clamped.nightLevel = clamped.nightLevel > 7 ? 7 : clamped.nightLevel;
+  clamped.nightFrom %= 24;
+  clamped.nightTo %= 24;
+  portENTER_CRITICAL(&configLock);
+  PowerConfig &stored = current.power;
+  if (stored.lowPower != clamped.lowPower || stored.nightLevel != clamped.nightLevel ||
+      stored.nightFrom != clamped.nightFrom || stored.nightTo != clamped.nightTo) {
+    stored = clamped;
+    markDirty(CONFIG_FIELD_POWER);
+  }
+  portEXIT_CRITICAL(&configLock);
+}
+
+void configService() {
+  portENTER_CRITICAL(&configLock);
+  uint32_t now = millis();
+  bool due = dirtyMask != 0 &&
+             (now - lastChangeMs >= CONFIG_COMMIT_DELAY_MS ||
+              now - firstDirtyMs >= CONFIG_COMMIT_MAX_DELAY_MS);
+  portEXIT_CRITICAL(&configLock);
+
+  if (due) {
+    configFlush();
+  }
+}
+
+bool configFlush() {
+  portENTER_CRITICAL(&configLock);
+  uint32_t dirty = dirtyMask;
+  ClockConfig snapshot = current;
+  dirtyMask = 0;
+  portEXIT_CRITICAL(&configLock);
+
+  if (dirty == 0) {
+    return true;
+  }
+
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(CONFIG_NAMESPACE, NVS_READWRITE, &handle);
+  bool opened = err == ESP_OK;
+  uint32_t keys = 0;
+  if (err == ESP_OK && (dirty & (1UL << CONFIG_FIELD_TZ))) {
+    err = nvs_set_str(handle, CONFIG_KEY_TZ, snapshot.tz);
+    keys++;
+  }
+  if (err == ESP_OK && (dirty & (1UL << CONFIG_FIELD_BRIGHTNESS))) {
+    err = nvs_set_u8(handle, CONFIG_KEY_BRIGHTNESS, snapshot.brightness);
+    keys++;
+  }
+  if (err == ESP_OK && (dirty & (1UL << CONFIG_FIELD_POWER))) {
+    const PowerConfig &power = snapshot.power;
+    err = nvs_set_u8(handle, CONFIG_KEY_LOW_POWER, power.lowPower ? 1 : 0);
+    if (err == ESP_OK) {
+      err = nvs_set_u8(handle, CONFIG_KEY_NIGHT_LEVEL, power.nightLevel);
+    }
+    if (err == ESP_OK) {
+      err = nvs_set_u8(handle, CONFIG_KEY_NIGHT_FROM, power.nightFrom);
+    }
+    if (err == ESP_OK) {
+      err = nvs_set_u8(handle, CONFIG_KEY_NIGHT_TO, power.nightTo);
+    }
+    keys += 4;
+  }
+  if (err == ESP_OK && storedSchema != CONFIG_SCHEMA_VERSION) {
+    err = nvs_set_u16(handle, CONFIG_KEY_SCHEMA, CONFIG_SCHEMA_VERSION);
+    keys++;
+  }
+  if (err == ESP_OK && (dirty & (1UL << CONFIG_FIELD_RTC_UTC))) {
+    if (rtcLocalOffsetS != 0) {
+      err = nvs_set_u8(handle, CONFIG_KEY_RTC_UTC, 0);
+      keys++;
+    } else {
+      // Either key may already be gone; only the RTC rewrite removes both
+      err = nvs_erase_key(handle, CONFIG_KEY_LEGACY_TIMEZONE);
+      if (err == ESP_OK || err == ESP_ERR_NVS_NOT_FOUND) {
+        err = nvs_erase_key(handle, CONFIG_KEY_RTC_UTC);
+      }
+      if (err == ESP_ERR_NVS_NOT_FOUND) {
+        err = ESP_OK;
+      }
+      keys += 2;
+    }
+  }
+  // The counter rides along in the same commit and counts itself
+  if (err == ESP_OK) {
+    err = nvs_set_u32(handle, CONFIG_KEY_WRITES, nvsWrites + keys + 1);
+  }
+  if (err == ESP_OK) {
+    err = nvs_commit(handle);
+  }
+  if (opened) {
+    nvs_close(handle);
+  }
+
+  if (err != ESP_OK) {
+    // Keep the fields dirty and restart the debounce, so configService()
+    // retries after CONFIG_COMMIT_DELAY_MS instead of on every call
+    portENTER_CRITICAL(&configLock);
+    dirtyMask |= dirty;
+    firstDirtyMs = lastChangeMs = millis();
+    portEXIT_CRITICAL(&configLock);
+    LOGE("[CONFIG] ✗ Commit failed with error: 0x%x", err);
+    return false;
+  }
+
+  nvsWrites += keys + 1;
+  commits++;
+  storedSchema = CONFIG_SCHEMA_VERSION;
+  LOGI("[CONFIG] ✓ Committed %lu keys (%lu NVS writes total)",
+       (unsigned long)(keys + 1), (unsigned long)nvsWrites);
+  return true;
+}
+
+ConfigStats configStats() {
+  ConfigStats stats = {};
+  stats.nvsWrites = nvsWrites;
+  stats.commits = commits;
+  portENTER_CRITICAL(&configLock);
+  stats.dirtyMask = dirtyMask;
+  portEXIT_CRITICAL(&configLock);
+
+  nvs_stats_t nvs;
+  if (nvs_get_stats(NULL, &nvs) == ESP_OK) {
+    stats.nvsUsedEntries = nvs.used_entries;
+    stats.nvsFreeEntries = nvs.free_entries;
+    stats.nvsTotalEntries = nvs.total_entries;
+  }
+  return stats;
+}
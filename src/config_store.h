@@ -0,0 +1,77 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <Arduino.h>
+#include "tz_engine.h"
+
+// Persistent settings, held in RAM and written back to NVS in batches.
+//
+// configBegin() reads every key once at boot (migrating older layouts) and
+// from then on reads are served from RAM. Setters only mark the changed field
+// dirty; configService() writes all dirty fields with a single nvs_commit()
+// once no setting has changed for CONFIG_COMMIT_DELAY_MS, so a burst of
+// changes costs one commit. Defaults are never written: a field reaches flash
+// only after it has been changed.
+
+// Layouts: 1 = whole-hour "timezone" int, 2 = POSIX "tz" string + schema key
+#define CONFIG_SCHEMA_VERSION 2
+
+#define CONFIG_NAMESPACE "clock"
+#define CONFIG_COMMIT_DELAY_MS 5000      // Quiet time before writing back
+#define CONFIG_COMMIT_MAX_DELAY_MS 30000 // Upper bound while changes keep coming
+
+#define CONFIG_DEFAULT_TZ "UTC0"
+#define CONFIG_DEFAULT_BRIGHTNESS 7
+#define CONFIG_DEFAULT_POWER {false, 1, 0, 0}  // Full power, no night window
+
+// Power-aware operation (see power.h)
+struct PowerConfig {
+  bool lowPower;       // Modem sleep between syncs and CPU frequency scaling
+  uint8_t nightLevel;  // Brightness cap inside the night window, 0-7
+  uint8_t nightFrom;   // Local hour the window starts, 0-23
+  uint8_t nightTo;     // Local hour it ends; equal to nightFrom: no window
+};
+
+struct ClockConfig {
+  char tz[TZ_POSIX_MAX];  // POSIX TZ string
+  uint8_t brightness;     // TM1637 level 0-7
+  PowerConfig power;
+};
+
+struct ConfigStats {
+  uint32_t nvsWrites;     // Keys written since the counter was created
+  uint32_t commits;       // Commits since boot
+  uint32_t dirtyMask;     // Fields waiting to be written
+  size_t nvsUsedEntries;
+  size_t nvsFreeEntries;
+  size_t nvsTotalEntries;
+};
+
+// Load all settings; returns the schema version found in flash (0 if none).
+// A layout older than CONFIG_SCHEMA_VERSION is converted and written at once.
+uint16_t configBegin();
+
+// UTC offset an RTC left on local time by schema 1 firmware still holds, 0
+// once it is in UTC. Kept in NVS (with the legacy key) until the rewrite.
+int32_t configRtcLocalOffsetS();
+
+// The RTC has been rewritten in UTC: drop the flag and the legacy key now
+bool configRtcMigrated();
+
+// Copy of the current settings
+void configGet(ClockConfig &config);
+
+// Change a setting in RAM; unchanged values do not mark the field dirty
+void configSetTimezone(const char *tz);
+void configSetBrightness(uint8_t level);
+void configSetPower(const PowerConfig &power);
+
+// Write dirty fields if the debounce has expired; call periodically
+void configService();
+
+// Write dirty fields now (e.g. before a restart)
+bool configFlush();
+
+ConfigStats configStats();
+
+#endif
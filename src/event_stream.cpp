@@ -0,0 +1,119 @@
+#include "event_stream.h"
+
+#include "bus_stats.h"
+#include "log.h"
+
+void EventStream::begin() {
+  mutex = xSemaphoreCreateMutex();
+}
+
+bool EventStream::add(AsyncClient *client) {
+  static const char header[] =
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Type: text/event-stream\r\n"
+      "Cache-Control: no-cache\r\n"
+      "Connection: keep-alive\r\n"
+      "Access-Control-Allow-Origin: *\r\n\r\n"
+      "retry: 3000\n\n";
+  static const char busy[] =
+      "HTTP/1.1 503 Service Unavailable\r\n"
+      "Retry-After: 10\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+  busStatsTakeMutex(mutex, portMAX_DELAY);
+  bool accepted = clientCount < EVENT_STREAM_MAX_CLIENTS;
+  if (accepted) {
+    subscribers[clientCount].client = client;
+    subscribers[clientCount].stalled = false;
+    clientCount++;
+  }
+  size_t active = clientCount;
+  xSemaphoreGive(mutex);
+
+  client->onDisconnect(onDisconnect, this);
+  client->onPoll(onPoll, this);
+  client->onData(NULL, NULL);
+  if (!accepted) {
+    LOGW("[SSE] ⚠ Subscriber limit reached (%u)", (unsigned)EVENT_STREAM_MAX_CLIENTS);
+    client->add(busy, sizeof(busy) - 1, ASYNC_WRITE_FLAG_COPY);
+    client->send();
+    client->close();
+    return false;
+  }
+
+  client->add(header, sizeof(header) - 1, ASYNC_WRITE_FLAG_COPY);
+  client->send();
+  LOGI("[SSE] → Subscriber added (%u active)", (unsigned)active);
+  return true;
+}
+
+void EventStream::broadcast(const char *event, const char *data) {
+  if (clientCount == 0) {
+    return;
+  }
+
+  // Format once, then the per-subscriber cost is a single socket write
+  char message[96];
+  int length = snprintf(message, sizeof(message), "event: %s\ndata: %s\n\n", event, data);
+  if (length <= 0 || length >= (int)sizeof(message)) {
+    return;
+  }
+
+  busStatsTakeMutex(mutex, portMAX_DELAY);
+  for (size_t i = 0; i < clientCount; i++) {
+    Subscriber &subscriber = subscribers[i];
+    if (subscriber.stalled) {
+      continue;
+    }
+    if (subscriber.client->space() < (size_t)length) {
+      // Too far behind to take another event
+      subscriber.stalled = true;
+    } else {
+      subscriber.client->add(message, length, ASYNC_WRITE_FLAG_COPY);
+      subscriber.client->send();
+    }
+  }
+  xSemaphoreGive(mutex);
+}
+
+void EventStream::onPoll(void *arg, AsyncClient *client) {
+  EventStream *stream = (EventStream *)arg;
+  if (stream->isStalled(client)) {
+    LOGW("[SSE] ⚠ Dropping stalled subscriber");
+    client->close();
+  }
+}
+
+void EventStream::onDisconnect(void *arg, AsyncClient *client) {
+  EventStream *stream = (EventStream *)arg;
+  if (stream->remove(client)) {
+    LOGI("[SSE] → Subscriber removed (%u active)", (unsigned)stream->clientCount);
+  }
+  delete client;
+}
+
+bool EventStream::isStalled(AsyncClient *client) {
+  bool stalled = false;
+  busStatsTakeMutex(mutex, portMAX_DELAY);
+  for (size_t i = 0; i < clientCount; i++) {
+    if (subscribers[i].client == client) {
+      stalled = subscribers[i].stalled;
+      break;
+    }
+  }
+  xSemaphoreGive(mutex);
+  return stalled;
+}
+
+bool EventStream::remove(AsyncClient *client) {
+  bool found = false;
+  busStatsTakeMutex(mutex, portMAX_DELAY);
+  for (size_t i = 0; i < clientCount; i++) {
+    if (subscribers[i].client == client) {
+      subscribers[i] = subscribers[--clientCount];
+      found = true;
+      break;
+    }
+  }
+  xSemaphoreGive(mutex);
+  return found;
+}
@@ -0,0 +1,51 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <Arduino.h>
+#include <AsyncTCP.h>
+
+// Server-Sent Events fan-out.
+//
+// An HTTP handler detaches its connection and hands the AsyncClient over;
+// the stream keeps it open and broadcast() writes one pre-formatted event to
+// every subscriber. Subscribers that have gone away or cannot keep up are
+// dropped. Subscriptions arrive on the AsyncTCP task while broadcasts come
+// from the WiFi task, so the subscriber list is guarded by a mutex; clients
+// are only ever closed and deleted on the AsyncTCP task.
+
+// Twenty open pages plus room for reconnects. Each subscriber holds a TCP
+// PCB on top of the HTTP connection pool, so lwIP must allow this many plus
+// HTTP_MAX_CONNECTIONS active PCBs (CONFIG_LWIP_MAX_ACTIVE_TCP).
+#define EVENT_STREAM_MAX_CLIENTS 24
+
+class EventStream {
+ public:
+  void begin();
+
+  // Send the SSE response header and subscribe the client.
+  // Returns false (and sends 503) when the stream is full.
+  bool add(AsyncClient *client);
+
+  // Write "event: <event>\ndata: <data>\n\n" to every subscriber
+  void broadcast(const char *event, const char *data);
+
+  // Number of live subscribers
+  size_t count() const { return clientCount; }
+
+ private:
+  struct Subscriber {
+    AsyncClient *client;
+    bool stalled;  // Missed an event; closed on the next poll
+  };
+
+  SemaphoreHandle_t mutex = NULL;
+  Subscriber subscribers[EVENT_STREAM_MAX_CLIENTS];
+  volatile size_t clientCount = 0;
+
+  static void onPoll(void *arg, AsyncClient *client);
+  static void onDisconnect(void *arg, AsyncClient *client);
+  bool isStalled(AsyncClient *client);
+  bool remove(AsyncClient *client);
+};
+
+#endif
@@ -0,0 +1,23 @@
+#include "frame_schedule.h"
+
+int64_t frameNextEdgeUs(int64_t nowUs) {
+  return nowUs - nowUs % FRAME_PERIOD_US + FRAME_PERIOD_US;
+}
+
+uint32_t frameWaitMs(int64_t nowUs, int64_t dueUs) {
+  if (dueUs <= nowUs) {
+    return 0;
+  }
+  return (uint32_t)((dueUs - nowUs + 999) / 1000);
+}
+
+int64_t frameRenderUs(int64_t nowUs, int64_t dueUs) {
+  if (dueUs != 0 && nowUs < dueUs && dueUs - nowUs <= FRAME_TICK_US) {
+    return dueUs;
+  }
+  return nowUs;
+}
+
+bool frameColonLit(int64_t clockUs) {
+  return clockUs % 1000000LL < 500000LL;
+}
@@ -0,0 +1,32 @@
+#ifndef FRAME_SCHEDULE_H
+#define FRAME_SCHEDULE_H
+
+#include <stdint.h>
+
+// When the display task draws the clock.
+//
+// Frames are due on every half-second edge of the in-memory clock: the colon
+// is lit for the first half of each second and the minute rolls over on a
+// whole-second edge. The task sleeps in whole RTOS ticks, and a tick-based
+// timeout can end up to one tick before the edge it was computed for, so a
+// wake-up that early is drawn as the edge itself instead of costing a second
+// wake-up one tick later. No Arduino dependency so tools/frame_schedule_sim.cpp
+// can build it.
+
+#define FRAME_PERIOD_US 500000LL
+#define FRAME_TICK_US 1000LL  // One RTOS tick (configTICK_RATE_HZ 1000)
+
+// The first edge strictly after `nowUs`
+int64_t frameNextEdgeUs(int64_t nowUs);
+
+// Whole milliseconds from `nowUs` to `dueUs`, rounded up
+uint32_t frameWaitMs(int64_t nowUs, int64_t dueUs);
+
+// Time to draw for: the edge the task slept until if it woke less than a tick
+// before it, otherwise `nowUs`; `dueUs` is 0 when woken early on purpose
+int64_t frameRenderUs(int64_t nowUs, int64_t dueUs);
+
+// Colon state for a clock time
+bool frameColonLit(int64_t clockUs);
+
+#endif
@@ -0,0 +1,492 @@
+#include "http_server.h"
+
+#include <ctype.h>
+#include <strings.h>
+
+#include "latency.h"
+#include "log.h"
+#include "power.h"
+
+struct HttpConnection {
+  AsyncClient *client;  // NULL while the slot is free
+  HttpServer *server;
+  char buffer[HTTP_REQUEST_BUFFER];
+  size_t length;
+  uint32_t requestStartMs;  // First byte of the request being received
+  uint32_t idleSinceMs;     // Last response completed
+  const uint8_t *pending;   // Static body not yet queued to TCP
+  size_t pendingLength;
+  bool *pendingInUse;       // Cleared when the pending body is released
+  bool closeWhenSent;
+};
+
+// Only touched from the AsyncTCP task
+static HttpConnection connectionPool[HTTP_MAX_CONNECTIONS];
+
+static const char *statusText(int code) {
+  switch (code) {
+    case 200: return "OK";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 408: return "Request Timeout";
+    case 413: return "Payload Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 503: return "Service Unavailable";
+    default: return "Internal Server Error";
+  }
+}
+
+// Drop the pending body: fully queued (copied), or the connection is gone
+static void releasePending(HttpConnection *c) {
+  if (c->pendingInUse) {
+    *c->pendingInUse = false;
+    c->pendingInUse = NULL;
+  }
+  c->pending = NULL;
+  c->pendingLength = 0;
+}
+
+// Queue as much of the pending static body as the send buffer takes
+static void queuePending(HttpConnection *c) {
+  size_t chunk = c->client->space();
+  if (chunk > c->pendingLength) {
+    chunk = c->pendingLength;
+  }
+  if (chunk > 0) {
+    c->client->add((const char *)c->pending, chunk, ASYNC_WRITE_FLAG_COPY);
+    c->client->send();
+    c->pending += chunk;
+    c->pendingLength -= chunk;
+  }
+  if (c->pendingLength == 0) {
+    releasePending(c);
+  }
+}
+
+// Queue the status line and headers; false if they do not fit, together
+// with a body of bodyRoom bytes that is to follow in the same buffer
+static bool queueHead(HttpConnection *c, int code, const char *contentType,
+                      size_t length, const char *headers, size_t bodyRoom) {
+  char head[320];
+  int headLength = snprintf(head, sizeof(head),
+      "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %u\r\n"
+      "Connection: %s\r\n%s\r\n",
+      code, statusText(code), contentType, (unsigned)length,
+      c->closeWhenSent ? "close" : "keep-alive", headers ? headers : "");
+  if (headLength <= 0 || headLength >= (int)sizeof(head) ||
+      c->client->space() < (size_t)headLength + bodyRoom) {
+    return false;
+  }
+  c->client->add(head, headLength, ASYNC_WRITE_FLAG_COPY);
+  return true;
+}
+
+static void closeConnection(HttpConnection *c) {
+  // The disconnect callback frees the slot, possibly before close() returns
+  c->client->close();
+}
+
+static void sendError(HttpConnection *c, int code) {
+  c->closeWhenSent = true;
+  const char *text = statusText(code);
+  if (queueHead(c, code, "text/plain", strlen(text), NULL, strlen(text))) {
+    c->client->add(text, strlen(text), ASYNC_WRITE_FLAG_COPY);
+    c->client->send();
+  }
+  closeConnection(c);
+}
+
+bool HttpRequest::arg(const char *name, char *value, size_t size) const {
+  size_t nameLength = strlen(name);
+  const char *p = params;
+  while (*p) {
+    const char *end = strchr(p, '&');
+    if (!end) {
+      end = p + strlen(p);
+    }
+    if ((size_t)(end - p) > nameLength && strncmp(p, name, nameLength) == 0 &&
+        p[nameLength] == '=') {
+      size_t out = 0;
+      for (const char *s = p + nameLength + 1; s < end && out + 1 < size; s++) {
+        if (*s == '+') {
+          value[out++] = ' ';
+        } else if (*s == '%' && end - s > 2 && isxdigit((unsigned char)s[1]) &&
+                   isxdigit((unsigned char)s[2])) {
+          char hex[3] = {s[1], s[2], 0};
+          value[out++] = (char)strtol(hex, NULL, 16);
+          s += 2;
+        } else {
+          value[out++] = *s;
+        }
+      }
+      value[out] = 0;
+      return true;
+    }
+    p = *end ? end + 1 : end;
+  }
+  return false;
+}
+
+bool HttpRequest::acceptsEncoding(const char *coding) const {
+  size_t codingLength = strlen(coding);
+  int wildcard = -1;  // -1: no "*" entry, else whether it allows any coding
+  const char *p = acceptEncoding;
+  while (*p) {
+    while (*p == ' ' || *p == ',') {
+      p++;
+    }
+    const char *name = p;
+    while (*p && *p != ',' && *p != ';' && *p != ' ') {
+      p++;
+    }
+    size_t nameLength = p - name;
+
+    // Only q=0 (or 0.0, 0.00, ...) refuses a coding
+    bool allowed = true;
+    const char *end = strchr(p, ',');
+    if (!end) {
+      end = p + strlen(p);
+    }
+    const char *q = strstr(p, "q=");
+    if (q && q < end) {
+      q += 2;
+      allowed = false;
+      for (; q < end && *q != ' ' && *q != ';'; q++) {
+        if (*q >= '1' && *q <= '9') {
+          allowed = true;
+        }
+      }
+    }
+    p = end;
+
+    if (nameLength == codingLength && strncasecmp(name, coding, codingLength) == 0) {
+      return allowed;
+    }
+    if (nameLength == 1 && *name == '*') {
+      wildcard = allowed;
+    }
+  }
+  return wildcard == 1;
+}
+
+void HttpRequest::send(int code, const char *contentType, const char *body,
+                       const char *headers) {
+  if (responded) {
+    return;
+  }
+  responded = true;
+  HttpConnection *c = connection;
+  size_t length = strlen(body);
+  if (!queueHead(c, code, contentType, length, headers, length)) {
+    // Larger responses go through sendBuffer() or sendStatic()
+    LOGW("[HTTP] ⚠ %u byte response does not fit the send buffer", (unsigned)length);
+    sendError(c, 500);
+    return;
+  }
+  if (length > 0) {
+    c->client->add(body, length, ASYNC_WRITE_FLAG_COPY);
+  }
+  c->client->send();
+}
+
+void HttpRequest::sendStatic(int code, const char *contentType, const uint8_t *body,
+                             size_t length, const char *headers) {
+  if (responded) {
+    return;
+  }
+  responded = true;
+  HttpConnection *c = connection;
+  if (!queueHead(c, code, contentType, length, headers, 0)) {
+    c->closeWhenSent = true;
+    return;
+  }
+  c->pending = body;
+  c->pendingLength = length;
+  queuePending(c);
+}
+
+void HttpRequest::sendBuffer(int code, const char *contentType, const char *body,
+                             size_t length, bool &inUse, const char *headers) {
+  if (responded) {
+    return;
+  }
+  inUse = true;
+  sendStatic(code, contentType, (const uint8_t *)body, length, headers);
+  HttpConnection *c = connection;
+  if (c->pending) {
+    c->pendingInUse = &inUse;
+  } else {
+    inUse = false;
+  }
+}
+
+AsyncClient *HttpRequest::detach() {
+  HttpConnection *c = connection;
+  AsyncClient *client = c->client;
+  responded = true;
+
+  client->onData(NULL, NULL);
+  client->onAck(NULL, NULL);
+  client->onPoll(NULL, NULL);
+  client->onDisconnect(NULL, NULL);
+  c->client = NULL;
+  c->length = 0;
+  return client;
+}
+
+HttpServer::HttpServer(uint16_t port) : listener(port) {
+}
+
+bool HttpServer::on(const char *path, HttpMethod method, Handler handler) {
+  if (routeCount >= HTTP_MAX_ROUTES) {
+    LOGE("[HTTP] ✗ Route table full, %s not registered", path);
+    return false;
+  }
+  routes[routeCount].path = path;
+  routes[routeCount].method = method;
+  routes[routeCount].handler = handler;
+  routeCount++;
+  return true;
+}
+
+void HttpServer::begin() {
+  listener.setNoDelay(true);
+  listener.onClient(onClient, this);
+  listener.begin();
+}
+
+size_t HttpServer::connections() const {
+  size_t count = 0;
+  for (size_t i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+    if (connectionPool[i].client) {
+      count++;
+    }
+  }
+  return count;
+}
+
+void HttpServer::onClient(void *arg, AsyncClient *client) {
+  HttpConnection *c = NULL;
+  for (size_t i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+    if (!connectionPool[i].client) {
+      c = &connectionPool[i];
+      break;
+    }
+  }
+
+  if (!c) {
+    // Pool exhausted: refuse politely and let AsyncTCP free the client
+    static const char busy[] =
+        "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 2\r\n"
+        "Content-Length: 0\r\nConnection: close\r\n\r\n";
+    client->onDisconnect([](void *, AsyncClient *c) { delete c; }, NULL);
+    client->add(busy, sizeof(busy) - 1, ASYNC_WRITE_FLAG_COPY);
+    client->send();
+    client->close();
+    return;
+  }
+
+  c->client = client;
+  c->server = (HttpServer *)arg;
+  c->length = 0;
+  c->requestStartMs = millis();
+  c->idleSinceMs = millis();
+  c->pending = NULL;
+  c->pendingLength = 0;
+  c->pendingInUse = NULL;
+  c->closeWhenSent = false;
+
+  client->setNoDelay(true);
+  client->onData(onData, c);
+  client->onAck(onAck, c);
+  client->onPoll(onPoll, c);
+  client->onDisconnect(onDisconnect, c);
+}
+
+void HttpServer::onData(void *arg, AsyncClient *client, void *data, size_t length) {
+  HttpConnection *c = (HttpConnection *)arg;
+  if (c->length == 0) {
+    c->requestStartMs = millis();
+    // Keep the radio out of modem sleep for the rest of the burst
+    powerHoldWifi(POWER_HTTP_HOLD_MS);
+  }
+  if (c->length + length >= HTTP_REQUEST_BUFFER) {
+    sendError(c, 431);
+    return;
+  }
+  memcpy(c->buffer + c->length, data, length);
+  c->length += length;
+  c->buffer[c->length] = 0;
+  c->server->process(c);
+}
+
+void HttpServer::onAck(void *arg, AsyncClient *client, size_t length, uint32_t time) {
+  HttpConnection *c = (HttpConnection *)arg;
+  if (!c->client) {
+    return;
+  }
+  if (c->pending) {
+    queuePending(c);
+  }
+  if (!c->pending) {
+    if (c->closeWhenSent) {
+      closeConnection(c);
+    } else if (c->length > 0) {
+      // Pipelined request waiting behind the finished response
+      c->server->process(c);
+    }
+  }
+}
+
+void HttpServer::onPoll(void *arg, AsyncClient *client) {
+  // lwIP polls every connection about twice a second
+  HttpConnection *c = (HttpConnection *)arg;
+  if (!c->client || c->pending) {
+    return;
+  }
+  uint32_t now = millis();
+  if (c->length > 0 && now - c->requestStartMs > HTTP_REQUEST_TIMEOUT_MS) {
+    sendError(c, 408);
+  } else if (c->length == 0 && now - c->idleSinceMs > HTTP_KEEPALIVE_TIMEOUT_MS) {
+    closeConnection(c);
+  }
+}
+
+void HttpServer::onDisconnect(void *arg, AsyncClient *client) {
+  HttpConnection *c = (HttpConnection *)arg;
+  c->client = NULL;
+  releasePending(c);
+  c->length = 0;
+  delete client;
+}
+
+void HttpServer::process(HttpConnection *c) {
+  // One response in flight at a time; the rest wait in the buffer
+  while (c->client && !c->pending && !c->closeWhenSent && c->length > 0) {
+    char *headerEnd = strstr(c->buffer, "\r\n\r\n");
+    if (!headerEnd) {
+      return;
+    }
+    char *body = headerEnd + 4;
+
+    // Make sure the whole body is here before the header is cut up in place
+    size_t contentLength = 0;
+    for (const char *h = strstr(c->buffer, "\r\n"); h && h < headerEnd; h = strstr(h + 2, "\r\n")) {
+      if (strncasecmp(h + 2, "Content-Length:", 15) == 0) {
+        contentLength = strtoul(h + 17, NULL, 10);
+      }
+    }
+    size_t requestLength = (body - c->buffer) + contentLength;
+    if (requestLength >= HTTP_REQUEST_BUFFER) {
+      sendError(c, 413);
+      return;
+    }
+    if (requestLength > c->length) {
+      return;
+    }
+
+    HttpRequest request;
+    request.connection = c;
+    request.responded = false;
+    request.ifNoneMatch = "";
+    request.acceptEncoding = "";
+
+    // Request line: METHOD SP target SP version
+    char *line = c->buffer;
+    char *lineEnd = strstr(line, "\r\n");
+    *lineEnd = 0;
+    char *target = strchr(line, ' ');
+    char *version = target ? strchr(target + 1, ' ') : NULL;
+    if (!target || !version) {
+      sendError(c, 400);
+      return;
+    }
+    *target++ = 0;
+    *version++ = 0;
+    if (strcmp(line, "GET") == 0) {
+      request.method = HTTP_METHOD_GET;
+    } else if (strcmp(line, "POST") == 0) {
+      request.method = HTTP_METHOD_POST;
+    } else {
+      sendError(c, 400);
+      return;
+    }
+    c->closeWhenSent = strcmp(version, "HTTP/1.1") != 0;
+
+    // Headers the server cares about
+    *headerEnd = 0;
+    for (char *h = lineEnd + 2; h < headerEnd;) {
+      char *next = strstr(h, "\r\n");
+      if (next) {
+        *next = 0;
+      }
+      char *value = strchr(h, ':');
+      if (value) {
+        *value++ = 0;
+        while (*value == ' ') {
+          value++;
+        }
+        if (strcasecmp(h, "If-None-Match") == 0) {
+          request.ifNoneMatch = value;
+        } else if (strcasecmp(h, "Accept-Encoding") == 0) {
+          request.acceptEncoding = value;
+        } else if (strcasecmp(h, "Connection") == 0) {
+          if (strcasecmp(value, "close") == 0) {
+            c->closeWhenSent = true;
+          } else if (strcasecmp(value, "keep-alive") == 0) {
+            c->closeWhenSent = false;
+          }
+        }
+      }
+      if (!next) {
+        break;
+      }
+      h = next + 2;
+    }
+
+    // Query string or form body; save the first byte of any pipelined request
+    char *query = strchr(target, '?');
+    if (query) {
+      *query++ = 0;
+      request.params = query;
+    } else {
+      request.params = body;
+    }
+    char saved = c->buffer[requestLength];
+    c->buffer[requestLength] = 0;
+    request.path = target;
+
+    dispatch(c, request);
+
+    if (!c->client) {
+      return;  // Detached or closed by the handler
+    }
+    c->buffer[requestLength] = saved;
+    c->length -= requestLength;
+    memmove(c->buffer, c->buffer + requestLength, c->length + 1);
+    c->requestStartMs = millis();
+    c->idleSinceMs = millis();
+
+    if (c->closeWhenSent && !c->pending) {
+      closeConnection(c);
+      return;
+    }
+  }
+}
+
+void HttpServer::dispatch(HttpConnection *c, HttpRequest &request) {
+  for (size_t i = 0; i < routeCount; i++) {
+    if (routes[i].method == request.method && strcmp(routes[i].path, request.path) == 0) {
+      {
+        LATENCY_SCOPE(LATENCY_HTTP_HANDLER);
+        routes[i].handler(request);
+      }
+      if (!request.responded) {
+        request.send(500, "text/plain", statusText(500));
+      }
+      return;
+    }
+  }
+  request.send(404, "text/plain", statusText(404));
+}
@@ -0,0 +1,110 @@
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include <Arduino.h>
+#include <AsyncTCP.h>
+#include <functional>
+
+// Event-driven HTTP/1.1 server on AsyncTCP.
+//
+// Runs entirely in the AsyncTCP task: connections are accepted, parsed and
+// answered from lwIP callbacks, so no application task polls for clients and
+// a slow client only holds its own slot. Connections come from a fixed pool
+// (no per-request heap), are kept alive between requests, and are closed if a
+// request does not arrive completely in time or the connection sits idle.
+//
+// Handlers must not block. Responses are one-shot: send() copies a small
+// dynamic body into the TCP send buffer (500 if it does not fit),
+// sendStatic() streams a body that stays valid forever (flash) as the client
+// acknowledges data, and sendBuffer() streams a handler's reusable buffer
+// the same way, flagging it busy until it has been copied.
+
+#define HTTP_MAX_CONNECTIONS 8
+#define HTTP_MAX_ROUTES 16
+#define HTTP_REQUEST_BUFFER 1536       // Request line, headers and form body
+#define HTTP_REQUEST_TIMEOUT_MS 5000   // First byte to complete request
+#define HTTP_KEEPALIVE_TIMEOUT_MS 15000
+
+enum HttpMethod {
+  HTTP_METHOD_GET,
+  HTTP_METHOD_POST
+};
+
+struct HttpConnection;
+
+class HttpRequest {
+ public:
+  HttpMethod method;
+  const char *path;
+  const char *params;       // Query string or form body, URL-encoded
+  const char *ifNoneMatch;  // "" when absent
+  const char *acceptEncoding; // "" when absent
+
+  // Look up a query/form parameter and URL-decode it into value
+  bool arg(const char *name, char *value, size_t size) const;
+
+  // Whether Accept-Encoding allows a content coding (listed or "*", q > 0)
+  bool acceptsEncoding(const char *coding) const;
+
+  // Respond with a body that is copied right away; it must fit the send
+  // buffer (CONFIG_TCP_SND_BUF_DEFAULT, 5744 bytes) with the headers
+  void send(int code, const char *contentType, const char *body,
+            const char *headers = NULL);
+
+  // Respond with a body that outlives the connection (e.g. in flash)
+  void sendStatic(int code, const char *contentType, const uint8_t *body,
+                  size_t length, const char *headers = NULL);
+
+  // Respond with a body in a buffer the handler reuses, streamed like
+  // sendStatic() when it is larger than the send buffer. inUse stays true
+  // until all of it has been queued or the connection is gone; the handler
+  // must not write to the buffer before then.
+  void sendBuffer(int code, const char *contentType, const char *body,
+                  size_t length, bool &inUse, const char *headers = NULL);
+
+  // Take the connection out of the server (e.g. for an event stream).
+  // The caller owns the client afterwards and must set its callbacks.
+  AsyncClient *detach();
+
+ private:
+  friend class HttpServer;
+  HttpConnection *connection;
+  bool responded;
+};
+
+class HttpServer {
+ public:
+  typedef std::function<void(HttpRequest &)> Handler;
+
+  explicit HttpServer(uint16_t port);
+
+  // Register a handler; call before begin()
+  bool on(const char *path, HttpMethod method, Handler handler);
+
+  void begin();
+
+  // Connections currently held by the server (not counting detached ones)
+  size_t connections() const;
+
+ private:
+  struct Route {
+    const char *path;
+    HttpMethod method;
+    Handler handler;
+  };
+
+  AsyncServer listener;
+  Route routes[HTTP_MAX_ROUTES];
+  size_t routeCount = 0;
+
+  static void onClient(void *arg, AsyncClient *client);
+  static void onData(void *arg, AsyncClient *client, void *data, size_t length);
+  static void onAck(void *arg, AsyncClient *client, size_t length, uint32_t time);
+  static void onPoll(void *arg, AsyncClient *client);
+  static void onDisconnect(void *arg, AsyncClient *client);
+
+  void process(HttpConnection *connection);
+  void dispatch(HttpConnection *connection, HttpRequest &request);
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "latency.h"
+
+#if CLOCK_LATENCY
+
+#include <atomic>
+
+#include "log.h"
+
+struct LatencyHistogram {
+  std::atomic<uint32_t> buckets[LATENCY_BUCKETS];
+  std::atomic<uint32_t> maxUs;
+};
+
+static LatencyHistogram histograms[LATENCY_PROBE_COUNT];
+
+static const char *const probeNames[LATENCY_PROBE_COUNT] = {
+  "display_push",
+  "display_wire",
+  "display_bank",
+  "rtc_read",
+  "rtc_write",
+  "ntp_rtt",
+  "ntp_serve",
+  "http_handler",
+  "mutex_wait",
+  "time_queue",
+  "display_queue",
+  "frame_late",
+  "frame_render"
+};
+
+// Function to map a latency to its log2 bucket
+static inline int bucketFor(uint32_t us) {
+  if (us < 2) {
+    return 0;
+  }
+  int bucket = 31 - __builtin_clz(us);
+  return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+void latencyRecord(LatencyProbe probe, uint32_t us) {
+  LatencyHistogram &h = histograms[probe];
+  h.buckets[bucketFor(us)].fetch_add(1, std::memory_order_relaxed);
+  uint32_t maxUs = h.maxUs.load(std::memory_order_relaxed);
+  while (us > maxUs &&
+         !h.maxUs.compare_exchange_weak(maxUs, us, std::memory_order_relaxed)) {
+  }
+}
+
+// Snapshot of one histogram with derived figures
+struct LatencySummary {
+  uint32_t buckets[LATENCY_BUCKETS];
+  uint32_t count;
+  uint32_t maxUs;
+  int first;  // Lowest non-empty bucket
+  int last;   // Highest non-empty bucket
+};
+
+static void summarize(LatencyProbe probe, LatencySummary &s) {
+  const LatencyHistogram &h = histograms[probe];
+  s.count = 0;
+  s.first = -1;
+  s.last = -1;
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    s.buckets[i] = h.buckets[i].load(std::memory_order_relaxed);
+    s.count += s.buckets[i];
+    if (s.buckets[i]) {
+      if (s.first < 0) {
+        s.first = i;
+      }
+      s.last = i;
+    }
+  }
+  s.maxUs = h.maxUs.load(std::memory_order_relaxed);
+}
+
+// Function to estimate a percentile as the upper edge of its bucket
+static uint32_t percentileUs(const LatencySummary &s, uint32_t permille) {
+  uint32_t rank = (uint32_t)(((uint64_t)s.count * permille + 999) / 1000);
+  uint32_t seen = 0;
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    seen += s.buckets[i];
+    if (seen >= rank) {
+      uint32_t upperUs = 2UL << i;
+      return upperUs < s.maxUs ? upperUs : s.maxUs;
+    }
+  }
+  return s.maxUs;
+}
+
+void latencyReport() {
+  LOGI("[LATENCY] Histograms since boot (log2 buckets, us):");
+  for (int probe = 0; probe < LATENCY_PROBE_COUNT; probe++) {
+    LatencySummary s;
+    summarize((LatencyProbe)probe, s);
+    if (s.count == 0) {
+      continue;
+    }
+    LOGI("[LATENCY] → %s: n=%lu p50<=%lu p90<=%lu p99<=%lu max=%lu",
+         probeNames[probe], (unsigned long)s.count,
+         (unsigned long)percentileUs(s, 500), (unsigned long)percentileUs(s, 900),
+         (unsigned long)percentileUs(s, 990), (unsigned long)s.maxUs);
+
+    char row[LATENCY_BUCKETS * 11];
+    size_t length = 0;
+    for (int i = s.first; i <= s.last && length < sizeof(row); i++) {
+      length += snprintf(row + length, sizeof(row) - length, " %lu", (unsigned long)s.buckets[i]);
+    }
+    LOGI("[LATENCY]   from %lu us:%s", (unsigned long)(s.first ? 1UL << s.first : 0), row);
+  }
+}
+
+size_t latencyToJson(char *buffer, size_t size) {
+  size_t length = snprintf(buffer, size, "{");
+  bool firstProbe = true;
+  for (int probe = 0; probe < LATENCY_PROBE_COUNT && length < size; probe++) {
+    LatencySummary s;
+    summarize((LatencyProbe)probe, s);
+    length += snprintf(buffer + length, size - length,
+        "%s\"%s\":{\"count\":%lu,\"p50_us\":%lu,\"p90_us\":%lu,\"p99_us\":%lu,"
+        "\"max_us\":%lu,\"buckets\":[",
+        firstProbe ? "" : ",", probeNames[probe], (unsigned long)s.count,
+        (unsigned long)percentileUs(s, 500), (unsigned long)percentileUs(s, 900),
+        (unsigned long)percentileUs(s, 990), (unsigned long)s.maxUs);
+    firstProbe = false;
+    // Trailing empty buckets are left out; index i is [2^i, 2^(i+1)) us
+    for (int i = 0; i <= s.last && length < size; i++) {
+      length += snprintf(buffer + length, size - length, i ? ",%lu" : "%lu",
+                         (unsigned long)s.buckets[i]);
+    }
+    if (length < size) {
+      length += snprintf(buffer + length, size - length, "]}");
+    }
+  }
+  if (length < size) {
+    length += snprintf(buffer + length, size - length, "}");
+  }
+  return length < size ? length : size - 1;
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <Arduino.h>
+
+// Latency histograms for the hot paths.
+//
+// Each probe has log2-scaled buckets in microseconds: bucket 0 holds 0-1 us,
+// bucket i holds [2^i, 2^(i+1)) us, and the last bucket everything from
+// ~8 s up. Recording is one relaxed atomic increment plus a max update, with
+// no allocation and no lock, so probes can sit in the display task and in
+// lwIP callbacks alike. Histograms accumulate from boot.
+//
+// Build with -DCLOCK_LATENCY=0 to compile every probe, the storage and the
+// report out of the image.
+
+#ifndef CLOCK_LATENCY
+#define CLOCK_LATENCY 1
+#endif
+
+#define LATENCY_BUCKETS 24
+
+enum LatencyProbe {
+  LATENCY_DISPLAY_PUSH,   // TM1637 frame push in displayTime()
+  LATENCY_DISPLAY_WIRE,   // TM1637 RMT transfer, start to end interrupt
+  LATENCY_DISPLAY_BANK,   // Lockstep flush of the extra displays, bus time
+  LATENCY_RTC_READ,       // One rtc.now() over I2C
+  LATENCY_RTC_WRITE,      // One rtc.adjust() over I2C
+  LATENCY_NTP_RTT,        // Round trip of each SNTP reply
+  LATENCY_NTP_SERVE,      // SNTP server, receive to transmit timestamp
+  LATENCY_HTTP_HANDLER,   // One HTTP route handler, including its send
+  LATENCY_MUTEX_WAIT,     // busStatsTakeMutex(), uncontended takes count as 0
+  LATENCY_TIME_QUEUE,     // Time-service command, post to receive
+  LATENCY_DISPLAY_QUEUE,  // Display command, push to pop
+  LATENCY_FRAME_LATE,     // Display wake-up after its half-second edge
+  LATENCY_FRAME_RENDER,   // Display frame, wake-up to flushed
+  LATENCY_PROBE_COUNT
+};
+
+#if CLOCK_LATENCY
+
+#include <esp_timer.h>
+
+// Add one sample
+void latencyRecord(LatencyProbe probe, uint32_t us);
+
+// Print count, percentiles and buckets of every probe that has samples
+void latencyReport();
+
+// Same as JSON: {"probe":{"count":n,"p50_us":..,"p99_us":..,"max_us":..,"buckets":[..]},..}
+size_t latencyToJson(char *buffer, size_t size);
+
+// Time the enclosing scope
+class LatencyScope {
+ public:
+  explicit LatencyScope(LatencyProbe probe) : probe(probe), startUs(esp_timer_get_time()) {}
+  ~LatencyScope() { latencyRecord(probe, (uint32_t)(esp_timer_get_time() - startUs)); }
+
+ private:
+  LatencyProbe probe;
+  int64_t startUs;
+};
+
+#define LATENCY_SCOPE(probe) LatencyScope latencyScope(probe)
+#define LATENCY_RECORD(probe, us) latencyRecord(probe, us)
+
+#else
+
+#define LATENCY_SCOPE(probe) do {} while (0)
+#define LATENCY_RECORD(probe, us) do {} while (0)
+
+#endif
+
+#endif
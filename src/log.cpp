@@ -0,0 +1,232 @@
+#include "log.h"
+
+#include <atomic>
+#include <stdarg.h>
+#include <esp_timer.h>
+
+#define LOG_TASK_STACK 3072
+#define LOG_TASK_PRIORITY tskIDLE_PRIORITY
+#define LOG_CORES 2
+
+// One record slot. `seq` implements a bounded multi-producer queue: a slot is
+// free for position p when seq == p, and holds a committed record when
+// seq == p + 1. Several tasks on the same core may log concurrently.
+struct LogRecord {
+  std::atomic<uint32_t> seq;
+  int64_t timestampUs;
+  uint16_t length;
+  char text[LOG_RECORD_SIZE];
+};
+
+struct LogRing {
+  LogRecord records[LOG_RING_RECORDS];
+  std::atomic<uint32_t> enqueuePos;
+  std::atomic<uint32_t> dequeuePos;  // Only advanced by the drain task
+};
+
+static LogRing rings[LOG_CORES];
+static std::atomic<uint32_t> droppedRecords{0};
+static std::atomic<bool> ringsInitialized{false};
+static portMUX_TYPE initLock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t drainTaskHandle = NULL;
+
+static void initRings() {
+  portENTER_CRITICAL(&initLock);
+  if (!ringsInitialized.load(std::memory_order_relaxed)) {
+    for (int core = 0; core < LOG_CORES; core++) {
+      for (uint32_t i = 0; i < LOG_RING_RECORDS; i++) {
+        rings[core].records[i].seq.store(i, std::memory_order_relaxed);
+      }
+      rings[core].enqueuePos.store(0, std::memory_order_relaxed);
+      rings[core].dequeuePos.store(0, std::memory_order_relaxed);
+    }
+    ringsInitialized.store(true, std::memory_order_release);
+  }
+  portEXIT_CRITICAL(&initLock);
+}
+
+// Claim a slot in the current core's ring without locking.
+// Returns NULL (and counts a drop) if the ring is full.
+static LogRecord *claimRecord(uint32_t &pos) {
+  if (!ringsInitialized.load(std::memory_order_acquire)) {
+    initRings();
+  }
+
+  LogRing &ring = rings[xPortGetCoreID() % LOG_CORES];
+  pos = ring.enqueuePos.load(std::memory_order_relaxed);
+  while (true) {
+    LogRecord *record = &ring.records[pos & (LOG_RING_RECORDS - 1)];
+    uint32_t seq = record->seq.load(std::memory_order_acquire);
+    int32_t diff = (int32_t)(seq - pos);
+    if (diff == 0) {
+      if (ring.enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        return record;
+      }
+    } else if (diff < 0) {
+      droppedRecords.fetch_add(1, std::memory_order_relaxed);
+      return NULL;
+    } else {
+      pos = ring.enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+// Publish a claimed slot to the drain task
+static void commitRecord(LogRecord *record, uint32_t pos, int length) {
+  if (length < 0) {
+    length = 0;
+  } else if (length >= LOG_RECORD_SIZE) {
+    length = LOG_RECORD_SIZE - 1;
+  }
+  record->length = (uint16_t)length;
+  record->timestampUs = esp_timer_get_time();
+  record->seq.store(pos + 1, std::memory_order_release);
+
+  if (drainTaskHandle != NULL) {
+    xTaskNotifyGive(drainTaskHandle);
+  }
+}
+
+void logWrite(const char *format, ...) {
+  uint32_t pos;
+  LogRecord *record = claimRecord(pos);
+  if (record == NULL) {
+    return;
+  }
+
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(record->text, LOG_RECORD_SIZE, format, args);
+  va_end(args);
+  commitRecord(record, pos, length);
+}
+
+void logWriteRaw(const char *text, size_t length) {
+  uint32_t pos;
+  LogRecord *record = claimRecord(pos);
+  if (record == NULL) {
+    return;
+  }
+
+  if (length >= LOG_RECORD_SIZE) {
+    length = LOG_RECORD_SIZE - 1;
+  }
+  memcpy(record->text, text, length);
+  commitRecord(record, pos, (int)length);
+}
+
+#if CLOCK_LOG_COMPACT
+size_t logBeginToken(char *buffer, uint32_t token) {
+  return snprintf(buffer, LOG_RECORD_SIZE, "~%08x", (unsigned)token);
+}
+
+// Each encoder appends " <value>" and silently truncates at the record size
+void logAppendArg(char *buffer, size_t &length, long long value) {
+  if (length < LOG_RECORD_SIZE) {
+    length += snprintf(buffer + length, LOG_RECORD_SIZE - length, " %lld", value);
+  }
+}
+
+void logAppendArg(char *buffer, size_t &length, unsigned long long value) {
+  if (length < LOG_RECORD_SIZE) {
+    length += snprintf(buffer + length, LOG_RECORD_SIZE - length, " %llu", value);
+  }
+}
+
+void logAppendArg(char *buffer, size_t &length, double value) {
+  if (length < LOG_RECORD_SIZE) {
+    length += snprintf(buffer + length, LOG_RECORD_SIZE - length, " %g", value);
+  }
+}
+
+void logAppendArg(char *buffer, size_t &length, const char *value) {
+  if (length + 3 >= LOG_RECORD_SIZE) {
+    return;
+  }
+  buffer[length++] = ' ';
+  buffer[length++] = '"';
+  for (; *value != '\0' && length + 3 < LOG_RECORD_SIZE; value++) {
+    if (*value == '"' || *value == '\\') {
+      buffer[length++] = '\\';
+    }
+    buffer[length++] = *value;
+  }
+  buffer[length++] = '"';
+  buffer[length] = '\0';
+}
+#endif
+
+// Oldest committed record across both rings, so lines from the two cores
+// come out in the order they were written
+static LogRing *nextRing() {
+  LogRing *oldest = NULL;
+  int64_t oldestUs = 0;
+  for (int core = 0; core < LOG_CORES; core++) {
+    LogRing &ring = rings[core];
+    uint32_t pos = ring.dequeuePos.load(std::memory_order_relaxed);
+    LogRecord &record = ring.records[pos & (LOG_RING_RECORDS - 1)];
+    if (record.seq.load(std::memory_order_acquire) != pos + 1) {
+      continue;
+    }
+    if (oldest == NULL || record.timestampUs < oldestUs) {
+      oldest = &ring;
+      oldestUs = record.timestampUs;
+    }
+  }
+  return oldest;
+}
+
+static void logDrainTask(void *parameter) {
+  uint32_t reportedDrops = 0;
+
+  while (true) {
+    LogRing *ring;
+    while ((ring = nextRing()) != NULL) {
+      uint32_t pos = ring->dequeuePos.load(std::memory_order_relaxed);
+      LogRecord &record = ring->records[pos & (LOG_RING_RECORDS - 1)];
+      Serial.write((const uint8_t *)record.text, record.length);
+      Serial.write('\n');
+      record.seq.store(pos + LOG_RING_RECORDS, std::memory_order_release);
+      ring->dequeuePos.store(pos + 1, std::memory_order_release);
+    }
+
+    uint32_t dropped = droppedRecords.load(std::memory_order_relaxed);
+    if (dropped != reportedDrops) {
+#if CLOCK_LOG_COMPACT
+      Serial.printf("~%08x %u\n", (unsigned)LOG_TOKEN("[LOG] ⚠ %u records dropped (ring full)"),
+                    (unsigned)(dropped - reportedDrops));
+#else
+      Serial.printf("[LOG] ⚠ %u records dropped (ring full)\n", (unsigned)(dropped - reportedDrops));
+#endif
+      reportedDrops = dropped;
+    }
+
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+}
+
+void logBegin() {
+  if (!ringsInitialized.load(std::memory_order_acquire)) {
+    initRings();
+  }
+  xTaskCreate(logDrainTask, "Log Task", LOG_TASK_STACK, NULL, LOG_TASK_PRIORITY, &drainTaskHandle);
+}
+
+uint32_t logDropped() {
+  return droppedRecords.load(std::memory_order_relaxed);
+}
+
+void logFlush() {
+  if (drainTaskHandle == NULL) {
+    return;
+  }
+  xTaskNotifyGive(drainTaskHandle);
+  for (int core = 0; core < LOG_CORES; core++) {
+    LogRing &ring = rings[core];
+    uint32_t target = ring.enqueuePos.load(std::memory_order_acquire);
+    while ((int32_t)(ring.dequeuePos.load(std::memory_order_acquire) - target) < 0) {
+      vTaskDelay(1);
+    }
+  }
+  Serial.flush();
+}
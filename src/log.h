@@ -0,0 +1,131 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+
+// Asynchronous logging.
+//
+// LOGx() formats the line into a fixed-size record in a lock-free ring
+// buffer owned by the calling core and returns; the UART is only touched by
+// a low-priority drain task. When a ring is full the record is dropped and
+// counted instead of blocking the caller. Levels above CLOCK_LOG_LEVEL
+// compile to nothing, arguments included.
+//
+// With -DCLOCK_LOG_COMPACT=1 format strings never reach flash: each call
+// emits "~<token> <args...>", where the token is a compile-time FNV-1a hash
+// of the format string, and LOG_BANNER() lines are stripped entirely.
+// tools/log_decode.py rebuilds the text from the sources on the host.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef CLOCK_LOG_LEVEL
+#define CLOCK_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifndef CLOCK_LOG_COMPACT
+#define CLOCK_LOG_COMPACT 0
+#endif
+
+// Longest line kept; longer lines are truncated
+#define LOG_RECORD_SIZE 128
+// Records per core, must be a power of two
+#define LOG_RING_RECORDS 32
+
+// Start the drain task; records written before this are kept in the rings
+void logBegin();
+
+// Format one line into the current core's ring (newline is added on output)
+void logWrite(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+// Copy an already formatted line into the current core's ring
+void logWriteRaw(const char *text, size_t length);
+
+// Number of records dropped because a ring was full
+uint32_t logDropped();
+
+// Block until everything written so far has reached the UART
+void logFlush();
+
+#if CLOCK_LOG_COMPACT
+
+#include <type_traits>
+
+// FNV-1a over the format string; must match tools/log_decode.py
+constexpr uint32_t logTokenHash(const char *text, uint32_t hash = 2166136261u) {
+  return *text ? logTokenHash(text + 1, (hash ^ (uint8_t)*text) * 16777619u) : hash;
+}
+
+// Forces the hash to be evaluated by the compiler, so the literal is unused
+#define LOG_TOKEN(format) (std::integral_constant<uint32_t, logTokenHash(format)>::value)
+
+// Argument encoders: numbers as plain text, strings quoted
+void logAppendArg(char *buffer, size_t &length, long long value);
+void logAppendArg(char *buffer, size_t &length, unsigned long long value);
+void logAppendArg(char *buffer, size_t &length, double value);
+void logAppendArg(char *buffer, size_t &length, const char *value);
+inline void logAppendArg(char *buffer, size_t &length, int value) { logAppendArg(buffer, length, (long long)value); }
+inline void logAppendArg(char *buffer, size_t &length, long value) { logAppendArg(buffer, length, (long long)value); }
+inline void logAppendArg(char *buffer, size_t &length, unsigned value) { logAppendArg(buffer, length, (unsigned long long)value); }
+inline void logAppendArg(char *buffer, size_t &length, unsigned long value) { logAppendArg(buffer, length, (unsigned long long)value); }
+
+size_t logBeginToken(char *buffer, uint32_t token);
+
+inline void logAppendArgs(char *buffer, size_t &length) {}
+
+template <typename First, typename... Rest>
+void logAppendArgs(char *buffer, size_t &length, First first, Rest... rest) {
+  logAppendArg(buffer, length, first);
+  logAppendArgs(buffer, length, rest...);
+}
+
+template <typename... Args>
+void logWriteToken(uint32_t token, Args... args) {
+  char buffer[LOG_RECORD_SIZE];
+  size_t length = logBeginToken(buffer, token);
+  logAppendArgs(buffer, length, args...);
+  logWriteRaw(buffer, length);
+}
+
+#define LOG_EMIT(format, ...) logWriteToken(LOG_TOKEN(format), ##__VA_ARGS__)
+#define LOG_BANNER(...) do {} while (0)
+
+#else
+
+#define LOG_EMIT(...) logWrite(__VA_ARGS__)
+
+#endif
+
+#if CLOCK_LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOGE(...) LOG_EMIT(__VA_ARGS__)
+#else
+#define LOGE(...) do {} while (0)
+#endif
+
+#if CLOCK_LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOGW(...) LOG_EMIT(__VA_ARGS__)
+#else
+#define LOGW(...) do {} while (0)
+#endif
+
+#if CLOCK_LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOGI(...) LOG_EMIT(__VA_ARGS__)
+#else
+#define LOGI(...) do {} while (0)
+#endif
+
+#if CLOCK_LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOGD(...) LOG_EMIT(__VA_ARGS__)
+#else
+#define LOGD(...) do {} while (0)
+#endif
+
+// Decorative lines (box drawing, separators); dropped in compact mode
+#ifndef LOG_BANNER
+#define LOG_BANNER(...) LOGI(__VA_ARGS__)
+#endif
+
+#endif
@@ -1,14 +1,35 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include <RTClib.h>
-#include <TM1637.h>
 #include <WiFiManager.h>
-#include <NTPClient.h>
 #include <WiFiUdp.h>
-#include <WebServer.h>
-#include <Preferences.h>
 #include <nvs_flash.h>
 #include <qrcode.h>
+#include <esp_timer.h>
+#include <atomic>
+
+#include "animation.h"
+#include "bench.h"
+#include "boot_diag.h"
+#include "bus_stats.h"
+#include "config_store.h"
+#include "event_stream.h"
+#include "frame_schedule.h"
+#include "http_server.h"
+#include "latency.h"
+#include "log.h"
+#include "power.h"
+#include "rtc_drift.h"
+#include "runtime_stats.h"
+#include "sntp_client.h"
+#include "sntp_server.h"
+#include "soft_clock.h"
+#include "spsc_queue.h"
+#include "time_service.h"
+#include "tm1637_bank.h"
+#include "tm1637_frame.h"
+#include "tz_engine.h"
+#include "web_assets.h"
 
 // GPIO Pins for ESP32-S3
 #define CLK_PIN 12  // TM1637 CLK
@@ -16,147 +37,152 @@
 #define SDA_PIN 21  // I2C SDA
 #define SCL_PIN 20  // I2C SCL
 
-// FreeRTOS Core definitions
-#define CORE_WIFI 0      // Core 0: WiFi, NTP, Web Server
-#define CORE_DISPLAY 1   // Core 1: Display, RTC, Animation
+// Extra displays in lockstep with the main clock (table below); build with
+// -DCLOCK_EXTRA_DISPLAYS=1 or the esp32-s3-multi environment
+#ifndef CLOCK_EXTRA_DISPLAYS
+#define CLOCK_EXTRA_DISPLAYS 0
+#endif
 
-// Preferences (ESP32 alternative to EEPROM)
-Preferences preferences;
+// FreeRTOS Core definitions
+#define CORE_WIFI 0      // Core 0: WiFi, time service (NTP, RTC), Web Server
+#define CORE_DISPLAY 1   // Core 1: Display, Animation
+
+// Task stacks (bytes); check the headroom in /metrics before changing them
+#define DISPLAY_TASK_STACK 4096
+#define TIME_TASK_STACK 4096
+#define WIFI_TASK_STACK 8192
+
+// How often the time-service task re-reads the DS1307 to check the in-memory clock
+#define RTC_DRIFT_CHECK_INTERVAL_MS 600000  // 10 minutes
+#define RTC_DRIFT_TOLERANCE_S 2             // RTC has whole-second resolution
+
+#define NTP_WIFI_HOLD_MS (SNTP_TIMEOUT_MS + 500)  // Radio awake for a whole round
+#define NTP_RETRY_MIN_MS 60000  // First retry after a failed sync, doubling up to the interval
+#define RTC_EDGE_TIMEOUT_MS 1100
+
+// Aligned RTC writes: the seconds byte is the 3rd of the 10 bytes on the
+// wire for rtc.adjust() (address, register, 7 time registers, stop), so it
+// latches about 30% into the transaction. The lead time starts from that
+// estimate at 100 kHz and is re-calibrated from each measured residual.
+#define RTC_WRITE_LEAD_INITIAL_US 300
+#define RTC_WRITE_LEAD_MAX_US 5000
+#define RTC_WRITE_MIN_SETUP_US 20000  // Too close to an edge: use the next one
+#define RTC_SECONDS_BYTE_INDEX 3
+#define RTC_WRITE_BYTES 10
 
 // Global objects
-TM1637 display(CLK_PIN, DIO_PIN);
+Tm1637Frame display(CLK_PIN, DIO_PIN);
+AnimationPlayer animation;  // Owned by the display task
 RTC_DS1307 rtc;
-WiFiUDP ntpUDP;
-NTPClient timeClient(ntpUDP, "pool.ntp.org", 0, 60000);
-WebServer server(80);
+const char *const ntpServers[] = {
+  "0.pool.ntp.org",
+  "1.pool.ntp.org",
+  "2.pool.ntp.org",
+  "time.google.com"
+};
+SntpClient sntp(ntpServers, sizeof(ntpServers) / sizeof(ntpServers[0]));
+HttpServer server(80);
+EventStream timeEvents;
 
 // Global variables
-int timezoneOffset = 0; // in hours
-volatile bool wifiConnected = false;
-volatile bool syncRequested = false;
-volatile bool timeReady = false; // True when time is synced and ready to display
-volatile unsigned long lastDisplayUpdate = 0;
-volatile bool colonState = true;
+std::atomic<bool> wifiConnected{false};
+std::atomic<bool> timeReady{false}; // True when time is synced and ready to display
+std::atomic<bool> rtcReady{false};  // DS1307 initialized; from then on only the
+                                    // time-service task touches I2C
+std::atomic<uint8_t> statusAnimation{ANIMATION_CONNECTING}; // Shown until time is ready
+uint8_t displayBrightness = CONFIG_DEFAULT_BRIGHTNESS; // Stored level (display task)
+
+// DS1307 drift and the adaptive NTP sync interval (time-service task only)
+RtcDrift rtcDrift = {0.0f, false, 0, 0, NTP_SYNC_INTERVAL_DEFAULT_MS};
+
+// Aligned RTC write state
+esp_timer_handle_t rtcEdgeTimer = NULL;
+int32_t rtcWriteLeadUs = RTC_WRITE_LEAD_INITIAL_US;
+
+// Sync state owned by the time-service task; others read the published copy
+TimeSyncStatus syncStatus = {};
 
 // FreeRTOS task handles
 TaskHandle_t wifiTaskHandle = NULL;
+TaskHandle_t timeTaskHandle = NULL;
 TaskHandle_t displayTaskHandle = NULL;
 
-// Mutex for shared resources
-SemaphoreHandle_t timeMutex;
-SemaphoreHandle_t displayMutex;
-
-// HTML page for timezone selection
-const char index_html[] PROGMEM = R"rawliteral(
-<!DOCTYPE HTML><html>
-<head>
-  <meta name="viewport" content="width=device-width, initial-scale=1">
-  <style>
-    body { font-family: Arial; text-align: center; margin: 20px; }
-    h1 { color: #333; }
-    select { padding: 10px; font-size: 16px; margin: 10px; }
-    button { padding: 10px 30px; font-size: 16px; background-color: #4CAF50; color: white; border: none; cursor: pointer; }
-    button:hover { background-color: #45a049; }
-    .info { margin: 20px; padding: 10px; background-color: #f0f0f0; }
-  </style>
-</head>
-<body>
-  <h1>ESP32-S3 Clock Setup</h1>
-  <div class="info">
-    <p>Current Time: <span id="time">Loading...</span></p>
-    <p>WiFi Status: <span id="wifi">Connected</span></p>
-  </div>
-  <form action="/setTimezone" method="POST">
-    <label for="timezone">Select Timezone:</label><br>
-    <select name="timezone" id="timezone">
-      <option value="-12">UTC-12:00</option>
-      <option value="-11">UTC-11:00</option>
-      <option value="-10">UTC-10:00</option>
-      <option value="-9">UTC-09:00</option>
-      <option value="-8">UTC-08:00</option>
-      <option value="-7">UTC-07:00</option>
-      <option value="-6">UTC-06:00</option>
-      <option value="-5">UTC-05:00</option>
-      <option value="-4">UTC-04:00</option>
-      <option value="-3">UTC-03:00</option>
-      <option value="-2">UTC-02:00</option>
-      <option value="-1">UTC-01:00</option>
-      <option value="0" selected>UTC+00:00</option>
-      <option value="1">UTC+01:00</option>
-      <option value="2">UTC+02:00 (EET)</option>
-      <option value="3">UTC+03:00 (EEST)</option>
-      <option value="4">UTC+04:00</option>
-      <option value="5">UTC+05:00</option>
-      <option value="6">UTC+06:00</option>
-      <option value="7">UTC+07:00</option>
-      <option value="8">UTC+08:00</option>
-      <option value="9">UTC+09:00</option>
-      <option value="10">UTC+10:00</option>
-      <option value="11">UTC+11:00</option>
-      <option value="12">UTC+12:00</option>
-      <option value="13">UTC+13:00</option>
-      <option value="14">UTC+14:00</option>
-    </select><br><br>
-    <button type="submit">Update Timezone & Sync Time</button>
-  </form>
-  <script>
-    setInterval(function() {
-      fetch('/getTime').then(r => r.text()).then(t => {
-        document.getElementById('time').innerText = t;
-      });
-    }, 1000);
-  </script>
-</body>
-</html>
-)rawliteral";
-
-// Function to save timezone to Preferences
-void saveTimezone(int tz) {
-  Serial.print("[CONFIG] Saving timezone to preferences: UTC");
-  if (tz >= 0) Serial.print("+");
-  Serial.println(tz);
-
-  if (preferences.begin("clock", false)) {
-    preferences.putInt("timezone", tz);
-    preferences.end();
-    timezoneOffset = tz;
-    Serial.println("[CONFIG] ✓ Timezone saved successfully");
-  } else {
-    Serial.println("[CONFIG] ✗ Failed to save timezone - preferences could not be initialized");
-    Serial.println("[CONFIG] → Using in-memory value only");
-    timezoneOffset = tz; // Still update in memory
+// Commands from the time-service task (the only producer) to the display
+// task (the only consumer), which owns the TM1637
+#define DISPLAY_COMMAND_QUEUE_LENGTH 8
+
+enum DisplayCommandType {
+  DISPLAY_CMD_BRIGHTNESS
+};
+
+struct DisplayCommand {
+  DisplayCommandType type;
+  uint8_t value;
+  int64_t postedUs;
+};
+
+SpscQueue<DisplayCommand, DISPLAY_COMMAND_QUEUE_LENGTH> displayCommands;
+
+#if CLOCK_EXTRA_DISPLAYS
+// What an extra display shows
+enum ExtraDisplaySource {
+  EXTRA_SOURCE_LOCAL,     // Same zone as the main clock
+  EXTRA_SOURCE_ZONE,      // Another POSIX zone
+  EXTRA_SOURCE_COUNTDOWN  // Time left until a UTC instant
+};
+
+struct ExtraDisplay {
+  uint8_t clkPin;
+  uint8_t dioPin;
+  ExtraDisplaySource source;
+  const char *zone;  // EXTRA_SOURCE_ZONE
+  uint32_t targetS;  // EXTRA_SOURCE_COUNTDOWN, UTC seconds since the epoch
+};
+
+// Up to TM1637_BANK_MAX displays; they may share a CLK pin, each needs its own DIO
+const ExtraDisplay extraDisplays[] = {
+  {14, 15, EXTRA_SOURCE_ZONE, "EST5EDT,M3.2.0,M11.1.0", 0},
+  {14, 16, EXTRA_SOURCE_ZONE, "JST-9", 0},
+  {14, 17, EXTRA_SOURCE_COUNTDOWN, NULL, 1798761600}  // 2027-01-01 00:00 UTC
+};
+const uint8_t extraDisplayCount = sizeof(extraDisplays) / sizeof(extraDisplays[0]);
+
+Tm1637Bank extraBank;  // Owned by the display task, like the main display
+#endif
+
+// /metrics body: 24 tasks with three series each plus the heap, power and
+// SNTP server metrics come to about 7 KB
+#define METRICS_BODY_SIZE 8192
+
+// Embedded web pages may be cached for 10 min, then revalidated by ETag
+#define WEB_ASSET_CACHE_CONTROL "max-age=600"
+
+// Function to load settings and apply them
+// Older firmware stored a whole-hour offset and kept local time in the RTC;
+// the store converts the setting, and the time-service task moves the RTC
+// back to UTC.
+void loadConfig() {
+  configBegin();
+  ClockConfig config;
+  configGet(config);
+
+  if (!tzSet(config.tz)) {
+    LOGE("[CONFIG] ✗ Invalid saved timezone, using UTC");
+    tzSet(CONFIG_DEFAULT_TZ);
   }
-}
-
-// Function to load timezone from Preferences
-void loadTimezone() {
-  Serial.println("[CONFIG] Loading timezone from preferences...");
-
-  // Try to open in read-write mode first to create namespace if it doesn't exist
-  if (preferences.begin("clock", false)) {
-    // Check if timezone key exists
-    if (preferences.isKey("timezone")) {
-      timezoneOffset = preferences.getInt("timezone", 0);
-      Serial.print("[CONFIG] ✓ Timezone loaded: UTC");
-      if (timezoneOffset >= 0) Serial.print("+");
-      Serial.println(timezoneOffset);
-    } else {
-      // First time - initialize with default
-      Serial.println("[CONFIG] → First time setup - no saved timezone");
-      timezoneOffset = 0;
-      preferences.putInt("timezone", timezoneOffset);
-      Serial.println("[CONFIG] ✓ Initialized with default: UTC+0");
-    }
-    preferences.end();
-  } else {
-    Serial.println("[CONFIG] ✗ Failed to open preferences namespace");
-    Serial.println("[CONFIG] → Using default: UTC+0");
-    timezoneOffset = 0;
+  powerConfigure(config.power);
+  // The display task may already be showing time in the default zone
+  if (displayTaskHandle != NULL) {
+    xTaskNotifyGive(displayTaskHandle);
   }
 }
 
 // Function to print WiFi QR code to serial console
 void printWiFiQR(const char* ssid, const char* password) {
+#if CLOCK_LOG_COMPACT
+  // Compact logs carry only the payload; the host decoder can render it
+  LOGI("[WiFi] QR WIFI:T:WPA;S:%s;P:%s;;", ssid, password);
+#else
   // Create WiFi QR code string in format: WIFI:T:WPA;S:ssid;P:password;;
   String qrData = "WIFI:T:WPA;S:";
   qrData += ssid;
@@ -170,588 +196,1357 @@ void printWiFiQR(const char* ssid, const char* password) {
   qrcode_initText(&qrcode, qrcodeData, 3, ECC_LOW, qrData.c_str());
 
   // Print QR code to serial with border
-  Serial.println("\n╔════════════════════════════════════════════════╗");
-  Serial.println("║       WiFi AP - Scan to Connect               ║");
-  Serial.println("╠════════════════════════════════════════════════╣");
-  Serial.print("║ SSID: ");
-  Serial.print(ssid);
-  for (int i = strlen(ssid); i < 38; i++) Serial.print(" ");
-  Serial.println("║");
-  Serial.print("║ Password: ");
-  Serial.print(password);
-  for (int i = strlen(password); i < 32; i++) Serial.print(" ");
-  Serial.println("║");
-  Serial.println("╠════════════════════════════════════════════════╣");
-
-  // Print QR code
-  for (uint8_t y = 0; y < qrcode.size; y++) {
-    Serial.print("║ ");
+  LOG_BANNER("╔════════════════════════════════════════════════╗");
+  LOG_BANNER("║       WiFi AP - Scan to Connect               ║");
+  LOG_BANNER("╠════════════════════════════════════════════════╣");
+  LOGI("║ SSID: %-38s║", ssid);
+  LOGI("║ Password: %-32s║", password);
+  LOG_BANNER("╠════════════════════════════════════════════════╣");
+
+  // Print QR code, two module rows per text line using half-block glyphs
+  // so each line fits in one log record
+  char row[LOG_RECORD_SIZE];
+  for (uint8_t y = 0; y < qrcode.size; y += 2) {
+    size_t len = 0;
     for (uint8_t x = 0; x < qrcode.size; x++) {
-      if (qrcode_getModule(&qrcode, x, y)) {
-        Serial.print("██");
-      } else {
-        Serial.print("  ");
+      bool top = qrcode_getModule(&qrcode, x, y);
+      bool bottom = (y + 1 < qrcode.size) && qrcode_getModule(&qrcode, x, y + 1);
+      const char *glyph = top ? (bottom ? "█" : "▀") : (bottom ? "▄" : " ");
+      size_t glyphLen = strlen(glyph);
+      if (len + glyphLen >= sizeof(row)) {
+        break;
       }
+      memcpy(row + len, glyph, glyphLen);
+      len += glyphLen;
+    }
+    row[len] = '\0';
+    LOGI("║ %s ║", row);
+  }
+
+  LOG_BANNER("╚════════════════════════════════════════════════╝");
+#endif
+}
+
+// Function to mark time as ready and wake the display task
+// The display task sleeps until its next frame is due, so any event that
+// changes what it should show (time ready, clock stepped) must notify it.
+void signalTimeReady() {
+  timeReady.store(true, std::memory_order_release);
+  if (displayTaskHandle != NULL) {
+    xTaskNotifyGive(displayTaskHandle);
+  }
+}
+
+// Function to choose the status animation shown until time is ready
+// Any task may call this; the display task is only woken while it matters.
+void showStatus(AnimationId id) {
+  statusAnimation.store(id, std::memory_order_release);
+  if (!timeReady.load(std::memory_order_acquire) && displayTaskHandle != NULL) {
+    xTaskNotifyGive(displayTaskHandle);
+  }
+}
+
+// Function to queue a command for the display task and wake it
+// Only the time-service task may call this (single producer).
+void postDisplayCommand(DisplayCommandType type, uint8_t value) {
+  DisplayCommand command;
+  command.type = type;
+  command.value = value;
+  command.postedUs = esp_timer_get_time();
+  if (!displayCommands.push(command)) {
+    LOGW("[Display] ⚠ Command queue full, command dropped");
+    return;
+  }
+  xTaskNotifyGive(displayTaskHandle);
+}
+
+// Function to apply the commands queued for the display task
+void applyDisplayCommands() {
+  DisplayCommand command;
+  while (displayCommands.pop(command)) {
+    busStatsRecordWait(BUS_WAIT_DISPLAY_QUEUE,
+                       (uint32_t)(esp_timer_get_time() - command.postedUs));
+    switch (command.type) {
+      case DISPLAY_CMD_BRIGHTNESS:
+        // The clock loop caps it by the night window and ambient light
+        displayBrightness = command.value;
+        display.setBrightness(command.value);
+#if CLOCK_EXTRA_DISPLAYS
+        extraBank.setBrightness(command.value);
+#endif
+        break;
+    }
+  }
+}
+
+// Function to compute how long the display task may sleep
+// The next frame is due on the half-second edge after the one just drawn
+// (see frame_schedule.h); the edge itself is returned in dueUs.
+TickType_t ticksUntilNextFrame(int64_t renderUs, int64_t &dueUs) {
+  dueUs = frameNextEdgeUs(renderUs);
+  return pdMS_TO_TICKS(frameWaitMs(softClockNowUs(), dueUs));
+}
+
+// Function to read the DS1307 (one I2C transaction), counted and timed
+DateTime readRtc() {
+  PowerLock lock;
+  LATENCY_SCOPE(LATENCY_RTC_READ);
+  busStatsCountI2c();
+  return rtc.now();
+}
+
+// Function to measure the DS1307's error against the in-memory clock
+// The RTC only reports whole seconds, so poll it until the seconds register
+// ticks over; the tick is the RTC's exact second edge. Time-service task only.
+// Returns false if no edge was seen.
+bool measureRtcErrorUs(int64_t &errorUs) {
+  DateTime first = readRtc();
+  int64_t beforeUs = softClockNowUs();
+  unsigned long startMs = millis();
+
+  while (millis() - startMs < RTC_EDGE_TIMEOUT_MS) {
+    vTaskDelay(1);
+    DateTime current = readRtc();
+    int64_t afterUs = softClockNowUs();
+    if (current.unixtime() != first.unixtime()) {
+      int64_t edgeUs = beforeUs + (afterUs - beforeUs) / 2;
+      errorUs = (int64_t)current.unixtime() * 1000000LL - edgeUs;
+      return true;
     }
-    Serial.println(" ║");
+    beforeUs = afterUs;
   }
+  return false;
+}
 
-  Serial.println("╚════════════════════════════════════════════════╝");
-  Serial.println();
+// Function to fold a new RTC error measurement into the drift estimate
+// and publish the sync interval derived from it
+void updateRtcDrift(int64_t rtcErrorUs, int64_t nowUs) {
+  if (!rtcDriftUpdate(rtcDrift, rtcErrorUs, nowUs)) {
+    return;
+  }
+  syncStatus.rtcDriftPpm = rtcDrift.ppm;
+  syncStatus.nextSyncMin = rtcDrift.syncIntervalMs / 60000;
+}
+
+// esp_timer callback: wake the task waiting to write the RTC
+static void rtcEdgeTimerCallback(void *arg) {
+  xTaskNotifyGive((TaskHandle_t)arg);
 }
 
-// Function to sync time from NTP and update RTC
+// Function to write the RTC exactly on the next second edge of the in-memory clock
+// An esp_timer one-shot wakes us just before the edge (minus the calibrated
+// I2C lead time), then a short spin absorbs scheduling jitter. Writing the
+// seconds register also restarts the DS1307's internal second, so its ticks
+// line up with the true second from then on. Time-service task only.
+// Returns the written time; the residual error is left in syncStatus.
+DateTime writeRtcAligned() {
+  if (rtcEdgeTimer == NULL) {
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = rtcEdgeTimerCallback;
+    timerArgs.arg = xTaskGetCurrentTaskHandle();
+    timerArgs.name = "rtc_edge";
+    esp_timer_create(&timerArgs, &rtcEdgeTimer);
+  }
+
+  int64_t nowUs = softClockNowUs();
+  int64_t edgeUs = (nowUs / 1000000LL + 1) * 1000000LL;
+  if (edgeUs - nowUs < RTC_WRITE_MIN_SETUP_US + rtcWriteLeadUs) {
+    edgeUs += 1000000LL;
+  }
+  int64_t fireUs = edgeUs - rtcWriteLeadUs;
+
+  // Sleep until ~1 ms before the write, then spin the rest of the way
+  ulTaskNotifyTake(pdTRUE, 0);
+  esp_timer_start_once(rtcEdgeTimer, (uint64_t)(fireUs - nowUs - 1000));
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(2100));
+  PowerLock lock;  // Any clock switch happens during the spin, not the write
+  while (softClockNowUs() < fireUs) {
+  }
+
+  DateTime written((uint32_t)(edgeUs / 1000000LL));
+  int64_t startUs = softClockNowUs();
+  rtc.adjust(written);
+  int64_t endUs = softClockNowUs();
+  busStatsCountI2c();
+  LATENCY_RECORD(LATENCY_RTC_WRITE, (uint32_t)(endUs - startUs));
+
+  int64_t latchUs = startUs + (endUs - startUs) * RTC_SECONDS_BYTE_INDEX / RTC_WRITE_BYTES;
+  int32_t residualUs = (int32_t)(latchUs - edgeUs);
+  syncStatus.rtcResidualUs = residualUs;
+
+  // Re-calibrate the lead with half of the error to stay stable under jitter
+  rtcWriteLeadUs = constrain(rtcWriteLeadUs + residualUs / 2, (int32_t)0, (int32_t)RTC_WRITE_LEAD_MAX_US);
+
+  // A late write leaves the RTC behind by the residual
+  rtcDriftWritten(rtcDrift, edgeUs, -residualUs);
+  return written;
+}
+
+// Function to record a failed sync in the published state
+void failSync(const char *error) {
+  syncStatus.state = TIME_SYNC_IDLE;
+  syncStatus.lastError = error;
+  timeServicePublish(syncStatus);
+  showStatus(ANIMATION_SYNC_ERROR);
+}
+
+// Function to start an NTP sync round (non-blocking)
+// The time-service task polls the client and calls finishNtpSync() when done.
 bool syncTimeFromNTP() {
-  if (!wifiConnected) {
-    Serial.println("[NTP] ✗ Cannot sync - WiFi not connected");
+  if (!wifiConnected.load(std::memory_order_acquire)) {
+    LOGE("[NTP] ✗ Cannot sync - WiFi not connected");
+    failSync("wifi not connected");
     return false;
   }
+  if (sntp.busy()) {
+    return true;
+  }
 
-  Serial.println();
-  Serial.println("[NTP] ═══════════════════════════════════════");
-  Serial.println("[NTP] Starting NTP time synchronization...");
-  Serial.print("[NTP] → NTP Server: ");
-  Serial.println("pool.ntp.org");
-  Serial.print("[NTP] → Timezone Offset: UTC");
-  if (timezoneOffset >= 0) Serial.print("+");
-  Serial.print(timezoneOffset);
-  Serial.println(" hours");
-
-  timeClient.setTimeOffset(timezoneOffset * 3600);
-
-  Serial.println("[NTP] → Sending time request...");
-  if (timeClient.update()) {
-    unsigned long epochTime = timeClient.getEpochTime();
-    Serial.print("[NTP] → Received epoch time: ");
-    Serial.println(epochTime);
-
-    // Acquire mutex before updating RTC
-    if (xSemaphoreTake(timeMutex, portMAX_DELAY) == pdTRUE) {
-      // Convert to DateTime and set RTC
-      DateTime dt = DateTime(epochTime);
-      rtc.adjust(dt);
-
-      Serial.println("[NTP] → Updating RTC module...");
-      Serial.print("[NTP] ✓ Time synchronized: ");
-      char timeStr[20];
-      sprintf(timeStr, "%02d:%02d:%02d", dt.hour(), dt.minute(), dt.second());
-      Serial.println(timeStr);
-      Serial.print("[NTP] → Date: ");
-      sprintf(timeStr, "%04d-%02d-%02d", dt.year(), dt.month(), dt.day());
-      Serial.println(timeStr);
-
-      xSemaphoreGive(timeMutex);
-
-      // Signal that time is ready to display
-      timeReady = true;
-
-      Serial.println("[NTP] ═══════════════════════════════════════");
-      Serial.println();
-      return true;
-    } else {
-      Serial.println("[NTP] ✗ Failed to acquire mutex");
+  LOG_BANNER("[NTP] ═══════════════════════════════════════");
+  LOGI("[NTP] Starting NTP time synchronization...");
+
+  syncStatus.attempts++;
+  // Out of modem sleep first, so replies are not held at the AP until a beacon
+  powerHoldWifi(NTP_WIFI_HOLD_MS);
+  if (!sntp.start()) {
+    LOGE("[NTP] ✗ Failed to send requests to any NTP server");
+    LOGI("[NTP] → This may be due to network issues");
+    LOG_BANNER("[NTP] ═══════════════════════════════════════");
+    failSync("send failed");
+    return false;
+  }
+  LOGI("[NTP] → Requests sent, waiting for replies...");
+  showStatus(ANIMATION_NTP_SYNC);
+  syncStatus.state = TIME_SYNC_IN_PROGRESS;
+  timeServicePublish(syncStatus);
+  return true;
+}
+
+// Function to apply the result of an NTP round to the clock and the RTC
+bool finishNtpSync(const SntpResult &result) {
+  if (!result.ok) {
+    LOGE("[NTP] ✗ No usable reply (%u of %u servers answered)", result.responses, result.requests);
+    LOGI("[NTP] → This may be due to network issues");
+    LOG_BANNER("[NTP] ═══════════════════════════════════════");
+    failSync(result.responses ? "no usable reply" : "no reply");
+    return false;
+  }
+
+  LOGI("[NTP] → Best server: %s (stratum %u, %u of %u replied)",
+       sntp.serverName(result.serverIndex), result.best.stratum,
+       result.responses, result.requests);
+  LOGI("[NTP] → Offset: %lld ms, round trip: %lld ms",
+       (long long)(result.best.offsetUs / 1000), (long long)(result.best.delayUs / 1000));
+
+  // Step the in-memory clock first; it is the reference for the RTC check
+  softClockSet(softClockNowUs() + result.best.offsetUs);
+#if CLOCK_SNTP_SERVER
+  sntpServerSetReference(result.best, sntp.serverAddress(result.serverIndex), softClockNowUs());
+#endif
+
+  int64_t rtcErrorUs;
+  bool rtcMeasured = false;
+  bool rtcWritten = rtcReady.load(std::memory_order_acquire);
+  DateTime dt(softClockNow());
+  if (rtcWritten) {
+    rtcMeasured = measureRtcErrorUs(rtcErrorUs);
+    if (rtcMeasured) {
+      updateRtcDrift(rtcErrorUs, softClockNowUs());
     }
+
+    // Set the RTC on the next true second edge
+    dt = writeRtcAligned();
+  }
+
+  syncStatus.state = TIME_SYNC_IDLE;
+  syncStatus.successes++;
+  syncStatus.lastSuccessEpoch = dt.unixtime();
+  syncStatus.lastOffsetMs = (int32_t)(result.best.offsetUs / 1000);
+  syncStatus.lastRttMs = (int32_t)(result.best.delayUs / 1000);
+  syncStatus.lastError = NULL;
+  timeServicePublish(syncStatus);
+
+  if (rtcWritten) {
+    LOGI("[NTP] → RTC written on second edge (residual: %ld us)", (long)syncStatus.rtcResidualUs);
   } else {
-    Serial.println("[NTP] ✗ Failed to receive time from NTP server");
-    Serial.println("[NTP] → This may be due to network issues");
-    Serial.println("[NTP] ═══════════════════════════════════════");
-    Serial.println();
+    LOGW("[NTP] ⚠ RTC not initialized yet - only the in-memory clock was set");
   }
-  return false;
+  if (rtcMeasured) {
+    LOGI("[NTP] → RTC error before update: %lld ms", (long long)(rtcErrorUs / 1000));
+  }
+  if (rtcDrift.known) {
+    LOGI("[NTP] → RTC drift: %.2f ppm", rtcDrift.ppm);
+  }
+  LOGI("[NTP] ✓ Time synchronized: %02d:%02d:%02d UTC", dt.hour(), dt.minute(), dt.second());
+  LOGI("[NTP] → Date: %04d-%02d-%02d", dt.year(), dt.month(), dt.day());
+  LOGI("[NTP] → Next sync in %lu min", (unsigned long)(rtcDrift.syncIntervalMs / 60000));
+
+  // Signal that time is ready to display (also re-aligns the colon)
+  signalTimeReady();
+  bootMark(BOOT_FIRST_NTP_SYNC);
+
+  LOG_BANNER("[NTP] ═══════════════════════════════════════");
+  return true;
 }
 
-// Function to show one frame of the spinning animation
-// Returns the next pattern index
-int showSpinningFrame(int patternIndex) {
-  // Segment patterns for circle animation (rotating around the display)
-  // Segment mapping: A=0x01, B=0x02, C=0x04, D=0x08, E=0x10, F=0x20, G=0x40
-  const uint8_t circlePatterns[] = {
-    0b00000001,  // A - top
-    0b00000010,  // B - top-right
-    0b00000100,  // C - bottom-right
-    0b00001000,  // D - bottom
-    0b00010000,  // E - bottom-left
-    0b00100000   // F - top-left
-  };
+// Function to switch the display zone
+// The clock and the RTC hold UTC, so nothing but the conversion changes.
+void applyTimezone(const char *tz) {
+  if (!tzSet(tz)) {
+    LOGE("[CONFIG] ✗ Invalid timezone: %s", tz);
+    return;
+  }
+  LOGI("[CONFIG] → Timezone now %s", tz);
+  configSetTimezone(tz);
+  xTaskNotifyGive(displayTaskHandle);
+}
 
-  const int numPatterns = 6;
+// Function to move an RTC left in local time by older firmware to UTC
+// The store keeps its migration flag until the rewrite has been read back,
+// so a restart or a failed write before then converts again on next boot.
+void migrateRtcToUtc() {
+  int32_t offsetS = configRtcLocalOffsetS();
+  for (int i = 0; i < 20 && !rtcReady.load(std::memory_order_acquire); i++) {
+    vTaskDelay(pdMS_TO_TICKS(100));
+  }
+  if (!rtcReady.load(std::memory_order_acquire)) {
+    return;  // No RTC time to convert; try again on next boot
+  }
+  softClockSet(softClockNowUs() - (int64_t)offsetS * 1000000LL);
+  xTaskNotifyGive(displayTaskHandle);
+  DateTime written = writeRtcAligned();
+  int32_t readBackS = (int32_t)(readRtc().unixtime() - written.unixtime());
+  if (readBackS < 0 || readBackS > 1) {
+    LOGE("[RTC] ✗ Conversion to UTC not confirmed (read back %+ld s), retrying on next boot",
+         (long)readBackS);
+    return;
+  }
+  LOGI("[RTC] ✓ RTC converted from local time to UTC (%+ld s)", (long)-offsetS);
+  configRtcMigrated();
+}
 
-  // Buffer to hold 4 digits (all showing the same pattern)
-  uint8_t buffer[4];
+// Function to set the clock and the RTC to a user-supplied UTC time
+void setManualTime(uint32_t epoch) {
+  DateTime dt(epoch);
+  LOGI("[CONFIG] → Manual time: %04d-%02d-%02d %02d:%02d:%02d UTC",
+       dt.year(), dt.month(), dt.day(), dt.hour(), dt.minute(), dt.second());
+
+  softClockSet((int64_t)epoch * 1000000LL);
+#if CLOCK_SNTP_SERVER
+  sntpServerClearReference();  // Not traceable to NTP any more
+#endif
+  if (rtcReady.load(std::memory_order_acquire)) {
+    writeRtcAligned();
+  }
+  // A hand-set time is no reference for measuring RTC drift
+  rtcDriftForget(rtcDrift);
+  signalTimeReady();
+}
 
-  // Fill buffer with the same pattern for all 4 digits
-  for (int digit = 0; digit < 4; digit++) {
-    buffer[digit] = circlePatterns[patternIndex];
+// Function to compare the in-memory clock against the DS1307
+// The RTC stays authoritative between NTP syncs: if the two disagree by more
+// than the RTC's whole-second resolution, re-seed from the RTC.
+// Runs in the time-service task, so the display task never waits on I2C.
+void checkRtcDrift() {
+  if (!rtcReady.load(std::memory_order_acquire)) {
+    return;
+  }
+  DateTime rtcNow = readRtc();
+  uint32_t softNow = softClockNow();
+  long driftSeconds = (long)softNow - (long)rtcNow.unixtime();
+  if (labs(driftSeconds) >= RTC_DRIFT_TOLERANCE_S) {
+    softClockSet((int64_t)rtcNow.unixtime() * 1000000LL);
+#if CLOCK_SNTP_SERVER
+    sntpServerClearReference();
+#endif
+    xTaskNotifyGive(displayTaskHandle);
+    LOGW("[RTC] ⚠ In-memory clock drifted by %ld s - re-seeded from RTC", driftSeconds);
   }
-  display.displayRawBytes(buffer, 4);
+}
 
-  // Return next pattern index (wrap around)
-  return (patternIndex + 1) % numPatterns;
+// Function to report the displays' estimated draw after a flush
+void reportDisplayDraw() {
+  uint8_t chips = 1;
+  uint16_t lit = display.litSegments();
+#if CLOCK_EXTRA_DISPLAYS
+  chips += extraBank.count();
+  lit += extraBank.litSegments();
+#endif
+  powerSetDraw(POWER_DISPLAY, powerDisplayDrawUa(chips, lit, display.brightness()));
+}
+
+// Function to advance an animation on every display
+// Returns the ticks until its next frame is due; between frames nothing runs.
+TickType_t stepAnimation(AnimationId id) {
+  animation.play(id);
+  TickType_t wait;
+  const uint8_t *segments = animation.next(wait);
+  if (segments != NULL) {
+    display.setRaw(segments);
+    display.flush();
+#if CLOCK_EXTRA_DISPLAYS
+    for (uint8_t i = 0; i < extraBank.count(); i++) {
+      extraBank.setRaw(i, segments);
+    }
+    extraBank.flush();
+#endif
+    reportDisplayDraw();
+  }
+  return wait;
 }
 
 // Function to display time on TM1637
+// Only the display task draws, so the TM1637 needs no lock.
 void displayTime(int hour, int minute, bool showColon) {
-  // Acquire display mutex
-  if (xSemaphoreTake(displayMutex, portMAX_DELAY) == pdTRUE) {
-    // Format: HHMM with leading zeros
-    String timeStr = "";
-    if (hour < 10) timeStr += "0";
-    timeStr += String(hour);
-    if (minute < 10) timeStr += "0";
-    timeStr += String(minute);
-
-    // Display the time
-    display.display(timeStr);
-
-    // Control the colon based on showColon parameter
-    if (showColon) {
-      display.colonOn();
-    } else {
-      display.colonOff();
+  LATENCY_SCOPE(LATENCY_DISPLAY_PUSH);
+  // Encode HHMM plus colon into the framebuffer; only changed digits
+  // are sent (a colon blink is a single one-byte write)
+  display.setTime(hour, minute, showColon);
+  display.flush();
+}
+
+#if CLOCK_EXTRA_DISPLAYS
+// Function to set up the extra displays and their zones
+void beginExtraDisplays(uint8_t brightness) {
+  for (uint8_t i = 0; i < extraDisplayCount; i++) {
+    const ExtraDisplay &extra = extraDisplays[i];
+    if (!extraBank.add(extra.clkPin, extra.dioPin)) {
+      LOGW("[Display] ⚠ Only %u extra displays supported", (unsigned)TM1637_BANK_MAX);
+      break;
+    }
+    if (extra.source == EXTRA_SOURCE_ZONE && !tzSlotSet(i, extra.zone)) {
+      LOGE("[Display] ✗ Extra display %u: invalid zone, showing UTC", (unsigned)i);
+    }
+  }
+  extraBank.begin();
+  extraBank.setBrightness(brightness);
+  extraBank.flush();
+  LOGI("[Display] ✓ %u extra displays in lockstep, full frame %lu us on the bus",
+       (unsigned)extraBank.count(), (unsigned long)extraBank.lastFrameUs());
+}
+
+// Function to draw every extra display from its source and flush them together
+// Countdowns show MM:SS in the last hour, HH:MM below 100 hours, days beyond.
+void showExtraDisplays(int64_t nowUs, bool colon) {
+  for (uint8_t i = 0; i < extraBank.count(); i++) {
+    const ExtraDisplay &extra = extraDisplays[i];
+    if (extra.source == EXTRA_SOURCE_COUNTDOWN) {
+      int64_t leftS = (int64_t)extra.targetS - nowUs / 1000000LL;
+      if (leftS <= 0) {
+        extraBank.setTime(i, 0, 0, true);
+      } else if (leftS < 3600) {
+        extraBank.setTime(i, (int)(leftS / 60), (int)(leftS % 60), colon);
+      } else if (leftS < 100 * 3600) {
+        extraBank.setTime(i, (int)(leftS / 3600), (int)(leftS % 3600 / 60), colon);
+      } else {
+        int days = (int)(leftS / 86400);
+        extraBank.setTime(i, days / 100, days % 100, false);
+      }
+      continue;
     }
+    int64_t localUs = extra.source == EXTRA_SOURCE_ZONE ? tzSlotLocalUs(i, nowUs)
+                                                        : tzLocalUs(nowUs);
+    DateTime local((uint32_t)(localUs / 1000000LL));
+    extraBank.setTime(i, local.hour(), local.minute(), colon);
+  }
+  extraBank.flush();
+}
+#endif
+
+// Function to format a clock reading as local time, HH:MM:SS (the /getTime
+// body and the /events payload)
+void formatLocalTime(int64_t utcUs, char *timeStr, size_t size) {
+  DateTime now((uint32_t)(tzLocalUs(utcUs) / 1000000LL));
+  snprintf(timeStr, size, "%02d:%02d:%02d", now.hour(), now.minute(), now.second());
+}
+
+// Function to serve an embedded page, or 304 if the client already has it
+// Gzip when the client accepts it, else the uncompressed copy; each has its
+// own ETag, and Vary tells caches the choice depends on Accept-Encoding.
+void serveWebAsset(HttpRequest &request, const WebAsset &asset) {
+  bool gzip = request.acceptsEncoding("gzip");
+  const char *etag = gzip ? asset.etag : asset.plainEtag;
+  char headers[192];
+  snprintf(headers, sizeof(headers), "ETag: %s\r\nCache-Control: %s\r\nVary: Accept-Encoding\r\n",
+           etag, WEB_ASSET_CACHE_CONTROL);
+
+  if (strcmp(request.ifNoneMatch, etag) == 0) {
+    request.send(304, asset.contentType, "", headers);
+    return;
+  }
 
-    xSemaphoreGive(displayMutex);
+  if (!gzip) {
+    LOGI("[WebServer] GET %s - %u bytes uncompressed", asset.path, (unsigned)asset.plainLength);
+    request.sendStatic(200, asset.contentType, asset.plain, asset.plainLength, headers);
+    return;
   }
+  LOGI("[WebServer] GET %s - %u bytes gzipped", asset.path, (unsigned)asset.length);
+  strncat(headers, "Content-Encoding: gzip\r\n", sizeof(headers) - strlen(headers) - 1);
+  request.sendStatic(200, asset.contentType, asset.gzip, asset.length, headers);
 }
 
+// Function to push the current time to all SSE subscribers
+// Called from the WiFi task loop; sends at most one event per second, formatted
+// once from a single clock snapshot however many pages are open.
+void pushTimeEvents() {
+  static uint32_t lastPushed = 0;
+  uint32_t nowS = softClockNow();
+  if (nowS == lastPushed || timeEvents.count() == 0) {
+    return;
+  }
+  lastPushed = nowS;
+
+  char timeStr[20];
+  formatLocalTime((int64_t)nowS * 1000000LL, timeStr, sizeof(timeStr));
+  timeEvents.broadcast("time", timeStr);
+}
+
+// Function to register the web handlers and start the server
+// Called once, the first time WiFi comes up (after any config portal has
+// released port 80). Handlers run on the AsyncTCP task, never in the WiFi
+// task loop, so requests do not hold up NTP and vice versa.
+void startWebServer() {
+  LOGI("[WebServer] Initializing web server...");
+
+  // Static pages from web/, gzipped at build time by tools/embed_web.py
+  for (size_t i = 0; i < WEB_ASSET_COUNT; i++) {
+    const WebAsset *asset = &webAssets[i];
+    server.on(asset->path, HTTP_METHOD_GET, [asset](HttpRequest &request) {
+      serveWebAsset(request, *asset);
+    });
+  }
+
+  // Get current time endpoint (served from the in-memory clock, no I2C)
+  server.on("/getTime", HTTP_METHOD_GET, [](HttpRequest &request) {
+    char timeStr[20];
+    formatLocalTime(softClockNowUs(), timeStr, sizeof(timeStr));
+    request.send(200, "text/plain", timeStr);
+  });
+
+  // Time pushed once per second (Server-Sent Events)
+  server.on("/events", HTTP_METHOD_GET, [](HttpRequest &request) {
+    timeEvents.add(request.detach());
+  });
+
+  // Sync state and diagnostics (published snapshot, never waits on a sync)
+  server.on("/syncStatus", HTTP_METHOD_GET, [](HttpRequest &request) {
+    TimeSyncStatus status = timeServiceStatus();
+    char json[384];
+    snprintf(json, sizeof(json),
+             "{\"state\":\"%s\",\"attempts\":%lu,\"successes\":%lu,"
+             "\"last_success\":%lu,\"last_error\":%s%s%s,"
+             "\"offset_ms\":%ld,\"delay_ms\":%ld,\"rtc_drift_ppm\":%.2f,"
+             "\"rtc_residual_us\":%ld,\"next_sync_min\":%lu,"
+             "\"last_posted\":%lu,\"last_completed\":%lu}",
+             status.state == TIME_SYNC_IN_PROGRESS ? "in_progress" : "idle",
+             (unsigned long)status.attempts, (unsigned long)status.successes,
+             (unsigned long)status.lastSuccessEpoch,
+             status.lastError ? "\"" : "", status.lastError ? status.lastError : "null",
+             status.lastError ? "\"" : "",
+             (long)status.lastOffsetMs, (long)status.lastRttMs, status.rtcDriftPpm,
+             (long)status.rtcResidualUs, (unsigned long)status.nextSyncMin,
+             (unsigned long)status.lastPostedId, (unsigned long)status.lastCompletedId);
+    request.send(200, "application/json", json);
+  });
+
+  // Queue an NTP sync; returns the command id to watch in /syncStatus
+  server.on("/sync", HTTP_METHOD_POST, [](HttpRequest &request) {
+    uint32_t id = timeServicePost(TIME_CMD_SYNC_NOW);
+    if (id == 0) {
+      request.send(503, "application/json", "{\"error\":\"queue full\"}");
+      return;
+    }
+    char json[32];
+    snprintf(json, sizeof(json), "{\"id\":%lu}", (unsigned long)id);
+    request.send(202, "application/json", json);
+  });
+
+  // Set the time by hand (param: epoch, Unix time in UTC seconds; the zone
+  // only applies on display, so the client does no local conversion)
+  server.on("/setTime", HTTP_METHOD_POST, [](HttpRequest &request) {
+    char epochStr[16];
+    if (!request.arg("epoch", epochStr, sizeof(epochStr))) {
+      request.send(400, "application/json", "{\"error\":\"missing epoch\"}");
+      return;
+    }
+    TimeCommand command = {};
+    command.type = TIME_CMD_SET_MANUAL;
+    command.epoch = strtoul(epochStr, NULL, 10);
+    uint32_t id = timeServicePost(command);
+    if (id == 0) {
+      request.send(503, "application/json", "{\"error\":\"queue full\"}");
+      return;
+    }
+    char json[32];
+    snprintf(json, sizeof(json), "{\"id\":%lu}", (unsigned long)id);
+    request.send(202, "application/json", json);
+  });
+
+  // Set the display brightness (param: level, 0-7), stored in NVS
+  server.on("/setBrightness", HTTP_METHOD_POST, [](HttpRequest &request) {
+    char levelStr[8];
+    if (!request.arg("level", levelStr, sizeof(levelStr))) {
+      request.send(400, "application/json", "{\"error\":\"missing level\"}");
+      return;
+    }
+    TimeCommand command = {};
+    command.type = TIME_CMD_SET_BRIGHTNESS;
+    command.brightness = (uint8_t)constrain(atoi(levelStr), 0, 7);
+    uint32_t id = timeServicePost(command);
+    if (id == 0) {
+      request.send(503, "application/json", "{\"error\":\"queue full\"}");
+      return;
+    }
+    char json[32];
+    snprintf(json, sizeof(json), "{\"id\":%lu}", (unsigned long)id);
+    request.send(202, "application/json", json);
+  });
+
+  // Power settings (params, each optional: low_power 0/1, night_level 0-7,
+  // night_from and night_to in local hours), stored in NVS
+  server.on("/setPower", HTTP_METHOD_POST, [](HttpRequest &request) {
+    ClockConfig config;
+    configGet(config);
+    TimeCommand command = {};
+    command.type = TIME_CMD_SET_POWER;
+    command.power = config.power;
+    char value[8];
+    if (request.arg("low_power", value, sizeof(value))) {
+      command.power.lowPower = atoi(value) != 0;
+    }
+    if (request.arg("night_level", value, sizeof(value))) {
+      command.power.nightLevel = (uint8_t)constrain(atoi(value), 0, 7);
+    }
+    if (request.arg("night_from", value, sizeof(value))) {
+      command.power.nightFrom = (uint8_t)constrain(atoi(value), 0, 23);
+    }
+    if (request.arg("night_to", value, sizeof(value))) {
+      command.power.nightTo = (uint8_t)constrain(atoi(value), 0, 23);
+    }
+    uint32_t id = timeServicePost(command);
+    if (id == 0) {
+      request.send(503, "application/json", "{\"error\":\"queue full\"}");
+      return;
+    }
+    char json[32];
+    snprintf(json, sizeof(json), "{\"id\":%lu}", (unsigned long)id);
+    request.send(202, "application/json", json);
+  });
+
+  // Power mode, modem sleep state and estimated energy per subsystem
+  server.on("/power", HTTP_METHOD_GET, [](HttpRequest &request) {
+    static char json[640];
+    powerToJson(json, sizeof(json));
+    request.send(200, "application/json", json);
+  });
+
+  // Task stacks, CPU, heap, PSRAM, energy and NTP server (Prometheus text)
+  // The full task list is larger than the TCP send buffer, so the body is
+  // streamed as the client acknowledges it; a second scrape in the meantime
+  // is asked to retry rather than overwrite the buffer.
+  server.on("/metrics", HTTP_METHOD_GET, [](HttpRequest &request) {
+    static char body[METRICS_BODY_SIZE];  // Handlers only run in the AsyncTCP task
+    static bool sending = false;
+    if (sending) {
+      request.send(503, "text/plain", "busy", "Retry-After: 1\r\n");
+      return;
+    }
+    size_t length = runtimeStatsToPrometheus(body, sizeof(body));
+    length += powerToPrometheus(body + length, sizeof(body) - length);
+#if CLOCK_SNTP_SERVER
+    length += sntpServerToPrometheus(body + length, sizeof(body) - length);
+#endif
+    if (length >= sizeof(body) - 1) {
+      LOGW("[WebServer] ⚠ /metrics truncated at %u bytes", (unsigned)sizeof(body));
+    }
+    request.sendBuffer(200, "text/plain; version=0.0.4", body, length, sending);
+  });
+
+  // Last hour of heap, PSRAM and core load samples
+  server.on("/metrics/history", HTTP_METHOD_GET, [](HttpRequest &request) {
+    static char json[2048];
+    runtimeStatsHistoryToJson(json, sizeof(json));
+    request.send(200, "application/json", json);
+  });
+
+#if CLOCK_LATENCY
+  // Hot-path latency histograms since boot
+  server.on("/latency", HTTP_METHOD_GET, [](HttpRequest &request) {
+    static char json[4096];
+    latencyToJson(json, sizeof(json));
+    request.send(200, "application/json", json);
+  });
+#endif
+
+  // Hardware diagnostics and boot phase timestamps
+  server.on("/diag", HTTP_METHOD_GET, [](HttpRequest &request) {
+    char json[640];
+    bootDiagToJson(json, sizeof(json));
+    request.send(200, "application/json", json);
+  });
+
+  // Current zone, UTC offset and next DST transition
+  server.on("/zone", HTTP_METHOD_GET, [](HttpRequest &request) {
+    char tz[TZ_POSIX_MAX];
+    tzGet(tz, sizeof(tz));
+    TzInfo info;
+    tzInfoAt(softClockNowUs(), info);
+    char json[160];
+    snprintf(json, sizeof(json),
+             "{\"tz\":\"%s\",\"offset_s\":%ld,\"dst\":%s,\"next_transition\":%lld}",
+             tz, (long)info.offsetS, info.dst ? "true" : "false",
+             info.nextTransitionUs == INT64_MAX ? 0LL
+                                                : (long long)(info.nextTransitionUs / 1000000LL));
+    request.send(200, "application/json", json);
+  });
+
+  // Set timezone endpoint (param: tz, a POSIX TZ string; or the older
+  // timezone, whole hours east of UTC)
+  server.on("/setTimezone", HTTP_METHOD_POST, [](HttpRequest &request) {
+    LOGI("[WebServer] POST /setTimezone - Timezone change request");
+    TimeCommand command = {};
+    command.type = TIME_CMD_SET_ZONE;
+    char hoursStr[8];
+    if (request.arg("tz", command.zone, sizeof(command.zone))) {
+      // Used as given
+    } else if (request.arg("timezone", hoursStr, sizeof(hoursStr)) &&
+               atoi(hoursStr) >= -12 && atoi(hoursStr) <= 14) {
+      tzFromUtcOffsetHours(atoi(hoursStr), command.zone, sizeof(command.zone));
+    } else {
+      LOGE("[WebServer] ✗ Missing timezone parameter");
+      request.send(400, "text/html", "<html><body><h1>Missing timezone parameter</h1><a href='/'>Back</a></body></html>");
+      return;
+    }
+
+    if (!tzValid(command.zone)) {
+      LOGE("[WebServer] ✗ Invalid timezone value: %s", command.zone);
+      request.send(400, "text/html", "<html><body><h1>Invalid timezone</h1><a href='/'>Back</a></body></html>");
+      return;
+    }
+
+    // Applied by the time-service task; no clock change or NTP round needed
+    LOGI("[CONFIG] Timezone Change Requested: %s", command.zone);
+    if (timeServicePost(command) == 0) {
+      request.send(503, "text/html", "<html><body><h1>Busy, try again</h1><a href='/'>Back</a></body></html>");
+      return;
+    }
+    request.send(200, "text/html", "<html><body><h1>Timezone updated!</h1><a href='/'>Back</a></body></html>");
+  });
+
+  timeEvents.begin();
+  server.begin();
+  LOGI("[WebServer] ✓ Web server started (max %u connections)", (unsigned)HTTP_MAX_CONNECTIONS);
+  LOGI("[WebServer] → Access at: http://%s", WiFi.localIP().toString().c_str());
+}
+
+// WiFi bring-up states, driven from the WiFi task loop
+enum WifiLinkState {
+  LINK_PORTAL,             // Config portal open (or connecting)
+  LINK_CONNECTED_PENDING,  // Just connected, start services
+  LINK_CONNECTED,
+  LINK_OFFLINE             // No WiFi; clock runs from the RTC
+};
+
 // WiFi Task - Runs on Core 0
 void wifiTask(void *parameter) {
-  Serial.println("[WiFi] Task starting on Core 0...");
-  Serial.println("[WiFi] Initializing WiFiManager...");
+  LOGI("[WiFi] Task starting on Core 0...");
+  LOGI("[WiFi] Initializing WiFiManager...");
 
-  // Initialize WiFiManager
+  // Initialize WiFiManager in non-blocking mode: the portal (if needed) is
+  // serviced from the loop below, so time keeps running from the RTC and
+  // the display is never held up by provisioning
   WiFiManager wifiManager;
+  wifiManager.setConfigPortalBlocking(false);
   wifiManager.setConfigPortalTimeout(180); // 3 minutes timeout
-  Serial.println("[WiFi] Configuration portal timeout: 180 seconds");
+  LOGI("[WiFi] Configuration portal timeout: 180 seconds");
 
   // Set callback for when entering AP mode
   wifiManager.setAPCallback([](WiFiManager *myWiFiManager) {
-    Serial.println();
-    Serial.println("╔════════════════════════════════════════════════╗");
-    Serial.println("║     WiFi Configuration Portal Started          ║");
-    Serial.println("╚════════════════════════════════════════════════╝");
-    Serial.println();
-    Serial.println("[WiFi] No saved credentials or connection failed");
-    Serial.println("[WiFi] Starting Access Point mode...");
+    LOG_BANNER("╔════════════════════════════════════════════════╗");
+    LOG_BANNER("║     WiFi Configuration Portal Started          ║");
+    LOG_BANNER("╚════════════════════════════════════════════════╝");
+    LOGI("[WiFi] No saved credentials or connection failed");
+    LOGI("[WiFi] Starting Access Point mode...");
 
     // Print QR code for easy connection
     printWiFiQR("ClockSetup", "clock1234");
+    showStatus(ANIMATION_CONFIG_PORTAL);
 
-    Serial.println("[WiFi] → Connect to the WiFi AP to configure");
-    Serial.print("[WiFi] → AP SSID: ClockSetup\n");
-    Serial.print("[WiFi] → AP Password: clock1234\n");
-    Serial.print("[WiFi] → AP IP address: ");
-    Serial.println(WiFi.softAPIP());
-    Serial.println("[WiFi] → Portal will timeout after 3 minutes");
-    Serial.println();
+    LOGI("[WiFi] → Connect to the WiFi AP to configure");
+    LOGI("[WiFi] → AP SSID: ClockSetup");
+    LOGI("[WiFi] → AP Password: clock1234");
+    LOGI("[WiFi] → AP IP address: %s", WiFi.softAPIP().toString().c_str());
+    LOGI("[WiFi] → Portal will timeout after 3 minutes");
   });
 
   // Try to connect to WiFi
-  Serial.println();
-  Serial.println("[WiFi] Attempting to connect to WiFi...");
-  Serial.println("[WiFi] Checking for saved credentials...");
-
-  if (wifiManager.autoConnect("ClockSetup", "clock1234")) {
-    Serial.println();
-    Serial.println("[WiFi] ✓ Successfully connected to WiFi!");
-    Serial.print("[WiFi] → SSID: ");
-    Serial.println(WiFi.SSID());
-    Serial.print("[WiFi] → IP address: ");
-    Serial.println(WiFi.localIP());
-    Serial.print("[WiFi] → Gateway: ");
-    Serial.println(WiFi.gatewayIP());
-    Serial.print("[WiFi] → Subnet: ");
-    Serial.println(WiFi.subnetMask());
-    Serial.print("[WiFi] → DNS: ");
-    Serial.println(WiFi.dnsIP());
-    Serial.print("[WiFi] → Signal Strength (RSSI): ");
-    Serial.print(WiFi.RSSI());
-    Serial.println(" dBm");
-    Serial.println();
-    wifiConnected = true;
-
-    // Initialize NTP client
-    Serial.println("[NTP] Initializing NTP client...");
-    timeClient.begin();
-    Serial.println("[NTP] ✓ NTP client initialized");
-
-    // Sync time from NTP
-    syncTimeFromNTP();
-  } else {
-    Serial.println();
-    Serial.println("[WiFi] ✗ Failed to connect to WiFi");
-    Serial.println("[WiFi] Portal timeout or connection failed");
-    Serial.println("[WiFi] Continuing with RTC time only...");
-    Serial.println();
-    wifiConnected = false;
-
-    // Even without WiFi, signal that we should display the RTC time
-    timeReady = true;
-  }
+  LOGI("[WiFi] Attempting to connect to WiFi...");
+  LOGI("[WiFi] Checking for saved credentials...");
 
-  // Setup web server
-  if (wifiConnected) {
-    Serial.println("[WebServer] Initializing web server...");
+  WifiLinkState wifiState = wifiManager.autoConnect("ClockSetup", "clock1234")
+                            ? LINK_CONNECTED_PENDING
+                            : LINK_PORTAL;
+  bool webServerStarted = false;
+#if CLOCK_SNTP_SERVER
+  bool sntpServerListening = false;
+#endif
 
-    // Root page
-    server.on("/", HTTP_GET, []() {
-      Serial.println("[WebServer] GET / - Serving configuration page");
-      server.send_P(200, "text/html", index_html);
-    });
+  // Main WiFi task loop
+  unsigned long loopCount = 0;
+  while (true) {
+    switch (wifiState) {
+      case LINK_PORTAL:
+        // process() serves the portal and returns true once connected
+        if (wifiManager.process() || WiFi.status() == WL_CONNECTED) {
+          wifiState = LINK_CONNECTED_PENDING;
+        } else if (!wifiManager.getConfigPortalActive()) {
+          LOGE("[WiFi] ✗ Failed to connect to WiFi");
+          LOGI("[WiFi] Portal timeout or connection failed");
+          LOGI("[WiFi] Continuing with RTC time only...");
+          wifiState = LINK_OFFLINE;
+
+          // Even without WiFi, signal that we should display the RTC time
+          signalTimeReady();
+        }
+        break;
+
+      case LINK_CONNECTED_PENDING:
+        LOGI("[WiFi] ✓ Successfully connected to WiFi!");
+        LOGI("[WiFi] → SSID: %s", WiFi.SSID().c_str());
+        LOGI("[WiFi] → IP address: %s", WiFi.localIP().toString().c_str());
+        LOGI("[WiFi] → Gateway: %s", WiFi.gatewayIP().toString().c_str());
+        LOGI("[WiFi] → Subnet: %s", WiFi.subnetMask().toString().c_str());
+        LOGI("[WiFi] → DNS: %s", WiFi.dnsIP().toString().c_str());
+        LOGI("[WiFi] → Signal Strength (RSSI): %d dBm", WiFi.RSSI());
+        wifiConnected.store(true, std::memory_order_release);
+        wifiState = LINK_CONNECTED;
+        bootMark(BOOT_WIFI_CONNECTED);
+
+        if (!webServerStarted) {
+          startWebServer();
+          webServerStarted = true;
+        }
 
-    // Get current time endpoint
-    server.on("/getTime", HTTP_GET, []() {
-      if (xSemaphoreTake(timeMutex, portMAX_DELAY) == pdTRUE) {
-        DateTime now = rtc.now();
-        char timeStr[20];
-        sprintf(timeStr, "%02d:%02d:%02d", now.hour(), now.minute(), now.second());
-        xSemaphoreGive(timeMutex);
-        server.send(200, "text/plain", timeStr);
-      }
-    });
+        // Sync time from NTP; the display is corrected in place
+        timeServicePost(TIME_CMD_SYNC_NOW);
+        break;
+
+      case LINK_CONNECTED:
+#if CLOCK_SNTP_SERVER
+        // Answers leap 3 until the first sync; clients need the radio awake.
+        // The bind completes in the tcpip thread and is retried if it fails.
+        if (!sntpServerListening && sntpServerBegin()) {
+          sntpServerListening = true;
+          powerKeepWifiAwake(true);
+        }
+#endif
+        if (WiFi.status() != WL_CONNECTED) {
+          LOGW("[WiFi] ⚠ Connection lost - showing RTC time until it returns");
+          wifiConnected.store(false, std::memory_order_release);
+          showStatus(ANIMATION_CONNECTING);
+          wifiState = LINK_OFFLINE;
+        }
+        break;
 
-    // Set timezone endpoint
-    server.on("/setTimezone", HTTP_POST, []() {
-      Serial.println("[WebServer] POST /setTimezone - Timezone change request");
-      if (server.hasArg("timezone")) {
-        String tzStr = server.arg("timezone");
-        int tz = tzStr.toInt();
-
-        if (tz >= -12 && tz <= 14) {
-          Serial.println();
-          Serial.println("[CONFIG] ═══════════════════════════════════════");
-          Serial.println("[CONFIG] Timezone Change Requested");
-          Serial.print("[CONFIG] → Old timezone: UTC");
-          if (timezoneOffset >= 0) Serial.print("+");
-          Serial.println(timezoneOffset);
-          Serial.print("[CONFIG] → New timezone: UTC");
-          if (tz >= 0) Serial.print("+");
-          Serial.println(tz);
-
-          saveTimezone(tz);
-          Serial.println("[CONFIG] ✓ Timezone saved to preferences");
-
-          // Request sync
-          syncRequested = true;
-          Serial.println("[CONFIG] → Requesting time sync with new timezone...");
-          Serial.println("[CONFIG] ═══════════════════════════════════════");
-
-          server.send(200, "text/html", "<html><body><h1>Timezone updated! Syncing time...</h1><a href='/'>Back</a></body></html>");
-        } else {
-          Serial.print("[WebServer] ✗ Invalid timezone value: ");
-          Serial.println(tz);
-          server.send(400, "text/html", "<html><body><h1>Invalid timezone</h1><a href='/'>Back</a></body></html>");
+      case LINK_OFFLINE:
+        // The WiFi driver keeps retrying saved credentials in the background
+        if (WiFi.status() == WL_CONNECTED) {
+          wifiState = LINK_CONNECTED_PENDING;
         }
-      } else {
-        Serial.println("[WebServer] ✗ Missing timezone parameter");
-        server.send(400, "text/html", "<html><body><h1>Missing timezone parameter</h1><a href='/'>Back</a></body></html>");
-      }
-    });
+        break;
+    }
+
+    if (wifiConnected.load(std::memory_order_acquire)) {
+      pushTimeEvents();
+    }
+
+    // Modem sleep between NTP rounds and HTTP bursts (low-power mode)
+    powerService(wifiState == LINK_CONNECTED);
+
+    // Per-minute task, heap and PSRAM sample for /metrics
+    static unsigned long lastRuntimeSample = 0;
+    if (lastRuntimeSample == 0 || millis() - lastRuntimeSample >= RUNTIME_STATS_INTERVAL_MS) {
+      lastRuntimeSample = millis();
+      runtimeStatsSample();
+    }
+
+    // Hourly bus traffic report
+    static unsigned long lastStatsReport = 0;
+    if (millis() - lastStatsReport >= BUS_STATS_REPORT_INTERVAL_MS) {
+      lastStatsReport = millis();
+      busStatsReport();
+#if CLOCK_LATENCY
+      latencyReport();
+#endif
+    }
 
-    server.begin();
-    Serial.println("[WebServer] ✓ Web server started");
-    Serial.print("[WebServer] → Access at: http://");
-    Serial.println(WiFi.localIP());
-    Serial.println();
+    vTaskDelay(pdMS_TO_TICKS(10)); // Yield to other tasks
+    loopCount++;
+  }
+}
+
+// Function to pick the wait before retrying a failed sync: short at first,
+// doubling, never longer than the regular interval
+unsigned long nextSyncRetryMs(unsigned long retryMs) {
+  unsigned long nextMs = retryMs ? retryMs * 2 : NTP_RETRY_MIN_MS;
+  return nextMs < rtcDrift.syncIntervalMs ? nextMs : rtcDrift.syncIntervalMs;
+}
+
+// Time-service task - runs on Core 0
+// Owns NTP and every clock/RTC update. Commands arrive through the time
+// service queue and run one at a time; sync requests that arrive while a
+// round is in flight join it and complete with it.
+void timeTask(void *parameter) {
+  LOGI("[TIME] Time-service task started on Core %d", xPortGetCoreID());
+
+  TimeCommand waiting[TIME_COMMAND_QUEUE_LENGTH];
+  size_t waitingCount = 0;
+  bool roundStale = false;  // Clock was stepped while replies were outstanding
+  unsigned long lastSync = millis();     // Last successful sync
+  unsigned long lastAttempt = millis();  // Last round started
+  unsigned long retryMs = 0;             // Backoff after a failure, 0 after a success
+  unsigned long lastDriftCheck = millis();
+  syncStatus.nextSyncMin = rtcDrift.syncIntervalMs / 60000;
+  timeServicePublish(syncStatus);
+
+  // The display task may have initialized before the settings were loaded
+  ClockConfig config;
+  configGet(config);
+  postDisplayCommand(DISPLAY_CMD_BRIGHTNESS, config.brightness);
+
+  if (configRtcLocalOffsetS() != 0) {
+    migrateRtcToUtc();
   }
 
-  // Main WiFi task loop
-  unsigned long loopCount = 0;
   while (true) {
-    if (wifiConnected) {
-      server.handleClient();
-
-      // Handle sync requests
-      if (syncRequested) {
-        syncRequested = false;
-        Serial.println("[WiFi] Processing time sync request...");
-        syncTimeFromNTP();
+    // Poll faster while NTP replies are outstanding so T4 is stamped promptly
+    TimeCommand command;
+    TickType_t wait = sntp.busy() ? pdMS_TO_TICKS(1) : pdMS_TO_TICKS(1000);
+    if (timeServiceReceive(command, wait)) {
+      switch (command.type) {
+        case TIME_CMD_SYNC_NOW: {
+          LOGI("[TIME] → Sync requested (#%lu)", (unsigned long)command.id);
+          bool running = sntp.busy() || syncTimeFromNTP();
+          if (!running) {
+            lastAttempt = millis();
+            retryMs = nextSyncRetryMs(retryMs);
+          }
+          if (running && waitingCount < TIME_COMMAND_QUEUE_LENGTH) {
+            waiting[waitingCount++] = command;
+          } else {
+            timeServiceComplete(command);
+          }
+          break;
+        }
+
+        case TIME_CMD_SET_ZONE:
+          applyTimezone(command.zone);
+          timeServiceComplete(command);
+          break;
+
+        case TIME_CMD_SET_MANUAL:
+          roundStale |= sntp.busy();
+          setManualTime(command.epoch);
+          timeServicePublish(syncStatus);
+          timeServiceComplete(command);
+          break;
+
+        case TIME_CMD_SET_BRIGHTNESS:
+          LOGI("[CONFIG] → Brightness now %u/7", (unsigned)command.brightness);
+          configSetBrightness(command.brightness);
+          postDisplayCommand(DISPLAY_CMD_BRIGHTNESS, command.brightness);
+          timeServiceComplete(command);
+          break;
+
+        case TIME_CMD_SET_POWER:
+          configSetPower(command.power);
+          powerConfigure(command.power);
+          timeServiceComplete(command);
+          break;
       }
+    }
 
-      // Periodic NTP sync every hour
-      static unsigned long lastSync = 0;
-      if (millis() - lastSync > 3600000) {
+    // Collect NTP replies; apply the result once the round is done
+    SntpResult ntpResult;
+    if (sntp.poll(ntpResult)) {
+      bool restarted = false;
+      if (roundStale) {
+        // T1 and T4 straddle the step, so the result is meaningless
+        roundStale = false;
+        LOGW("[NTP] ⚠ Clock changed during the round, restarting");
+        restarted = syncTimeFromNTP();
+      } else if (finishNtpSync(ntpResult)) {
         lastSync = millis();
-        Serial.println();
-        Serial.println("[NTP] ═══════════════════════════════════════");
-        Serial.println("[NTP] Periodic sync triggered (hourly)");
-        Serial.println("[NTP] ═══════════════════════════════════════");
-        syncTimeFromNTP();
+        retryMs = 0;
+      } else {
+        lastAttempt = millis();
+        retryMs = nextSyncRetryMs(retryMs);
+      }
+      if (!restarted) {
+        for (size_t i = 0; i < waitingCount; i++) {
+          timeServiceComplete(waiting[i]);
+        }
+        waitingCount = 0;
       }
     }
 
-    vTaskDelay(pdMS_TO_TICKS(10)); // Yield to other tasks
-    loopCount++;
+    // Periodic NTP sync, interval adapts to the measured RTC drift; after a
+    // failure, retry on the backoff instead of waiting a whole interval
+    bool syncDue = retryMs ? millis() - lastAttempt > retryMs
+                           : millis() - lastSync > rtcDrift.syncIntervalMs;
+    if (wifiConnected.load(std::memory_order_acquire) && !sntp.busy() && syncDue) {
+      lastAttempt = millis();
+      LOG_BANNER("[NTP] ═══════════════════════════════════════");
+      if (retryMs) {
+        LOGI("[NTP] Retrying sync (after %lu s)", retryMs / 1000);
+      } else {
+        LOGI("[NTP] Periodic sync triggered (every %lu min)",
+             (unsigned long)(rtcDrift.syncIntervalMs / 60000));
+      }
+      LOG_BANNER("[NTP] ═══════════════════════════════════════");
+      if (!syncTimeFromNTP()) {
+        retryMs = nextSyncRetryMs(retryMs);
+      }
+    }
+
+    // Periodically compare the in-memory clock against the RTC
+    if (!sntp.busy() && millis() - lastDriftCheck >= RTC_DRIFT_CHECK_INTERVAL_MS) {
+      lastDriftCheck = millis();
+      checkRtcDrift();
+    }
+
+    // Write back changed settings once they have settled
+    configService();
   }
 }
 
+#ifdef CLOCK_BENCH
+// Benchmark cases for the display, formatting and web hot paths
+// Inputs change between calls so the framebuffer actually has work to do.
+static void benchDisplayTime() {
+  static uint32_t call = 0;
+  call++;
+  displayTime(12, (call / 2) % 60, call & 1);
+}
+
+// Alternates two sequences so every call pushes a frame
+static void benchAnimationFrame() {
+  static uint32_t call = 0;
+  call++;
+  stepAnimation((call & 1) ? ANIMATION_NTP_SYNC : ANIMATION_CONNECTING);
+}
+
+#if CLOCK_EXTRA_DISPLAYS
+// Full frame on every extra display (the hour digits change each call)
+static void benchExtraDisplays() {
+  static uint32_t call = 0;
+  call++;
+  for (uint8_t i = 0; i < extraBank.count(); i++) {
+    extraBank.setTime(i, call % 24, 0, call & 1);
+  }
+  extraBank.flush();
+}
+#endif
+
+// The /getTime handler's body, without the send: that needs a connected
+// AsyncClient and is timed on the device by the http_handler latency probe
+static void benchGetTimeBody() {
+  char timeStr[20];
+  formatLocalTime(softClockNowUs(), timeStr, sizeof(timeStr));
+  asm volatile("" : : "r"(timeStr) : "memory");
+}
+
+static void benchWiFiQR() {
+  printWiFiQR("ClockSetup", "clock1234");
+}
+
+// DateTime conversion and formatting done by syncTimeFromNTP
+static void benchNtpConversion() {
+  static uint32_t epochTime = 1700000000;
+  DateTime dt = DateTime(epochTime++);
+  char timeStr[20];
+  sprintf(timeStr, "%02d:%02d:%02d", dt.hour(), dt.minute(), dt.second());
+  sprintf(timeStr, "%04d-%02d-%02d", dt.year(), dt.month(), dt.day());
+  asm volatile("" : : "r"(timeStr) : "memory");
+}
+
+void runBenchmarks() {
+  LOGI("[BENCH] Running microbenchmarks...");
+  benchBegin();
+  benchRun("displayTime", 1000, benchDisplayTime);
+  benchRun("animationFrame", 1000, benchAnimationFrame);
+#if CLOCK_EXTRA_DISPLAYS
+  benchRun("extraDisplays", 100, benchExtraDisplays);
+#endif
+  benchRun("getTimeBody", 1000, benchGetTimeBody);
+  benchRun("printWiFiQR", 5, benchWiFiQR);
+  benchRun("ntpConversion", 10000, benchNtpConversion);
+  LOGI("[BENCH] ✓ Done");
+}
+#endif
+
 // Display Task - Runs on Core 1
 void displayTask(void *parameter) {
-  Serial.println("[Display] Task starting on Core 1...");
-  Serial.println();
+  LOGI("[Display] Task starting on Core 1...");
 
   // Initialize I2C
-  Serial.println("[I2C] Initializing I2C bus...");
-  Serial.print("[I2C] → SDA Pin: ");
-  Serial.println(SDA_PIN);
-  Serial.print("[I2C] → SCL Pin: ");
-  Serial.println(SCL_PIN);
+  LOGI("[I2C] Initializing I2C bus...");
+  LOGI("[I2C] → SDA Pin: %d", SDA_PIN);
+  LOGI("[I2C] → SCL Pin: %d", SCL_PIN);
   Wire.begin(SDA_PIN, SCL_PIN);
-  Serial.println("[I2C] ✓ I2C initialized");
-  Serial.println();
+  LOGI("[I2C] ✓ I2C initialized");
 
   // Initialize TM1637 display
-  Serial.println("[Display] Initializing TM1637 display...");
+  LOGI("[Display] Initializing TM1637 display...");
   display.begin();
-  display.setBrightness(7); // 0-7 brightness level
-  Serial.println("[Display] → Brightness level: 7/7");
-  display.clearScreen();
-  Serial.println("[Display] ✓ TM1637 display initialized");
-  Serial.println();
+  ClockConfig config;
+  configGet(config);
+  displayBrightness = config.brightness;
+  display.setBrightness(config.brightness); // 0-7 brightness level
+  LOGI("[Display] → Brightness level: %u/7", (unsigned)config.brightness);
+  display.clear();
+  display.flush();
+  LOGI("[Display] ✓ TM1637 display initialized");
+#if CLOCK_EXTRA_DISPLAYS
+  beginExtraDisplays(config.brightness);
+#endif
 
   // Initialize RTC
-  Serial.println("[RTC] Initializing DS1307 RTC module...");
+  LOGI("[RTC] Initializing DS1307 RTC module...");
+  busStatsCountI2c();
   if (!rtc.begin()) {
-    Serial.println("[RTC] ✗ ERROR: Couldn't find RTC module!");
-    Serial.println("[RTC] → Check I2C connections");
-    Serial.println("[RTC] → Expected address: 0x68");
+    LOGE("[RTC] ✗ ERROR: Couldn't find RTC module!");
+    LOGI("[RTC] → Check I2C connections");
+    LOGI("[RTC] → Expected address: 0x68");
     while (1) {
-      vTaskDelay(pdMS_TO_TICKS(10));
+      vTaskDelay(stepAnimation(ANIMATION_RTC_FAILURE));
     }
   }
-  Serial.println("[RTC] ✓ RTC module found");
+  LOGI("[RTC] ✓ RTC module found");
 
+  busStatsCountI2c();
   if (!rtc.isrunning()) {
-    Serial.println("[RTC] ⚠ RTC is NOT running");
-    Serial.println("[RTC] → Setting default time: 2024-01-01 00:00:00");
+    LOGW("[RTC] ⚠ RTC is NOT running");
+    LOGI("[RTC] → Setting default time: 2024-01-01 00:00:00");
     // Set to Jan 1, 2024 00:00:00 as default
-    rtc.adjust(DateTime(2024, 1, 1, 0, 0, 0));
-    Serial.println("[RTC] ✓ Default time set");
+    DateTime defaultTime(2024, 1, 1, 0, 0, 0);
+    rtc.adjust(defaultTime);
+    busStatsCountI2c();
+    softClockSet((int64_t)defaultTime.unixtime() * 1000000LL);
+    LOGI("[RTC] ✓ Default time set");
   } else {
-    Serial.println("[RTC] ✓ RTC is running");
-    if (xSemaphoreTake(timeMutex, portMAX_DELAY) == pdTRUE) {
-      DateTime now = rtc.now();
-      char timeStr[20];
-      sprintf(timeStr, "%04d-%02d-%02d %02d:%02d:%02d",
-              now.year(), now.month(), now.day(),
-              now.hour(), now.minute(), now.second());
-      Serial.print("[RTC] → Current RTC time: ");
-      Serial.println(timeStr);
-      xSemaphoreGive(timeMutex);
-    }
-  }
-
-  Serial.println();
-  Serial.println("[Display] ═══════════════════════════════════════");
-  Serial.println("[Display] All hardware initialized successfully!");
-  Serial.println("[Display] ═══════════════════════════════════════");
-  Serial.println();
-
-  // Animation state
-  int animationFrame = 0;
-  unsigned long lastAnimationUpdate = 0;
-  const int animationDelay = 80; // milliseconds between animation frames
-
-  // Keep showing spinning animation until time is ready
-  Serial.println("[Display] Starting loading animation...");
-  Serial.println("[Display] → Waiting for WiFi connection and time sync...");
-  while (!timeReady) {
-    unsigned long currentMillis = millis();
-    if (currentMillis - lastAnimationUpdate >= animationDelay) {
-      lastAnimationUpdate = currentMillis;
-
-      // Acquire display mutex and show next animation frame
-      if (xSemaphoreTake(displayMutex, portMAX_DELAY) == pdTRUE) {
-        animationFrame = showSpinningFrame(animationFrame);
-        xSemaphoreGive(displayMutex);
-      }
+    LOGI("[RTC] ✓ RTC is running");
+    DateTime now = readRtc();
+    // NTP may already have seeded the clock while we were initializing
+    if (!softClockValid()) {
+      softClockSet((int64_t)now.unixtime() * 1000000LL);
     }
-
-    vTaskDelay(pdMS_TO_TICKS(10)); // Yield to other tasks
+    LOGI("[RTC] → Current RTC time: %04d-%02d-%02d %02d:%02d:%02d UTC",
+         now.year(), now.month(), now.day(),
+         now.hour(), now.minute(), now.second());
+
+    // A running RTC already holds valid time: show it right away instead
+    // of waiting for WiFi and NTP, which correct it in place later
+    LOGI("[Display] → RTC time is valid, showing it immediately");
+    signalTimeReady();
+  }
+  LOGI("[RTC] ✓ In-memory clock seeded");
+
+  // Hand the I2C bus to the time-service task
+  rtcReady.store(true, std::memory_order_release);
+
+  LOG_BANNER("[Display] ═══════════════════════════════════════");
+  LOGI("[Display] All hardware initialized successfully!");
+  bootMark(BOOT_HARDWARE_READY);
+  LOG_BANNER("[Display] ═══════════════════════════════════════");
+
+#ifdef CLOCK_BENCH
+  runBenchmarks();
+#endif
+
+  // Show the status animation until time is ready
+  // Sleeps until the next keyframe is due; showStatus() and
+  // signalTimeReady() wake us early.
+  LOGI("[Display] Starting status animation...");
+  LOGI("[Display] → Waiting for WiFi connection and time sync...");
+  while (!timeReady.load(std::memory_order_acquire)) {
+    applyDisplayCommands();
+    AnimationId status = (AnimationId)statusAnimation.load(std::memory_order_acquire);
+    ulTaskNotifyTake(pdTRUE, stepAnimation(status));
   }
 
   // Clear display and prepare for time display
-  Serial.println();
-  Serial.println("[Display] ═══════════════════════════════════════");
-  Serial.println("[Display] Time ready! Starting clock display...");
-  Serial.println("[Display] ═══════════════════════════════════════");
-  Serial.println();
-  if (xSemaphoreTake(displayMutex, portMAX_DELAY) == pdTRUE) {
-    display.clearScreen();
-    xSemaphoreGive(displayMutex);
-  }
+  LOG_BANNER("[Display] ═══════════════════════════════════════");
+  LOGI("[Display] Time ready! Starting clock display...");
+  LOG_BANNER("[Display] ═══════════════════════════════════════");
+#if !CLOCK_FAST_BOOT
+  display.clear();
+  display.flush();
   delay(200);
+#endif
 
   // Main display task loop - show time
+  // Wakes twice per second on the half-second edges of the in-memory clock
+  // (or early when notified), instead of polling. Nothing here waits on
+  // core 0: time and zone are read through sequence counters, commands
+  // arrive through a lock-free queue, and the RTC belongs to the time task.
+  int64_t frameDueUs = 0;  // Edge the task last slept until, 0 if woken early
   while (true) {
-    // Update display every 500ms
-    unsigned long currentMillis = millis();
-    if (currentMillis - lastDisplayUpdate >= 500) {
-      lastDisplayUpdate = currentMillis;
-
-      // Get current time from RTC
-      if (xSemaphoreTake(timeMutex, portMAX_DELAY) == pdTRUE) {
-        DateTime now = rtc.now();
-        xSemaphoreGive(timeMutex);
-
-        // Toggle colon state
-        colonState = !colonState;
-
-        // Display time
-        displayTime(now.hour(), now.minute(), colonState);
-      }
+    // Get current time from the in-memory clock (no I2C per frame); the zone
+    // offset is cached until the next DST transition
+    int64_t wakeUs = esp_timer_get_time();
+    int64_t clockUs = softClockNowUs();
+    if (frameDueUs != 0) {
+      busStatsRecordWait(BUS_WAIT_FRAME_LATE,
+                         clockUs > frameDueUs ? (uint32_t)(clockUs - frameDueUs) : 0);
+    }
+    // A tick-rounded sleep may end just short of the edge; draw the edge
+    int64_t nowUs = frameRenderUs(clockUs, frameDueUs);
+    applyDisplayCommands();
+    DateTime now((uint32_t)(tzLocalUs(nowUs) / 1000000LL));
+
+    // Colon is lit during the first half of every second
+    bool colon = frameColonLit(nowUs);
+
+    // Stored level, capped at night or in the dark; sent only when it changes
+    uint8_t brightness = powerBrightness(displayBrightness, now.hour());
+    display.setBrightness(brightness);
+#if CLOCK_EXTRA_DISPLAYS
+    extraBank.setBrightness(brightness);
+#endif
+
+    // Display time
+    displayTime(now.hour(), now.minute(), colon);
+#if CLOCK_EXTRA_DISPLAYS
+    showExtraDisplays(nowUs, colon);
+#endif
+    reportDisplayDraw();
+    busStatsRecordWait(BUS_WAIT_FRAME_RENDER, (uint32_t)(esp_timer_get_time() - wakeUs));
+    if (bootPhaseMs(BOOT_FIRST_FRAME) == 0) {
+      bootMark(BOOT_FIRST_FRAME);
+      LOGI("[BOOT] ✓ Cold boot to first frame: %lu ms",
+           (unsigned long)bootPhaseMs(BOOT_FIRST_FRAME));
     }
 
-    vTaskDelay(pdMS_TO_TICKS(10)); // Yield to other tasks
+    TickType_t wait = ticksUntilNextFrame(nowUs, frameDueUs);
+    if (ulTaskNotifyTake(pdTRUE, wait) != 0) {
+      frameDueUs = 0;  // Woken early on purpose; not a late frame
+    }
   }
 }
 
 void setup() {
+  bootMark(BOOT_SETUP_START);
+
+  // Power locks must exist before the display task's first transfer
+  powerBegin();
+
   // Initialize UART Serial
   Serial.begin(115200);
+#if !CLOCK_FAST_BOOT
   delay(1000); // Give serial time to initialize
+#endif
+
+  // Start the log drain task; everything below is buffered, not blocking
+  logBegin();
 
   // Very first diagnostic - if you don't see this, there's a hardware/boot issue
-  Serial.println("\n\n>>> ESP32-S3 Boot OK <<<");
-  Serial.flush();
+  LOGI(">>> ESP32-S3 Boot OK <<<");
+#if !CLOCK_FAST_BOOT
   delay(100);
+#endif
 
-  Serial.println("\n\n╔════════════════════════════════════════════════╗");
-  Serial.println("║         ESP32-S3 Clock - Starting Up           ║");
-  Serial.println("╚════════════════════════════════════════════════╝");
-  Serial.println();
-  Serial.flush();
-
-  // System Information
-  Serial.println("[SYSTEM] Hardware Information:");
-  Serial.flush();
-  Serial.print("  → Chip Model: ");
-  Serial.println(ESP.getChipModel());
-  Serial.print("  → CPU Cores: ");
-  Serial.println(ESP.getChipCores());
-  Serial.print("  → CPU Frequency: ");
-  Serial.print(ESP.getCpuFreqMHz());
-  Serial.println(" MHz");
-  Serial.print("  → Flash Size: ");
-  Serial.print(ESP.getFlashChipSize() / 1024 / 1024);
-  Serial.println(" MB");
-  Serial.print("  → Free Heap: ");
-  Serial.print(ESP.getFreeHeap() / 1024);
-  Serial.println(" KB");
-  Serial.flush();
-
-  // Check PSRAM
-  Serial.println("[SYSTEM] Checking PSRAM...");
-  Serial.flush();
-  if (psramFound()) {
-    Serial.print("  → PSRAM: ");
-    Serial.print(ESP.getPsramSize() / 1024);
-    Serial.print(" KB (Free: ");
-    Serial.print(ESP.getFreePsram() / 1024);
-    Serial.println(" KB)");
-  } else {
-    Serial.println("  → PSRAM: NOT FOUND");
-  }
-  Serial.flush();
+  LOG_BANNER("╔════════════════════════════════════════════════╗");
+  LOG_BANNER("║         ESP32-S3 Clock - Starting Up           ║");
+  LOG_BANNER("╚════════════════════════════════════════════════╝");
+
+  // Create Display task on Core 1 first: it only needs the RTC, so the
+  // first frame does not wait for NVS or WiFi
+  LOGI("[RTOS] Creating tasks...");
+  LOGI("[RTOS] → Creating Display Task on Core 1...");
+  xTaskCreatePinnedToCore(
+      displayTask,         // Task function
+      "Display Task",      // Task name
+      DISPLAY_TASK_STACK,  // Stack size (bytes)
+      NULL,                // Task parameters
+      1,                   // Priority
+      &displayTaskHandle,  // Task handle
+      CORE_DISPLAY         // Core 1
+  );
+  runtimeStatsRegisterTask(displayTaskHandle, DISPLAY_TASK_STACK);
+  bootMark(BOOT_DISPLAY_TASK_STARTED);
 
-  Serial.println();
-  Serial.println("[SYSTEM] FreeRTOS Configuration:");
-  Serial.println("  → Core 0: WiFi, NTP, Web Server");
-  Serial.println("  → Core 1: Display, RTC, Animation");
-  Serial.println();
-  Serial.flush();
+  LOGI("[SYSTEM] FreeRTOS Configuration:");
+  LOGI("  → Core 0: WiFi, Web Server, Time Service (NTP, RTC, drift check)");
+  LOGI("  → Core 1: Display, Animation");
 
   // Initialize NVS (Non-Volatile Storage)
-  Serial.println("[NVS] Initializing Non-Volatile Storage...");
+  LOGI("[NVS] Initializing Non-Volatile Storage...");
   esp_err_t err = nvs_flash_init();
   if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
     // NVS partition was truncated and needs to be erased
-    Serial.println("[NVS] ⚠ Partition needs to be erased");
-    Serial.println("[NVS] → Erasing NVS flash...");
+    LOGW("[NVS] ⚠ Partition needs to be erased");
+    LOGI("[NVS] → Erasing NVS flash...");
     err = nvs_flash_erase();
     if (err != ESP_OK) {
-      Serial.print("[NVS] ✗ Erase failed with error: 0x");
-      Serial.println(err, HEX);
+      LOGE("[NVS] ✗ Erase failed with error: 0x%x", err);
     } else {
-      Serial.println("[NVS] ✓ Erase successful");
+      LOGI("[NVS] ✓ Erase successful");
     }
-    Serial.println("[NVS] → Re-initializing...");
+    LOGI("[NVS] → Re-initializing...");
     err = nvs_flash_init();
   }
 
   if (err == ESP_OK) {
-    Serial.println("[NVS] ✓ Initialized successfully");
-
-    // Verify NVS is working by getting stats
-    nvs_stats_t nvs_stats;
-    if (nvs_get_stats(NULL, &nvs_stats) == ESP_OK) {
-      Serial.print("[NVS] → Used entries: ");
-      Serial.print(nvs_stats.used_entries);
-      Serial.print(" / ");
-      Serial.println(nvs_stats.total_entries);
-      Serial.print("[NVS] → Free entries: ");
-      Serial.println(nvs_stats.free_entries);
-      Serial.print("[NVS] → Namespace count: ");
-      Serial.println(nvs_stats.namespace_count);
-    }
+    LOGI("[NVS] ✓ Initialized successfully");
   } else {
-    Serial.print("[NVS] ✗ Initialization failed with error: 0x");
-    Serial.println(err, HEX);
-    Serial.println("[NVS] → Preferences will not work!");
+    LOGE("[NVS] ✗ Initialization failed with error: 0x%x", err);
+    LOGI("[NVS] → Settings will not be saved!");
   }
 
-  // Load timezone from Preferences
-  Serial.println();
-  Serial.println("[CONFIG] Loading configuration...");
-  loadTimezone();
-  Serial.print("[CONFIG] Timezone: UTC");
-  if (timezoneOffset >= 0) Serial.print("+");
-  Serial.println(timezoneOffset);
+  // Load settings from NVS
+  LOGI("[CONFIG] Loading configuration...");
+  loadConfig();
 
-  // Create mutexes
-  Serial.println();
-  Serial.println("[RTOS] Creating synchronization primitives...");
-  timeMutex = xSemaphoreCreateMutex();
-  displayMutex = xSemaphoreCreateMutex();
-
-  if (timeMutex == NULL || displayMutex == NULL) {
-    Serial.println("[RTOS] ✗ ERROR: Failed to create mutexes!");
-    while (1) delay(10);
-  }
-  Serial.println("[RTOS] ✓ Mutexes created successfully");
+  // Create the time-service task on Core 0, above the WiFi task so NTP
+  // timestamps and RTC writes are not held up by portal or HTTP work
+  timeServiceBegin();
+  LOGI("[RTOS] → Creating Time Task on Core 0...");
+  xTaskCreatePinnedToCore(
+      timeTask,         // Task function
+      "Time Task",      // Task name
+      TIME_TASK_STACK,  // Stack size (bytes)
+      NULL,             // Task parameters
+      2,                // Priority
+      &timeTaskHandle,  // Task handle
+      CORE_WIFI         // Core 0
+  );
+  runtimeStatsRegisterTask(timeTaskHandle, TIME_TASK_STACK);
 
   // Create WiFi task on Core 0
-  Serial.println();
-  Serial.println("[RTOS] Creating tasks...");
-  Serial.println("[RTOS] → Creating WiFi Task on Core 0...");
+  LOGI("[RTOS] → Creating WiFi Task on Core 0...");
   xTaskCreatePinnedToCore(
       wifiTask,         // Task function
       "WiFi Task",      // Task name
-      8192,             // Stack size (bytes)
+      WIFI_TASK_STACK,  // Stack size (bytes)
       NULL,             // Task parameters
       1,                // Priority
       &wifiTaskHandle,  // Task handle
       CORE_WIFI         // Core 0
   );
-
-  // Create Display task on Core 1
-  Serial.println("[RTOS] → Creating Display Task on Core 1...");
-  xTaskCreatePinnedToCore(
-      displayTask,         // Task function
-      "Display Task",      // Task name
-      4096,                // Stack size (bytes)
-      NULL,                // Task parameters
-      1,                   // Priority
-      &displayTaskHandle,  // Task handle
-      CORE_DISPLAY         // Core 1
-  );
-
-  Serial.println("[RTOS] ✓ All tasks created successfully!");
-  Serial.println();
-  Serial.println("╔════════════════════════════════════════════════╗");
-  Serial.println("║          Initialization Complete!              ║");
-  Serial.println("╚════════════════════════════════════════════════╝");
-  Serial.println();
+  runtimeStatsRegisterTask(wifiTaskHandle, WIFI_TASK_STACK);
+
+  // Chip, PSRAM and NVS statistics are not needed to tell the time
+#if CLOCK_FAST_BOOT
+  bootDiagCollectDeferred();
+#else
+  bootDiagCollect();
+#endif
+
+  LOGI("[RTOS] ✓ All tasks created successfully!");
+  LOG_BANNER("╔════════════════════════════════════════════════╗");
+  LOG_BANNER("║          Initialization Complete!              ║");
+  LOG_BANNER("╚════════════════════════════════════════════════╝");
 }
 
 void loop() {
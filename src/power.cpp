@@ -0,0 +1,403 @@
+#include "power.h"
+
+#include <atomic>
+#include <stdarg.h>
+#include <esp_pm.h>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+
+#include "bus_stats.h"
+#include "log.h"
+#include "runtime_stats.h"
+
+// Draw model, typical figures at 3.3 V. Tune for your modules.
+#define POWER_WIFI_AWAKE_UA 68000        // Radio listening continuously (or AP/scanning)
+#define POWER_WIFI_MODEM_SLEEP_UA 9000   // Averaged over DTIM wake-ups
+#define POWER_TM1637_IDLE_UA 1500        // Per chip, display blank
+#define POWER_SEGMENT_PEAK_UA 6000       // Per lit segment while its pulse is on
+#define POWER_RTC_UA 1500                // DS1307 module with pull-ups
+
+// ESP32-S3, both cores, RF off: fully busy and idle in WAITI
+struct CpuDraw {
+  uint16_t mhz;
+  uint32_t activeUa;
+  uint32_t idleUa;
+};
+
+static const CpuDraw CPU_DRAW[] = {
+  {80, 30000, 18000},
+  {160, 44000, 23000},
+  {240, 58000, 28000}
+};
+
+// TM1637 pulse width per brightness level, in sixteenths
+static const uint8_t TM1637_DUTY[8] = {1, 2, 4, 10, 11, 12, 13, 14};
+
+static const char *const SUBSYSTEM_NAMES[POWER_SUBSYSTEM_COUNT] = {
+  "cpu", "wifi", "display", "rtc"
+};
+
+#define POWER_PS_UNKNOWN 0xFF
+
+#if CONFIG_PM_ENABLE
+#define POWER_HAS_PM true
+#else
+#define POWER_HAS_PM false
+#endif
+
+// One integrator per subsystem; any task may report a draw
+struct PowerMeter {
+  uint32_t drawUa;
+  int64_t sinceUs;
+  uint64_t chargeUaUs;  // Draw integrated up to sinceUs (pC); wraps after years
+};
+
+static PowerMeter meters[POWER_SUBSYSTEM_COUNT];
+static portMUX_TYPE meterLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Settings, written by the time-service task
+static std::atomic<bool> lowPower{false};
+static std::atomic<uint32_t> nightWindow{0};  // level | from << 8 | to << 16
+
+// Modem sleep: holds from any task, the policy from the WiFi task; the
+// mutex orders esp_wifi_set_ps() calls against the hold deadline
+static SemaphoreHandle_t psMutex = NULL;
+static std::atomic<uint32_t> holdUntilMs{0};
+static std::atomic<uint8_t> appliedPs{POWER_PS_UNKNOWN};
+static std::atomic<bool> linkUp{false};
+static std::atomic<bool> keepAwake{false};
+
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t cpuLock = NULL;
+#endif
+
+// Ambient light (display task only, raw value also read by /power)
+static std::atomic<int16_t> ambientRaw{-1};
+
+void powerSetDraw(PowerSubsystem subsystem, uint32_t drawUa) {
+  int64_t nowUs = esp_timer_get_time();
+  portENTER_CRITICAL(&meterLock);
+  PowerMeter &meter = meters[subsystem];
+  if (meter.drawUa != drawUa) {
+    meter.chargeUaUs += (uint64_t)meter.drawUa * (uint64_t)(nowUs - meter.sinceUs);
+    meter.sinceUs = nowUs;
+    meter.drawUa = drawUa;
+  }
+  portEXIT_CRITICAL(&meterLock);
+}
+
+// Function to read a subsystem's energy so far and its present draw
+static double meterJoules(PowerSubsystem subsystem, uint32_t &drawUa) {
+  int64_t nowUs = esp_timer_get_time();
+  portENTER_CRITICAL(&meterLock);
+  const PowerMeter &meter = meters[subsystem];
+  uint64_t charge = meter.chargeUaUs + (uint64_t)meter.drawUa * (uint64_t)(nowUs - meter.sinceUs);
+  drawUa = meter.drawUa;
+  portEXIT_CRITICAL(&meterLock);
+  return (double)charge * POWER_SUPPLY_MV * 1e-15;
+}
+
+void powerBegin() {
+  int64_t nowUs = esp_timer_get_time();
+  for (int i = 0; i < POWER_SUBSYSTEM_COUNT; i++) {
+    meters[i].sinceUs = nowUs;
+  }
+  psMutex = xSemaphoreCreateMutex();
+#if CONFIG_PM_ENABLE
+  if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "transfer", &cpuLock) != ESP_OK) {
+    cpuLock = NULL;
+  }
+#endif
+  powerSetDraw(POWER_RTC, POWER_RTC_UA);
+  powerSetDraw(POWER_WIFI, POWER_WIFI_AWAKE_UA);
+}
+
+// Function to set the CPU frequency range for the mode
+static void configureCpu(bool low) {
+#if CONFIG_PM_ENABLE
+  esp_pm_config_esp32s3_t pm = {};
+  pm.max_freq_mhz = POWER_CPU_MAX_MHZ;
+  pm.min_freq_mhz = low ? POWER_CPU_MIN_MHZ : POWER_CPU_MAX_MHZ;
+  pm.light_sleep_enable = false;  // Would stop the display task's half-second wake-ups
+  esp_err_t err = esp_pm_configure(&pm);
+  if (err != ESP_OK) {
+    LOGE("[POWER] ✗ esp_pm_configure failed with error: 0x%x", err);
+    return;
+  }
+  LOGI("[POWER] → CPU %d-%d MHz (esp_pm)", pm.min_freq_mhz, pm.max_freq_mhz);
+#else
+  uint32_t mhz = low ? POWER_CPU_MIN_MHZ : POWER_CPU_MAX_MHZ;
+  setCpuFrequencyMhz(mhz);
+  LOGI("[POWER] → CPU fixed at %lu MHz (no esp_pm in this SDK)", (unsigned long)mhz);
+#endif
+}
+
+void powerConfigure(const PowerConfig &config) {
+  nightWindow.store(config.nightLevel | (uint32_t)config.nightFrom << 8 |
+                    (uint32_t)config.nightTo << 16, std::memory_order_relaxed);
+  bool wasLow = lowPower.exchange(config.lowPower, std::memory_order_acq_rel);
+  if (wasLow != config.lowPower || appliedPs.load(std::memory_order_acquire) == POWER_PS_UNKNOWN) {
+    LOGI("[POWER] %s low-power mode", config.lowPower ? "✓ Entering" : "→ Leaving");
+    configureCpu(config.lowPower);
+  }
+  if (config.nightFrom != config.nightTo) {
+    LOGI("[POWER] → Night brightness %u from %02u:00 to %02u:00", (unsigned)config.nightLevel,
+         (unsigned)config.nightFrom, (unsigned)config.nightTo);
+  }
+}
+
+bool powerLowPower() {
+  return lowPower.load(std::memory_order_acquire);
+}
+
+// Function to switch the station's power save mode; psMutex must be held
+static void applyPs(wifi_ps_type_t mode) {
+  if (appliedPs.load(std::memory_order_relaxed) == mode) {
+    return;
+  }
+  if (esp_wifi_set_ps(mode) != ESP_OK) {
+    return;  // Retried from the next powerService()
+  }
+  appliedPs.store(mode, std::memory_order_release);
+  powerSetDraw(POWER_WIFI, mode == WIFI_PS_NONE ? POWER_WIFI_AWAKE_UA : POWER_WIFI_MODEM_SLEEP_UA);
+}
+
+// Function to tell whether a hold is still running
+static bool held(uint32_t nowMs) {
+  return (int32_t)(holdUntilMs.load(std::memory_order_acquire) - nowMs) > 0;
+}
+
+void powerHoldWifi(uint32_t ms) {
+  uint32_t until = millis() + ms;
+  uint32_t current = holdUntilMs.load(std::memory_order_relaxed);
+  while ((int32_t)(until - current) > 0 &&
+         !holdUntilMs.compare_exchange_weak(current, until, std::memory_order_acq_rel)) {
+  }
+  if (psMutex == NULL || !linkUp.load(std::memory_order_acquire)) {
+    return;
+  }
+  // Wake the radio now, before the caller's first packet
+  busStatsTakeMutex(psMutex, portMAX_DELAY);
+  applyPs(WIFI_PS_NONE);
+  xSemaphoreGive(psMutex);
+}
+
+void powerKeepWifiAwake(bool awake) {
+  keepAwake.store(awake, std::memory_order_release);
+}
+
+// Function to refresh the CPU estimate from the latest core load
+// Idle time is spent at the lowest clock the mode allows, busy time at the top.
+static void updateCpuDraw() {
+  uint16_t loadPermille;
+  if (!runtimeStatsCpuLoad(loadPermille)) {
+    loadPermille = 0;
+  }
+  bool low = lowPower.load(std::memory_order_acquire);
+#if CONFIG_PM_ENABLE
+  uint16_t busyMhz = POWER_CPU_MAX_MHZ;
+#else
+  uint16_t busyMhz = low ? POWER_CPU_MIN_MHZ : POWER_CPU_MAX_MHZ;
+#endif
+  uint16_t idleMhz = low ? POWER_CPU_MIN_MHZ : POWER_CPU_MAX_MHZ;
+  const CpuDraw *busy = &CPU_DRAW[0];
+  const CpuDraw *idle = &CPU_DRAW[0];
+  for (size_t i = 0; i < sizeof(CPU_DRAW) / sizeof(CPU_DRAW[0]); i++) {
+    if (CPU_DRAW[i].mhz <= busyMhz) {
+      busy = &CPU_DRAW[i];
+    }
+    if (CPU_DRAW[i].mhz <= idleMhz) {
+      idle = &CPU_DRAW[i];
+    }
+  }
+  uint32_t idleUa = idle->idleUa;
+  uint32_t busyUa = busy->activeUa > idleUa ? busy->activeUa : idleUa;
+  powerSetDraw(POWER_CPU, idleUa + (busyUa - idleUa) * loadPermille / 1000);
+}
+
+void powerService(bool stationConnected) {
+  bool wasUp = linkUp.exchange(stationConnected, std::memory_order_acq_rel);
+  if (stationConnected != wasUp) {
+    // The driver may have reset the mode while the link was down
+    appliedPs.store(POWER_PS_UNKNOWN, std::memory_order_release);
+    if (!stationConnected) {
+      powerSetDraw(POWER_WIFI, POWER_WIFI_AWAKE_UA);
+    }
+  }
+
+  uint32_t nowMs = millis();
+  bool sleep = lowPower.load(std::memory_order_acquire) &&
+               !keepAwake.load(std::memory_order_acquire) && !held(nowMs);
+  wifi_ps_type_t mode = sleep ? WIFI_PS_MAX_MODEM : WIFI_PS_NONE;
+  if (stationConnected && psMutex != NULL && appliedPs.load(std::memory_order_acquire) != mode) {
+    // Decide again under the mutex: a hold may have started meanwhile
+    busStatsTakeMutex(psMutex, portMAX_DELAY);
+    sleep = lowPower.load(std::memory_order_acquire) &&
+            !keepAwake.load(std::memory_order_acquire) && !held(millis());
+    applyPs(sleep ? WIFI_PS_MAX_MODEM : WIFI_PS_NONE);
+    xSemaphoreGive(psMutex);
+  }
+
+  // Pull an expired deadline up to now so it cannot look future after a wrap
+  uint32_t deadline = holdUntilMs.load(std::memory_order_acquire);
+  if ((int32_t)(deadline - nowMs) < 0) {
+    holdUntilMs.compare_exchange_strong(deadline, nowMs, std::memory_order_acq_rel);
+  }
+
+  static uint32_t lastCpuUpdateMs = 0;
+  if (nowMs - lastCpuUpdateMs >= POWER_SERVICE_INTERVAL_MS) {
+    lastCpuUpdateMs = nowMs;
+    updateCpuDraw();
+  }
+}
+
+#if CLOCK_AMBIENT_PIN >= 0
+// Function to map the light sensor to a brightness cap
+// Readings are smoothed, and a level is only left once the reading is half
+// a step past its edge, so the display does not flicker at a boundary.
+static uint8_t ambientLevel() {
+  static uint32_t lastSampleMs = 0;
+  static int32_t filtered = -1;
+  static uint8_t level = 7;
+  const int32_t step = (POWER_AMBIENT_BRIGHT - POWER_AMBIENT_DARK) / 8;
+
+  if (filtered >= 0 && millis() - lastSampleMs < POWER_AMBIENT_INTERVAL_MS) {
+    return level;
+  }
+  lastSampleMs = millis();
+  int32_t raw = analogRead(CLOCK_AMBIENT_PIN);
+  ambientRaw.store((int16_t)raw, std::memory_order_relaxed);
+  filtered = filtered < 0 ? raw : (3 * filtered + raw) / 4;
+
+  int32_t low = POWER_AMBIENT_DARK + level * step - step / 2;
+  int32_t high = POWER_AMBIENT_DARK + (level + 1) * step + step / 2;
+  if (filtered < low || filtered >= high) {
+    int32_t next = (filtered - POWER_AMBIENT_DARK) / step;
+    level = (uint8_t)constrain(next, (int32_t)0, (int32_t)7);
+  }
+  return level;
+}
+#endif
+
+uint8_t powerBrightness(uint8_t configured, int localHour) {
+  uint8_t level = configured;
+  uint32_t night = nightWindow.load(std::memory_order_relaxed);
+  uint8_t nightLevel = night & 0xFF;
+  int from = (night >> 8) & 0xFF;
+  int to = (night >> 16) & 0xFF;
+  if (from != to) {
+    bool inside = from < to ? (localHour >= from && localHour < to)
+                            : (localHour >= from || localHour < to);
+    if (inside && nightLevel < level) {
+      level = nightLevel;
+    }
+  }
+#if CLOCK_AMBIENT_PIN >= 0
+  uint8_t ambient = ambientLevel();
+  if (ambient < level) {
+    level = ambient;
+  }
+#endif
+  return level;
+}
+
+uint32_t powerDisplayDrawUa(uint8_t chips, uint16_t litSegments, uint8_t brightness) {
+  uint32_t duty = TM1637_DUTY[brightness > 7 ? 7 : brightness];
+  return chips * POWER_TM1637_IDLE_UA + (uint32_t)litSegments * POWER_SEGMENT_PEAK_UA * duty / 16;
+}
+
+// Function to append formatted text to a bounded buffer
+static void appendf(char *buffer, size_t size, size_t &length, const char *format, ...) {
+  if (length >= size) {
+    return;
+  }
+  va_list args;
+  va_start(args, format);
+  int written = vsnprintf(buffer + length, size - length, format, args);
+  va_end(args);
+  if (written > 0) {
+    length += written;
+  }
+}
+
+size_t powerToPrometheus(char *buffer, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  buffer[0] = '\0';
+  double joules[POWER_SUBSYSTEM_COUNT];
+  uint32_t drawUa[POWER_SUBSYSTEM_COUNT];
+  for (int i = 0; i < POWER_SUBSYSTEM_COUNT; i++) {
+    joules[i] = meterJoules((PowerSubsystem)i, drawUa[i]);
+  }
+
+  size_t length = 0;
+  appendf(buffer, size, length, "# TYPE clock_low_power gauge\nclock_low_power %d\n",
+          powerLowPower() ? 1 : 0);
+  appendf(buffer, size, length, "# TYPE clock_energy_joules counter\n");
+  for (int i = 0; i < POWER_SUBSYSTEM_COUNT; i++) {
+    appendf(buffer, size, length, "clock_energy_joules{subsystem=\"%s\"} %.3f\n",
+            SUBSYSTEM_NAMES[i], joules[i]);
+  }
+  appendf(buffer, size, length, "# TYPE clock_current_draw_amperes gauge\n");
+  for (int i = 0; i < POWER_SUBSYSTEM_COUNT; i++) {
+    appendf(buffer, size, length, "clock_current_draw_amperes{subsystem=\"%s\"} %lu.%06lu\n",
+            SUBSYSTEM_NAMES[i], (unsigned long)(drawUa[i] / 1000000),
+            (unsigned long)(drawUa[i] % 1000000));
+  }
+  return length < size ? length : size - 1;
+}
+
+size_t powerToJson(char *buffer, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  buffer[0] = '\0';
+  uint32_t night = nightWindow.load(std::memory_order_relaxed);
+  uint8_t ps = appliedPs.load(std::memory_order_acquire);
+  int32_t holdMs = (int32_t)(holdUntilMs.load(std::memory_order_acquire) - millis());
+
+  size_t length = 0;
+  appendf(buffer, size, length,
+          "{\"low_power\":%s,\"esp_pm\":%s,\"wifi_ps\":\"%s\",\"wifi_hold_ms\":%ld,"
+          "\"night\":{\"level\":%u,\"from\":%u,\"to\":%u},\"ambient\":%d,\"subsystems\":{",
+          powerLowPower() ? "true" : "false", POWER_HAS_PM ? "true" : "false",
+          ps == WIFI_PS_NONE ? "none" : ps == WIFI_PS_MAX_MODEM ? "max_modem" : "unknown",
+          (long)(holdMs > 0 ? holdMs : 0), (unsigned)(night & 0xFF),
+          (unsigned)((night >> 8) & 0xFF), (unsigned)((night >> 16) & 0xFF),
+          (int)ambientRaw.load(std::memory_order_relaxed));
+  double total = 0;
+  for (int i = 0; i < POWER_SUBSYSTEM_COUNT; i++) {
+    uint32_t drawUa;
+    double joules = meterJoules((PowerSubsystem)i, drawUa);
+    total += joules;
+    appendf(buffer, size, length, "%s\"%s\":{\"draw_ma\":%.1f,\"energy_j\":%.3f}",
+            i ? "," : "", SUBSYSTEM_NAMES[i], drawUa / 1000.0, joules);
+  }
+  appendf(buffer, size, length, "},\"total_j\":%.3f}", total);
+  return length < size ? length : size - 1;
+}
+
+void IRAM_ATTR powerLockAcquire() {
+#if CONFIG_PM_ENABLE
+  if (cpuLock != NULL) {
+    esp_pm_lock_acquire(cpuLock);
+  }
+#endif
+}
+
+void IRAM_ATTR powerLockRelease() {
+#if CONFIG_PM_ENABLE
+  if (cpuLock != NULL) {
+    esp_pm_lock_release(cpuLock);
+  }
+#endif
+}
+
+PowerLock::PowerLock() {
+  powerLockAcquire();
+}
+
+PowerLock::~PowerLock() {
+  powerLockRelease();
+}
@@ -0,0 +1,100 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+
+#include "config_store.h"
+
+// Power-aware operation: modem sleep, CPU frequency scaling, brightness
+// policy and an estimated energy budget per subsystem.
+//
+// In low-power mode the station sits in modem sleep (WIFI_PS_MAX_MODEM) and
+// only wakes for DTIM beacons. NTP rounds and HTTP traffic take a timed hold
+// that switches the radio fully on before the first packet goes out, so NTP
+// timestamps are not skewed by packets buffered at the AP. The WiFi task
+// drops back to modem sleep once every hold has expired.
+//
+// The CPU runs between POWER_CPU_MAX_MHZ and POWER_CPU_MIN_MHZ through the
+// ESP-IDF power management (esp_pm) when the SDK is built with
+// CONFIG_PM_ENABLE, otherwise at a fixed POWER_CPU_MIN_MHZ. TM1637 and I2C
+// transfers run inside a PowerLock, which holds the CPU at full clock for
+// just that transfer, so their timing is the same in both modes. The minimum
+// is 80 MHz so the APB clock behind the UART, I2C and RMT never changes.
+//
+// Energy is an estimate: every subsystem reports its current draw from a
+// model (datasheet typicals in power.cpp) whenever its state changes, and
+// the draw is integrated over time. The figures are meant for comparing
+// settings on the same unit, not as a substitute for a meter.
+
+#define POWER_CPU_MAX_MHZ 240
+#define POWER_CPU_MIN_MHZ 80
+
+#define POWER_SUPPLY_MV 3300          // Rail every draw is referred to
+#define POWER_HTTP_HOLD_MS 5000       // Radio stays on after HTTP traffic
+#define POWER_SERVICE_INTERVAL_MS 1000
+
+// Ambient light sensor (LDR divider or phototransistor) on an ADC pin, more
+// light = higher reading; -1 for none. It can only dim below the set level.
+#ifndef CLOCK_AMBIENT_PIN
+#define CLOCK_AMBIENT_PIN -1
+#endif
+#define POWER_AMBIENT_DARK 200        // Raw reading shown at level 0
+#define POWER_AMBIENT_BRIGHT 3000     // Raw reading shown at level 7
+#define POWER_AMBIENT_INTERVAL_MS 2000
+
+enum PowerSubsystem {
+  POWER_CPU,
+  POWER_WIFI,
+  POWER_DISPLAY,  // Main display plus any extra ones
+  POWER_RTC,
+  POWER_SUBSYSTEM_COUNT
+};
+
+// Create the locks; call at the start of setup(), before any task uses them
+void powerBegin();
+
+// Apply the stored settings: CPU scaling now, modem sleep from the next
+// powerService(), night window from the next frame
+void powerConfigure(const PowerConfig &config);
+bool powerLowPower();
+
+// Keep the radio fully awake for at least the next `ms`; any task
+void powerHoldWifi(uint32_t ms);
+
+// Keep the radio out of modem sleep for good, e.g. while serving NTP:
+// requests buffered at the AP until a beacon would skew clients' offsets
+void powerKeepWifiAwake(bool awake);
+
+// Apply the modem sleep policy and refresh the CPU and WiFi estimates; call
+// from the WiFi task loop with the station link state
+void powerService(bool stationConnected);
+
+// Brightness for a frame: the stored level, capped inside the night window
+// and by the ambient light sensor. Display task only (it samples the ADC).
+uint8_t powerBrightness(uint8_t configured, int localHour);
+
+// Estimated draw of `chips` TM1637 modules with `litSegments` segments on
+uint32_t powerDisplayDrawUa(uint8_t chips, uint16_t litSegments, uint8_t brightness);
+
+// Report a subsystem's present draw (microamps); any task
+void powerSetDraw(PowerSubsystem subsystem, uint32_t drawUa);
+
+// Energy per subsystem as Prometheus text, appended by /metrics
+size_t powerToPrometheus(char *buffer, size_t size);
+
+// Settings, present draw and energy as JSON for GET /power
+size_t powerToJson(char *buffer, size_t size);
+
+// Hold the CPU at full clock for the enclosing transfer
+class PowerLock {
+ public:
+  PowerLock();
+  ~PowerLock();
+};
+
+// Same, taken in one place and released in another (e.g. an ISR); both are
+// ISR safe and no-ops without esp_pm
+void powerLockAcquire();
+void powerLockRelease();
+
+#endif
@@ -0,0 +1,49 @@
+#include "rtc_drift.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+void rtcDriftInit(RtcDrift &drift) {
+  drift.ppm = 0.0f;
+  drift.known = false;
+  drift.lastWriteUs = 0;
+  drift.errorAfterWriteUs = 0;
+  drift.syncIntervalMs = NTP_SYNC_INTERVAL_DEFAULT_MS;
+}
+
+void rtcDriftWritten(RtcDrift &drift, int64_t atUs, int64_t errorUs) {
+  drift.lastWriteUs = atUs;
+  drift.errorAfterWriteUs = errorUs;
+}
+
+void rtcDriftForget(RtcDrift &drift) {
+  drift.lastWriteUs = 0;
+}
+
+bool rtcDriftUpdate(RtcDrift &drift, int64_t rtcErrorUs, int64_t nowUs) {
+  int64_t baselineUs = nowUs - drift.lastWriteUs;
+  int64_t accumulatedUs = rtcErrorUs - drift.errorAfterWriteUs;
+
+  if (drift.lastWriteUs == 0 || baselineUs < RTC_DRIFT_MIN_BASELINE_US ||
+      llabs(accumulatedUs) > RTC_DRIFT_MAX_ERROR_US) {
+    return false;
+  }
+
+  float samplePpm = (float)accumulatedUs * 1e6f / (float)baselineUs;
+  drift.ppm = drift.known ? 0.7f * drift.ppm + 0.3f * samplePpm : samplePpm;
+  drift.known = true;
+
+  float absPpm = fabsf(drift.ppm);
+  uint32_t intervalMs = NTP_SYNC_INTERVAL_MAX_MS;
+  if (absPpm > 0.01f) {
+    float budgetMs = NTP_SYNC_ERROR_BUDGET_US / absPpm * 1000.0f;
+    if (budgetMs < NTP_SYNC_INTERVAL_MAX_MS) {
+      intervalMs = (uint32_t)budgetMs;
+    }
+  }
+  if (intervalMs < NTP_SYNC_INTERVAL_MIN_MS) {
+    intervalMs = NTP_SYNC_INTERVAL_MIN_MS;
+  }
+  drift.syncIntervalMs = intervalMs;
+  return true;
+}
@@ -0,0 +1,42 @@
+#ifndef RTC_DRIFT_H
+#define RTC_DRIFT_H
+
+#include <stdint.h>
+
+// DS1307 drift estimate and the NTP sync interval derived from it.
+//
+// Each NTP sync measures how far the RTC has wandered since it was last set
+// on a second edge; over a long enough baseline that is its frequency
+// error. The estimate is a moving average of those samples, and the sync
+// interval is chosen so the drift between syncs stays within the error
+// budget. Only the time-service task uses it. No Arduino dependency so
+// tools/sntp_client_test.cpp can build it.
+
+#define NTP_SYNC_INTERVAL_DEFAULT_MS 3600000  // 1 hour, until drift is known
+#define NTP_SYNC_INTERVAL_MIN_MS 900000       // 15 minutes
+#define NTP_SYNC_INTERVAL_MAX_MS 86400000     // 24 hours
+#define NTP_SYNC_ERROR_BUDGET_US 100000       // 100 ms
+#define RTC_DRIFT_MIN_BASELINE_US 600000000LL // 10 minutes between samples
+#define RTC_DRIFT_MAX_ERROR_US 5000000LL      // More is a reset, not drift
+
+struct RtcDrift {
+  float ppm;                  // Positive: the RTC runs fast
+  bool known;
+  int64_t lastWriteUs;        // Clock time when the RTC was last set, 0 if unusable
+  int64_t errorAfterWriteUs;  // RTC error right after that write
+  uint32_t syncIntervalMs;
+};
+
+void rtcDriftInit(RtcDrift &drift);
+
+// The RTC was set at clock time `atUs`, leaving it `errorUs` off
+void rtcDriftWritten(RtcDrift &drift, int64_t atUs, int64_t errorUs);
+
+// The RTC was set from something that is no reference (a hand-set time)
+void rtcDriftForget(RtcDrift &drift);
+
+// Fold in an RTC error measured at clock time `nowUs`; false when the
+// sample was unusable (no reference write, baseline too short, a reset)
+bool rtcDriftUpdate(RtcDrift &drift, int64_t rtcErrorUs, int64_t nowUs);
+
+#endif
@@ -0,0 +1,355 @@
+#include "runtime_stats.h"
+
+#include <atomic>
+#include <stdarg.h>
+#include <esp_timer.h>
+
+#include "log.h"
+
+#define RUNTIME_STATS_CORES 2
+#define RUNTIME_STATS_MAX_REGISTERED 8
+
+struct TaskSample {
+  char name[configMAX_TASK_NAME_LEN];
+  int8_t core;              // -1 if the task may run on either core
+  uint8_t priority;
+  uint32_t stackFreeBytes;  // Least free stack ever (high-water mark)
+  uint32_t stackSizeBytes;  // 0 if the task was not registered
+  uint16_t cpuPermille;     // Share of one core over the last interval
+};
+
+struct RuntimeSnapshot {
+  uint32_t uptimeS;
+  uint32_t heapSize;
+  uint32_t heapFree;
+  uint32_t heapLargestBlock;
+  uint32_t heapMinFree;
+  uint32_t psramSize;
+  uint32_t psramFree;
+  bool cpuValid;
+  uint16_t corePermille[RUNTIME_STATS_CORES];
+  size_t taskCount;
+  TaskSample tasks[RUNTIME_STATS_MAX_TASKS];
+};
+
+// One ring entry, in KB to keep an hour of history small
+struct HistorySample {
+  uint16_t heapFreeKb;
+  uint16_t heapLargestKb;
+  uint16_t heapMinFreeKb;
+  uint16_t psramFreeKb;
+  uint16_t corePermille[RUNTIME_STATS_CORES];
+};
+
+struct RegisteredTask {
+  TaskHandle_t handle;
+  uint32_t stackBytes;
+};
+
+struct PreviousRunTime {
+  TaskHandle_t handle;
+  uint32_t runTime;
+};
+
+// Registered from setup(); the count is published after the entry
+static RegisteredTask registered[RUNTIME_STATS_MAX_REGISTERED];
+static std::atomic<size_t> registeredCount{0};
+
+// Sampler state (only touched by the task calling runtimeStatsSample)
+#if configUSE_TRACE_FACILITY
+static TaskStatus_t taskStatus[RUNTIME_STATS_MAX_TASKS];
+#endif
+#if configGENERATE_RUN_TIME_STATS
+static PreviousRunTime previous[RUNTIME_STATS_MAX_TASKS];
+static size_t previousCount = 0;
+static uint32_t previousTotalRunTime = 0;
+#endif
+static RuntimeSnapshot scratch;
+
+// Published sample and history; readers copy them under the lock
+static RuntimeSnapshot latest;
+static HistorySample history[RUNTIME_STATS_HISTORY];
+static size_t historyCount = 0;
+static size_t historyNext = 0;
+static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+
+void runtimeStatsRegisterTask(TaskHandle_t task, uint32_t stackBytes) {
+  size_t count = registeredCount.load(std::memory_order_relaxed);
+  if (task == NULL || count >= RUNTIME_STATS_MAX_REGISTERED) {
+    return;
+  }
+  registered[count].handle = task;
+  registered[count].stackBytes = stackBytes;
+  registeredCount.store(count + 1, std::memory_order_release);
+}
+
+// Function to look up the configured stack size of a task, 0 if unknown
+static uint32_t registeredStackBytes(TaskHandle_t task) {
+  size_t count = registeredCount.load(std::memory_order_acquire);
+  for (size_t i = 0; i < count; i++) {
+    if (registered[i].handle == task) {
+      return registered[i].stackBytes;
+    }
+  }
+  return 0;
+}
+
+#if configGENERATE_RUN_TIME_STATS
+// Function to find a task's run-time counter from the previous sample
+static bool previousRunTime(TaskHandle_t task, uint32_t &runTime) {
+  for (size_t i = 0; i < previousCount; i++) {
+    if (previous[i].handle == task) {
+      runTime = previous[i].runTime;
+      return true;
+    }
+  }
+  return false;
+}
+#endif
+
+// Function to fill the task list of a snapshot
+static void sampleTasks(RuntimeSnapshot &s) {
+  s.taskCount = 0;
+  s.cpuValid = false;
+
+#if configUSE_TRACE_FACILITY
+  uint32_t totalRunTime = 0;
+  UBaseType_t count = uxTaskGetSystemState(taskStatus, RUNTIME_STATS_MAX_TASKS, &totalRunTime);
+  if (count == 0) {
+    LOGW("[STATS] ⚠ More than %d tasks, task list skipped", RUNTIME_STATS_MAX_TASKS);
+    return;
+  }
+
+#if configGENERATE_RUN_TIME_STATS
+  uint32_t elapsed = totalRunTime - previousTotalRunTime;
+  bool haveBaseline = previousTotalRunTime != 0 && elapsed != 0;
+  uint32_t idleRunTime[RUNTIME_STATS_CORES] = {};
+#endif
+
+  for (UBaseType_t i = 0; i < count; i++) {
+    const TaskStatus_t &status = taskStatus[i];
+    TaskSample &task = s.tasks[s.taskCount++];
+    strncpy(task.name, status.pcTaskName, sizeof(task.name) - 1);
+    task.name[sizeof(task.name) - 1] = '\0';
+#if configTASKLIST_INCLUDE_COREID
+    task.core = status.xCoreID < RUNTIME_STATS_CORES ? (int8_t)status.xCoreID : -1;
+#else
+    task.core = -1;
+#endif
+    task.priority = (uint8_t)status.uxCurrentPriority;
+    task.stackFreeBytes = status.usStackHighWaterMark;  // Bytes on ESP-IDF
+    task.stackSizeBytes = registeredStackBytes(status.xHandle);
+    task.cpuPermille = 0;
+
+#if configGENERATE_RUN_TIME_STATS
+    uint32_t before;
+    if (haveBaseline && previousRunTime(status.xHandle, before)) {
+      uint32_t delta = status.ulRunTimeCounter - before;
+      uint64_t permille = (uint64_t)delta * 1000 / elapsed;
+      task.cpuPermille = (uint16_t)(permille > 1000 ? 1000 : permille);
+      for (int core = 0; core < RUNTIME_STATS_CORES; core++) {
+        if (status.xHandle == xTaskGetIdleTaskHandleForCPU(core)) {
+          idleRunTime[core] = delta;
+        }
+      }
+    }
+#endif
+  }
+
+#if configGENERATE_RUN_TIME_STATS
+  // Counters are 32-bit microseconds: deltas stay valid for ~71 minutes
+  for (UBaseType_t i = 0; i < count; i++) {
+    previous[i].handle = taskStatus[i].xHandle;
+    previous[i].runTime = taskStatus[i].ulRunTimeCounter;
+  }
+  previousCount = count;
+  previousTotalRunTime = totalRunTime;
+
+  if (haveBaseline) {
+    s.cpuValid = true;
+    for (int core = 0; core < RUNTIME_STATS_CORES; core++) {
+      uint64_t idle = (uint64_t)idleRunTime[core] * 1000 / elapsed;
+      s.corePermille[core] = (uint16_t)(idle > 1000 ? 0 : 1000 - idle);
+    }
+  }
+#endif
+
+#else
+  // No task list in this FreeRTOS build: report the registered tasks only
+  size_t count = registeredCount.load(std::memory_order_acquire);
+  for (size_t i = 0; i < count; i++) {
+    TaskSample &task = s.tasks[s.taskCount++];
+    strncpy(task.name, pcTaskGetName(registered[i].handle), sizeof(task.name) - 1);
+    task.name[sizeof(task.name) - 1] = '\0';
+    task.core = -1;
+    task.priority = (uint8_t)uxTaskPriorityGet(registered[i].handle);
+    task.stackFreeBytes = uxTaskGetStackHighWaterMark(registered[i].handle);
+    task.stackSizeBytes = registered[i].stackBytes;
+    task.cpuPermille = 0;
+  }
+#endif
+}
+
+void runtimeStatsSample() {
+  RuntimeSnapshot &s = scratch;
+  s.uptimeS = (uint32_t)(esp_timer_get_time() / 1000000LL);
+  s.heapSize = ESP.getHeapSize();
+  s.heapFree = ESP.getFreeHeap();
+  s.heapLargestBlock = ESP.getMaxAllocHeap();
+  s.heapMinFree = ESP.getMinFreeHeap();
+  s.psramSize = ESP.getPsramSize();
+  s.psramFree = ESP.getFreePsram();
+  sampleTasks(s);
+
+  HistorySample entry;
+  entry.heapFreeKb = (uint16_t)(s.heapFree / 1024);
+  entry.heapLargestKb = (uint16_t)(s.heapLargestBlock / 1024);
+  entry.heapMinFreeKb = (uint16_t)(s.heapMinFree / 1024);
+  entry.psramFreeKb = (uint16_t)(s.psramFree / 1024);
+  for (int core = 0; core < RUNTIME_STATS_CORES; core++) {
+    entry.corePermille[core] = s.cpuValid ? s.corePermille[core] : 0;
+  }
+
+  portENTER_CRITICAL(&statsLock);
+  latest = s;
+  history[historyNext] = entry;
+  historyNext = (historyNext + 1) % RUNTIME_STATS_HISTORY;
+  if (historyCount < RUNTIME_STATS_HISTORY) {
+    historyCount++;
+  }
+  portEXIT_CRITICAL(&statsLock);
+}
+
+bool runtimeStatsCpuLoad(uint16_t &permille) {
+  portENTER_CRITICAL(&statsLock);
+  bool valid = latest.cpuValid;
+  uint32_t sum = 0;
+  for (int core = 0; core < RUNTIME_STATS_CORES; core++) {
+    sum += latest.corePermille[core];
+  }
+  portEXIT_CRITICAL(&statsLock);
+  permille = (uint16_t)(sum / RUNTIME_STATS_CORES);
+  return valid;
+}
+
+// Function to append formatted text to a bounded buffer
+static void appendf(char *buffer, size_t size, size_t &length, const char *format, ...) {
+  if (length >= size) {
+    return;
+  }
+  va_list args;
+  va_start(args, format);
+  int written = vsnprintf(buffer + length, size - length, format, args);
+  va_end(args);
+  if (written > 0) {
+    length += written;
+  }
+}
+
+// Function to name a task's core for a label
+static const char *coreLabel(int8_t core) {
+  return core == 0 ? "0" : core == 1 ? "1" : "any";
+}
+
+size_t runtimeStatsToPrometheus(char *buffer, size_t size) {
+  RuntimeSnapshot s;
+  portENTER_CRITICAL(&statsLock);
+  s = latest;
+  portEXIT_CRITICAL(&statsLock);
+
+  // Share of the free heap that is not in the largest block
+  uint32_t fragmentationPermille =
+      s.heapFree ? 1000 - (uint32_t)((uint64_t)s.heapLargestBlock * 1000 / s.heapFree) : 0;
+
+  size_t length = 0;
+  appendf(buffer, size, length,
+          "# TYPE clock_uptime_seconds gauge\nclock_uptime_seconds %lu\n"
+          "# TYPE clock_heap_size_bytes gauge\nclock_heap_size_bytes %lu\n"
+          "# TYPE clock_heap_free_bytes gauge\nclock_heap_free_bytes %lu\n"
+          "# TYPE clock_heap_largest_free_block_bytes gauge\nclock_heap_largest_free_block_bytes %lu\n"
+          "# TYPE clock_heap_min_free_bytes gauge\nclock_heap_min_free_bytes %lu\n"
+          "# TYPE clock_heap_fragmentation_ratio gauge\nclock_heap_fragmentation_ratio %lu.%03lu\n"
+          "# TYPE clock_psram_size_bytes gauge\nclock_psram_size_bytes %lu\n"
+          "# TYPE clock_psram_free_bytes gauge\nclock_psram_free_bytes %lu\n",
+          (unsigned long)s.uptimeS, (unsigned long)s.heapSize, (unsigned long)s.heapFree,
+          (unsigned long)s.heapLargestBlock, (unsigned long)s.heapMinFree,
+          (unsigned long)(fragmentationPermille / 1000),
+          (unsigned long)(fragmentationPermille % 1000),
+          (unsigned long)s.psramSize, (unsigned long)s.psramFree);
+
+  if (s.cpuValid) {
+    appendf(buffer, size, length, "# TYPE clock_cpu_load_ratio gauge\n");
+    for (int core = 0; core < RUNTIME_STATS_CORES; core++) {
+      appendf(buffer, size, length, "clock_cpu_load_ratio{core=\"%d\"} %u.%03u\n", core,
+              (unsigned)(s.corePermille[core] / 1000), (unsigned)(s.corePermille[core] % 1000));
+    }
+  }
+
+  // Task series carry the core too: both idle tasks are called IDLE
+  appendf(buffer, size, length, "# TYPE clock_task_stack_free_bytes gauge\n");
+  for (size_t i = 0; i < s.taskCount; i++) {
+    const TaskSample &task = s.tasks[i];
+    appendf(buffer, size, length, "clock_task_stack_free_bytes{task=\"%s\",core=\"%s\"} %lu\n",
+            task.name, coreLabel(task.core), (unsigned long)task.stackFreeBytes);
+  }
+  appendf(buffer, size, length, "# TYPE clock_task_stack_size_bytes gauge\n");
+  for (size_t i = 0; i < s.taskCount; i++) {
+    const TaskSample &task = s.tasks[i];
+    if (task.stackSizeBytes) {
+      appendf(buffer, size, length, "clock_task_stack_size_bytes{task=\"%s\",core=\"%s\"} %lu\n",
+              task.name, coreLabel(task.core), (unsigned long)task.stackSizeBytes);
+    }
+  }
+  if (s.cpuValid) {
+    appendf(buffer, size, length, "# TYPE clock_task_cpu_ratio gauge\n");
+    for (size_t i = 0; i < s.taskCount; i++) {
+      const TaskSample &task = s.tasks[i];
+      appendf(buffer, size, length, "clock_task_cpu_ratio{task=\"%s\",core=\"%s\"} %u.%03u\n",
+              task.name, coreLabel(task.core), (unsigned)(task.cpuPermille / 1000),
+              (unsigned)(task.cpuPermille % 1000));
+    }
+  }
+  return length < size ? length : size - 1;
+}
+
+size_t runtimeStatsHistoryToJson(char *buffer, size_t size) {
+  HistorySample samples[RUNTIME_STATS_HISTORY];
+  size_t count;
+  size_t first;
+  uint32_t uptimeS;
+  portENTER_CRITICAL(&statsLock);
+  count = historyCount;
+  first = (historyNext + RUNTIME_STATS_HISTORY - historyCount) % RUNTIME_STATS_HISTORY;
+  for (size_t i = 0; i < count; i++) {
+    samples[i] = history[(first + i) % RUNTIME_STATS_HISTORY];
+  }
+  uptimeS = latest.uptimeS;
+  portEXIT_CRITICAL(&statsLock);
+
+  static const char *const seriesNames[] = {
+    "heap_free_kb", "heap_largest_kb", "heap_min_free_kb", "psram_free_kb",
+    "cpu0_permille", "cpu1_permille"
+  };
+
+  size_t length = 0;
+  appendf(buffer, size, length, "{\"interval_s\":%u,\"last_uptime_s\":%lu",
+          (unsigned)(RUNTIME_STATS_INTERVAL_MS / 1000), (unsigned long)uptimeS);
+  for (size_t series = 0; series < sizeof(seriesNames) / sizeof(seriesNames[0]); series++) {
+    appendf(buffer, size, length, ",\"%s\":[", seriesNames[series]);
+    for (size_t i = 0; i < count; i++) {
+      const HistorySample &sample = samples[i];
+      uint16_t value;
+      switch (series) {
+        case 0: value = sample.heapFreeKb; break;
+        case 1: value = sample.heapLargestKb; break;
+        case 2: value = sample.heapMinFreeKb; break;
+        case 3: value = sample.psramFreeKb; break;
+        default: value = sample.corePermille[series - 4]; break;
+      }
+      appendf(buffer, size, length, i ? ",%u" : "%u", (unsigned)value);
+    }
+    appendf(buffer, size, length, "]");
+  }
+  appendf(buffer, size, length, "}");
+  return length < size ? length : size - 1;
+}
@@ -0,0 +1,37 @@
+#ifndef RUNTIME_STATS_H
+#define RUNTIME_STATS_H
+
+#include <Arduino.h>
+
+// Per-task stack and CPU use, heap fragmentation and PSRAM telemetry.
+//
+// runtimeStatsSample() is called periodically from the WiFi task. It walks
+// the FreeRTOS task list (stack high-water marks and run-time counters),
+// derives CPU load per task and per core over the interval, and reads heap
+// and PSRAM figures. The latest sample is served as Prometheus text; heap,
+// PSRAM and core load also go into a fixed ring so slow leaks show up as a
+// trend. Task CPU figures need run-time stats in the FreeRTOS config; without
+// them only stacks and memory are reported.
+
+#define RUNTIME_STATS_INTERVAL_MS 60000  // One sample per minute
+#define RUNTIME_STATS_HISTORY 60         // Ring length (1 hour)
+#define RUNTIME_STATS_MAX_TASKS 24
+
+// Record the configured stack size of a task, so its headroom can be shown
+// against it (FreeRTOS only reports the high-water mark)
+void runtimeStatsRegisterTask(TaskHandle_t task, uint32_t stackBytes);
+
+// Take a sample; call every RUNTIME_STATS_INTERVAL_MS from one task
+void runtimeStatsSample();
+
+// Load averaged over both cores in the latest sample (permille); false until
+// run-time counters have two samples to compare
+bool runtimeStatsCpuLoad(uint16_t &permille);
+
+// Latest sample in Prometheus text exposition format
+size_t runtimeStatsToPrometheus(char *buffer, size_t size);
+
+// Ring of samples as compact JSON (one array per series, oldest first)
+size_t runtimeStatsHistoryToJson(char *buffer, size_t size);
+
+#endif
@@ -0,0 +1,220 @@
+#include "sntp_client.h"
+
+#include "latency.h"
+#include "log.h"
+#include "soft_clock.h"
+
+#define NTP_PACKET_SIZE 48
+#define NTP_UNIX_EPOCH_DELTA 2208988800ULL  // 1900-01-01 to 1970-01-01
+#define NTP_MODE_CLIENT 3
+#define NTP_MODE_SERVER 4
+#define NTP_VERSION 4
+#define NTP_LEAP_UNSYNCHRONIZED 3
+
+static uint32_t readU32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t readU64(const uint8_t *p) {
+  return ((uint64_t)readU32(p) << 32) | readU32(p + 4);
+}
+
+static void writeU64(uint8_t *p, uint64_t value) {
+  for (int i = 7; i >= 0; i--) {
+    p[i] = value & 0xFF;
+    value >>= 8;
+  }
+}
+
+// NTP short format (16.16 seconds) to microseconds
+static uint32_t shortToUs(uint32_t value) {
+  return (uint32_t)(((uint64_t)value * 1000000ULL) >> 16);
+}
+
+int64_t sntpToUnixUs(uint64_t ntpTimestamp) {
+  int64_t seconds = (int64_t)(ntpTimestamp >> 32) - (int64_t)NTP_UNIX_EPOCH_DELTA;
+  int64_t fractionUs = (int64_t)(((ntpTimestamp & 0xFFFFFFFFULL) * 1000000ULL) >> 32);
+  return seconds * 1000000LL + fractionUs;
+}
+
+uint64_t sntpFromUnixUs(int64_t unixUs) {
+  uint64_t seconds = (uint64_t)(unixUs / 1000000LL) + NTP_UNIX_EPOCH_DELTA;
+  uint64_t fraction = ((uint64_t)(unixUs % 1000000LL) << 32) / 1000000ULL;
+  return (seconds << 32) | fraction;
+}
+
+SntpClient::SntpClient(const char *const *servers, uint8_t count, uint16_t port)
+  : servers(servers),
+    count(count > SNTP_MAX_SERVERS ? SNTP_MAX_SERVERS : count),
+    port(port),
+    socketOpen(false),
+    active(false),
+    roundStartMs(0),
+    requests(0),
+    responses(0) {
+  for (uint8_t i = 0; i < SNTP_MAX_SERVERS; i++) {
+    resolved[i] = false;
+    resolvedAtMs[i] = 0;
+  }
+}
+
+const char *SntpClient::serverName(uint8_t index) const {
+  return index < count ? servers[index] : "?";
+}
+
+IPAddress SntpClient::serverAddress(uint8_t index) const {
+  return index < count ? address[index] : IPAddress();
+}
+
+bool SntpClient::busy() const {
+  return active;
+}
+
+// Blocking: WiFi.hostByName() waits for the resolver. Results are cached,
+// so only the first round (and one a day) waits on DNS
+bool SntpClient::resolve(uint8_t index) {
+  if (resolved[index] && millis() - resolvedAtMs[index] < SNTP_DNS_REFRESH_MS) {
+    return true;
+  }
+  IPAddress ip;
+  if (WiFi.hostByName(servers[index], ip) != 1) {
+    LOGW("[NTP] ⚠ Could not resolve %s", servers[index]);
+    return resolved[index];  // Fall back to the previous address if we had one
+  }
+  address[index] = ip;
+  resolved[index] = true;
+  resolvedAtMs[index] = millis();
+  return true;
+}
+
+bool SntpClient::start() {
+  if (active) {
+    return false;
+  }
+  if (!socketOpen) {
+    socketOpen = udp.begin(SNTP_LOCAL_PORT) == 1;
+    if (!socketOpen) {
+      LOGE("[NTP] ✗ Could not open UDP socket");
+      return false;
+    }
+  }
+
+  // Drop stale replies from a previous round
+  while (udp.parsePacket() > 0) {
+    udp.flush();
+  }
+
+  requests = 0;
+  responses = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    samples[i].valid = false;
+    sentTimestamp[i] = 0;
+    if (!resolve(i)) {
+      continue;
+    }
+
+    uint8_t packet[NTP_PACKET_SIZE] = {0};
+    packet[0] = (0 << 6) | (NTP_VERSION << 3) | NTP_MODE_CLIENT;
+
+    // Transmit timestamp doubles as a request id: the server echoes it back
+    // as the originate timestamp, which is how replies are matched
+    sentUs[i] = softClockNowUs();
+    sentTimestamp[i] = sntpFromUnixUs(sentUs[i]) + i;
+    writeU64(packet + 40, sentTimestamp[i]);
+
+    if (udp.beginPacket(address[i], port) == 1) {
+      udp.write(packet, NTP_PACKET_SIZE);
+      if (udp.endPacket() == 1) {
+        requests++;
+      }
+    }
+  }
+
+  roundStartMs = millis();
+  active = requests > 0;
+  return active;
+}
+
+void SntpClient::handleReply(const uint8_t *packet, int length, IPAddress from, int64_t t4) {
+  if (length < NTP_PACKET_SIZE) {
+    return;
+  }
+
+  uint64_t originate = readU64(packet + 24);
+  for (uint8_t i = 0; i < count; i++) {
+    if (samples[i].valid || sentTimestamp[i] == 0 || originate != sentTimestamp[i]) {
+      continue;
+    }
+    if ((uint32_t)from != (uint32_t)address[i]) {
+      continue;
+    }
+
+    uint8_t leap = packet[0] >> 6;
+    uint8_t mode = packet[0] & 0x07;
+    uint8_t stratum = packet[1];
+    // Stratum 0 is a kiss-of-death, leap 3 means the server is not synced
+    if (mode != NTP_MODE_SERVER || stratum == 0 || stratum > 15 || leap == NTP_LEAP_UNSYNCHRONIZED) {
+      LOGW("[NTP] ⚠ %s rejected (stratum %u, leap %u)", servers[i], stratum, leap);
+      sentTimestamp[i] = 0;
+      responses++;
+      return;
+    }
+
+    // Server timestamps are shifted onto the local clock's timescale
+    int64_t t1 = sentUs[i];
+    int64_t t2 = sntpToUnixUs(readU64(packet + 32));
+    int64_t t3 = sntpToUnixUs(readU64(packet + 40));
+
+    SntpSample &sample = samples[i];
+    sample.offsetUs = ((t2 - t1) + (t3 - t4)) / 2;
+    sample.delayUs = (t4 - t1) - (t3 - t2);
+    if (sample.delayUs >= 0) {
+      LATENCY_RECORD(LATENCY_NTP_RTT, (uint32_t)sample.delayUs);
+    }
+    sample.stratum = stratum;
+    sample.leap = leap;
+    sample.rootDelayUs = shortToUs(readU32(packet + 4));
+    sample.rootDispersionUs = shortToUs(readU32(packet + 8));
+    sample.valid = true;
+    responses++;
+    return;
+  }
+}
+
+bool SntpClient::poll(SntpResult &result) {
+  if (!active) {
+    return false;
+  }
+
+  int length;
+  while ((length = udp.parsePacket()) > 0) {
+    // Stamp T4 before anything else to keep it close to arrival
+    int64_t t4 = softClockNowUs();
+    uint8_t packet[NTP_PACKET_SIZE];
+    int read = udp.read(packet, sizeof(packet));
+    udp.flush();
+    handleReply(packet, read, udp.remoteIP(), t4);
+  }
+
+  if (responses < requests && millis() - roundStartMs < SNTP_TIMEOUT_MS) {
+    return false;
+  }
+
+  // Round finished: keep the sample with the smallest round-trip delay,
+  // it has the tightest bound on the offset error (delay / 2)
+  active = false;
+  result.ok = false;
+  result.requests = requests;
+  result.responses = responses;
+  for (uint8_t i = 0; i < count; i++) {
+    if (!samples[i].valid || samples[i].delayUs < 0) {
+      continue;
+    }
+    if (!result.ok || samples[i].delayUs < result.best.delayUs) {
+      result.ok = true;
+      result.best = samples[i];
+      result.serverIndex = i;
+    }
+  }
+  return true;
+}
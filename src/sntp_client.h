@@ -0,0 +1,87 @@
+#ifndef SNTP_CLIENT_H
+#define SNTP_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+
+#define SNTP_MAX_SERVERS 4
+#define SNTP_PORT 123
+#define SNTP_LOCAL_PORT 4123
+#define SNTP_TIMEOUT_MS 1500
+#define SNTP_DNS_REFRESH_MS 86400000  // Re-resolve server names once a day
+
+// One server's answer, all times in microseconds
+struct SntpSample {
+  bool valid;
+  int64_t offsetUs;  // Add to the local clock to get server time
+  int64_t delayUs;   // Round-trip network delay
+  uint8_t stratum;
+  uint8_t leap;
+  uint32_t rootDelayUs;
+  uint32_t rootDispersionUs;
+};
+
+// Result of one round: the sample with the smallest round-trip delay
+struct SntpResult {
+  bool ok;
+  SntpSample best;
+  uint8_t serverIndex;
+  uint8_t requests;
+  uint8_t responses;
+};
+
+// Non-blocking multi-server SNTP client.
+//
+// start() sends one request to every server from a single UDP socket and
+// returns at once; poll() is called from the owning task's loop and picks
+// up replies as they arrive. Offset and delay use all four timestamps
+// (RFC 4330):  offset = ((T2 - T1) + (T3 - T4)) / 2,
+//              delay  = (T4 - T1) - (T3 - T2).
+// Local timestamps T1/T4 come from the in-memory clock.
+//
+// Server names are resolved inside start() with WiFi.hostByName(), which
+// blocks the caller until the DNS reply or the resolver's timeout. Results
+// are cached for SNTP_DNS_REFRESH_MS, so that wait hits the first round
+// and one round a day; a failed lookup keeps the previous address.
+//
+// tools/sntp_client_test.cpp runs it against local stand-in servers.
+class SntpClient {
+public:
+  SntpClient(const char *const *servers, uint8_t count, uint16_t port = SNTP_PORT);
+
+  bool start();
+  bool busy() const;
+
+  // Returns true once when the round has finished (all replies or timeout)
+  bool poll(SntpResult &result);
+
+  const char *serverName(uint8_t index) const;
+  IPAddress serverAddress(uint8_t index) const;
+
+private:
+  bool resolve(uint8_t index);
+  void handleReply(const uint8_t *packet, int length, IPAddress from, int64_t t4);
+
+  const char *const *servers;
+  uint8_t count;
+  uint16_t port;
+  WiFiUDP udp;
+  bool socketOpen;
+  bool active;
+  unsigned long roundStartMs;
+
+  IPAddress address[SNTP_MAX_SERVERS];
+  unsigned long resolvedAtMs[SNTP_MAX_SERVERS];
+  bool resolved[SNTP_MAX_SERVERS];
+  uint64_t sentTimestamp[SNTP_MAX_SERVERS];  // Our T1 as NTP timestamp, echoed back as originate
+  int64_t sentUs[SNTP_MAX_SERVERS];
+  SntpSample samples[SNTP_MAX_SERVERS];
+  uint8_t requests;
+  uint8_t responses;
+};
+
+// NTP timestamp (seconds since 1900 in the high word) <-> Unix microseconds
+int64_t sntpToUnixUs(uint64_t ntpTimestamp);
+uint64_t sntpFromUnixUs(int64_t unixUs);
+
+#endif
@@ -0,0 +1,251 @@
+#include "sntp_server.h"
+
+#if CLOCK_SNTP_SERVER
+
+#include <atomic>
+#include <lwip/pbuf.h>
+#include <lwip/tcpip.h>
+#include <lwip/udp.h>
+
+#include "latency.h"
+#include "log.h"
+#include "soft_clock.h"
+
+#define NTP_PACKET_SIZE 48
+#define NTP_MODE_CLIENT 3
+#define NTP_MODE_SERVER 4
+#define NTP_LEAP_UNSYNCHRONIZED 3
+#define NTP_STRATUM_UNSYNCHRONIZED 16
+
+// What the last sync left behind; written by the time-service task, read
+// per request in the tcpip thread
+struct SntpReference {
+  bool valid;
+  uint8_t stratum;
+  uint8_t leap;
+  uint32_t rootDelayUs;
+  uint32_t rootDispersionUs;
+  uint8_t refId[4];
+  int64_t syncedUs;
+};
+
+static SntpReference reference = {};
+static portMUX_TYPE referenceLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Socket state: set to opening by the caller (WiFi task), to listening or
+// failed by openSocket() in the tcpip thread
+enum SntpSocketState : uint8_t {
+  SNTP_SOCKET_CLOSED,
+  SNTP_SOCKET_OPENING,
+  SNTP_SOCKET_LISTENING,
+  SNTP_SOCKET_FAILED
+};
+static std::atomic<uint8_t> socketState{SNTP_SOCKET_CLOSED};
+static unsigned long lastAttemptMs = 0;  // Caller side
+
+// Rate window (tcpip thread only)
+static uint32_t windowStartMs = 0;
+static uint32_t windowReplies = 0;
+
+static std::atomic<uint32_t> requestCount{0};
+static std::atomic<uint32_t> replyCount{0};
+static std::atomic<uint32_t> unsynchronizedCount{0};
+static std::atomic<uint32_t> droppedCount{0};
+static std::atomic<uint32_t> malformedCount{0};
+
+static void writeU32(uint8_t *p, uint32_t value) {
+  p[0] = value >> 24;
+  p[1] = value >> 16;
+  p[2] = value >> 8;
+  p[3] = value;
+}
+
+static void writeU64(uint8_t *p, uint64_t value) {
+  writeU32(p, (uint32_t)(value >> 32));
+  writeU32(p + 4, (uint32_t)value);
+}
+
+// Microseconds to NTP short format (16.16 seconds), saturating
+static uint32_t usToShort(uint64_t us) {
+  uint64_t value = (us << 16) / 1000000ULL;
+  return value > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : (uint32_t)value;
+}
+
+// Function to fill everything but the three timestamps the request decides
+// Returns false when the clock cannot be vouched for (leap 3).
+static bool fillHeader(uint8_t *reply, uint8_t version, uint8_t poll, int64_t nowUs) {
+  portENTER_CRITICAL(&referenceLock);
+  SntpReference ref = reference;
+  portEXIT_CRITICAL(&referenceLock);
+
+  uint64_t dispersionUs = 0;
+  if (ref.valid) {
+    int64_t ageUs = nowUs > ref.syncedUs ? nowUs - ref.syncedUs : 0;
+    dispersionUs = ref.rootDispersionUs + (uint64_t)ageUs * SNTP_SERVER_PHI_PPM / 1000000ULL;
+  }
+  bool synced = ref.valid && dispersionUs <= SNTP_SERVER_MAX_DISPERSION_US;
+
+  uint8_t leap = synced ? ref.leap : NTP_LEAP_UNSYNCHRONIZED;
+  reply[0] = (leap << 6) | (version << 3) | NTP_MODE_SERVER;
+  reply[1] = synced ? ref.stratum : NTP_STRATUM_UNSYNCHRONIZED;
+  reply[2] = poll;
+  reply[3] = (uint8_t)SNTP_SERVER_PRECISION;
+  writeU32(reply + 4, synced ? usToShort(ref.rootDelayUs) : 0);
+  writeU32(reply + 8, usToShort(dispersionUs));
+  if (synced) {
+    memcpy(reply + 12, ref.refId, 4);
+    writeU64(reply + 16, sntpFromUnixUs(ref.syncedUs));
+  } else {
+    memset(reply + 12, 0, 12);
+  }
+  return synced;
+}
+
+// lwIP receive callback (tcpip thread): stamp, answer, free
+static void onRequest(void *arg, struct udp_pcb *socket, struct pbuf *p, const ip_addr_t *addr,
+                      u16_t port) {
+  // T2 before anything else, as close to arrival as this layer gets
+  int64_t receiveUs = softClockNowUs();
+  requestCount.fetch_add(1, std::memory_order_relaxed);
+
+  uint8_t request[NTP_PACKET_SIZE];
+  bool valid = p->tot_len >= NTP_PACKET_SIZE &&
+               pbuf_copy_partial(p, request, NTP_PACKET_SIZE, 0) == NTP_PACKET_SIZE;
+  pbuf_free(p);
+  uint8_t version = valid ? (request[0] >> 3) & 0x07 : 0;
+  if (!valid || (request[0] & 0x07) != NTP_MODE_CLIENT || version < 1 || version > 4) {
+    malformedCount.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  uint32_t nowMs = millis();
+  if (nowMs - windowStartMs >= 1000) {
+    windowStartMs = nowMs;
+    windowReplies = 0;
+  }
+  if (windowReplies >= SNTP_SERVER_MAX_RATE) {
+    droppedCount.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  struct pbuf *out = pbuf_alloc(PBUF_TRANSPORT, NTP_PACKET_SIZE, PBUF_RAM);
+  if (out == NULL) {
+    droppedCount.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  windowReplies++;
+
+  uint8_t *reply = (uint8_t *)out->payload;
+  bool synced = fillHeader(reply, version, request[2], receiveUs);
+  memcpy(reply + 24, request + 40, 8);  // Client's transmit becomes originate
+  writeU64(reply + 32, sntpFromUnixUs(receiveUs));
+
+  // T3 last, right before the datagram goes down the stack
+  int64_t transmitUs = softClockNowUs();
+  writeU64(reply + 40, sntpFromUnixUs(transmitUs));
+  err_t err = udp_sendto(socket, out, addr, port);
+  pbuf_free(out);
+  LATENCY_RECORD(LATENCY_NTP_SERVE, (uint32_t)(transmitUs - receiveUs));
+
+  if (err != ERR_OK) {
+    droppedCount.fetch_add(1, std::memory_order_relaxed);
+  } else if (synced) {
+    replyCount.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    unsynchronizedCount.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// Runs in the tcpip thread, where raw API calls are allowed
+static void openSocket(void *ctx) {
+  struct udp_pcb *socket = udp_new();
+  if (socket == NULL) {
+    LOGE("[NTPD] ✗ Could not allocate a UDP socket");
+    socketState.store(SNTP_SOCKET_FAILED, std::memory_order_release);
+    return;
+  }
+  if (udp_bind(socket, IP_ADDR_ANY, SNTP_PORT) != ERR_OK) {
+    udp_remove(socket);
+    LOGE("[NTPD] ✗ UDP port %d already in use", SNTP_PORT);
+    socketState.store(SNTP_SOCKET_FAILED, std::memory_order_release);
+    return;
+  }
+  udp_recv(socket, onRequest, NULL);
+  LOGI("[NTPD] ✓ SNTP server listening on UDP %d", SNTP_PORT);
+  socketState.store(SNTP_SOCKET_LISTENING, std::memory_order_release);
+}
+
+bool sntpServerBegin() {
+  uint8_t state = socketState.load(std::memory_order_acquire);
+  if (state == SNTP_SOCKET_LISTENING) {
+    return true;
+  }
+  if (state == SNTP_SOCKET_OPENING ||
+      (state == SNTP_SOCKET_FAILED && millis() - lastAttemptMs < SNTP_SERVER_RETRY_MS)) {
+    return false;
+  }
+  lastAttemptMs = millis();
+  socketState.store(SNTP_SOCKET_OPENING, std::memory_order_relaxed);
+  if (tcpip_callback(openSocket, NULL) != ERR_OK) {
+    LOGE("[NTPD] ✗ Could not reach the tcpip thread");
+    socketState.store(SNTP_SOCKET_FAILED, std::memory_order_relaxed);
+  }
+  return false;  // Bound or not once openSocket() has run
+}
+
+void sntpServerSetReference(const SntpSample &upstream, IPAddress server, int64_t syncedUs) {
+  SntpReference ref;
+  ref.valid = true;
+  ref.stratum = upstream.stratum + 1;
+  ref.leap = upstream.leap;
+  ref.rootDelayUs = upstream.rootDelayUs + (upstream.delayUs > 0 ? (uint32_t)upstream.delayUs : 0);
+  ref.rootDispersionUs = upstream.rootDispersionUs;
+  for (int i = 0; i < 4; i++) {
+    ref.refId[i] = server[i];
+  }
+  ref.syncedUs = syncedUs;
+
+  portENTER_CRITICAL(&referenceLock);
+  reference = ref;
+  portEXIT_CRITICAL(&referenceLock);
+}
+
+void sntpServerClearReference() {
+  portENTER_CRITICAL(&referenceLock);
+  reference.valid = false;
+  portEXIT_CRITICAL(&referenceLock);
+}
+
+SntpServerStats sntpServerStats() {
+  SntpServerStats stats;
+  stats.requests = requestCount.load(std::memory_order_relaxed);
+  stats.replies = replyCount.load(std::memory_order_relaxed);
+  stats.unsynchronized = unsynchronizedCount.load(std::memory_order_relaxed);
+  stats.dropped = droppedCount.load(std::memory_order_relaxed);
+  stats.malformed = malformedCount.load(std::memory_order_relaxed);
+  return stats;
+}
+
+size_t sntpServerToPrometheus(char *buffer, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  SntpServerStats stats = sntpServerStats();
+  int written = snprintf(buffer, size,
+      "# TYPE clock_sntp_server_packets_total counter\n"
+      "clock_sntp_server_packets_total{result=\"received\"} %lu\n"
+      "clock_sntp_server_packets_total{result=\"replied\"} %lu\n"
+      "clock_sntp_server_packets_total{result=\"unsynchronized\"} %lu\n"
+      "clock_sntp_server_packets_total{result=\"dropped\"} %lu\n"
+      "clock_sntp_server_packets_total{result=\"malformed\"} %lu\n",
+      (unsigned long)stats.requests, (unsigned long)stats.replies,
+      (unsigned long)stats.unsynchronized, (unsigned long)stats.dropped,
+      (unsigned long)stats.malformed);
+  if (written < 0) {
+    buffer[0] = '\0';
+    return 0;
+  }
+  return (size_t)written < size ? (size_t)written : size - 1;
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef SNTP_SERVER_H
+#define SNTP_SERVER_H
+
+#include <Arduino.h>
+
+#include "sntp_client.h"
+
+// SNTP responder on UDP 123, answering from the in-memory clock.
+//
+// Runs on the lwIP raw API: the receive callback executes in the tcpip
+// thread as the datagram comes up the stack. The receive timestamp is the
+// first thing it takes, the reply is built in place, and the transmit
+// timestamp is written just before udp_sendto(). No task of ours is woken
+// and nothing is queued, so a burst of requests costs tcpip-thread time
+// only and never reaches the display, time or web tasks. Beyond
+// SNTP_SERVER_MAX_RATE replies per second requests are dropped.
+//
+// Until the first NTP sync, or after the clock was set by hand or from the
+// RTC, replies carry leap 3 and stratum 16 (unsynchronized) so clients
+// ignore them. Once synced the server is one stratum below its upstream and
+// passes on the upstream's leap indicator. Root delay adds the upstream
+// round trip to the upstream's root delay. Root dispersion grows from the
+// upstream's at SNTP_SERVER_PHI_PPM until the next sync; past
+// SNTP_SERVER_MAX_DISPERSION_US the server reports itself unsynchronized.
+
+// Build with -DCLOCK_SNTP_SERVER=0 to leave the responder out
+#ifndef CLOCK_SNTP_SERVER
+#define CLOCK_SNTP_SERVER 1
+#endif
+
+#define SNTP_SERVER_MAX_RATE 1000             // Replies per second
+#define SNTP_SERVER_PHI_PPM 15                // Assumed frequency tolerance (RFC 5905)
+#define SNTP_SERVER_MAX_DISPERSION_US 1000000 // Stop claiming sync beyond this
+#define SNTP_SERVER_PRECISION -20             // log2 s, esp_timer ticks in 1 us
+#define SNTP_SERVER_RETRY_MS 30000            // Wait before retrying a failed bind
+
+struct SntpServerStats {
+  uint32_t requests;        // Datagrams received on port 123
+  uint32_t replies;         // Answered while synchronized
+  uint32_t unsynchronized;  // Answered with leap 3
+  uint32_t dropped;         // Over the rate limit or out of buffers
+  uint32_t malformed;       // Short, or not a client request
+};
+
+#if CLOCK_SNTP_SERVER
+
+// Open the socket; call once WiFi is up and then periodically until it
+// returns true. The bind runs in the tcpip thread, so the first call only
+// posts it and later calls report the result; a failed bind is retried
+// every SNTP_SERVER_RETRY_MS.
+bool sntpServerBegin();
+
+// Record the sync just applied: upstream stratum, leap, root figures and
+// round trip, the upstream's address (reference id) and the clock time of the sync
+void sntpServerSetReference(const SntpSample &upstream, IPAddress server, int64_t syncedUs);
+
+// The clock was set from something other than NTP
+void sntpServerClearReference();
+
+SntpServerStats sntpServerStats();
+
+// Counters as Prometheus text, appended by /metrics
+size_t sntpServerToPrometheus(char *buffer, size_t size);
+
+#endif
+
+#endif
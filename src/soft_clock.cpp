@@ -0,0 +1,57 @@
+#include "soft_clock.h"
+
+#include <atomic>
+#include <esp_timer.h>
+
+// Odd sequence value means a write is in progress
+static std::atomic<uint32_t> clockSeq{0};
+
+// Protected by clockSeq: epoch time at the moment esp_timer read baseMonoUs
+static int64_t baseEpochUs = 0;
+static int64_t baseMonoUs = 0;
+static std::atomic<bool> clockValid{false};
+
+// Writers are rare (boot, NTP sync, drift correction) but may come from
+// either core, so they are serialized with a spinlock. Readers never take it.
+static portMUX_TYPE writerLock = portMUX_INITIALIZER_UNLOCKED;
+
+void softClockSet(int64_t epochUs) {
+  portENTER_CRITICAL(&writerLock);
+  int64_t monoUs = esp_timer_get_time();
+  uint32_t seq = clockSeq.load(std::memory_order_relaxed);
+  clockSeq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  baseEpochUs = epochUs;
+  baseMonoUs = monoUs;
+
+  clockSeq.store(seq + 2, std::memory_order_release);
+  portEXIT_CRITICAL(&writerLock);
+
+  clockValid.store(true, std::memory_order_release);
+}
+
+bool softClockValid() {
+  return clockValid.load(std::memory_order_acquire);
+}
+
+int64_t softClockNowUs() {
+  int64_t epochUs;
+  int64_t monoUs;
+  uint32_t before;
+  uint32_t after;
+
+  do {
+    before = clockSeq.load(std::memory_order_acquire);
+    epochUs = baseEpochUs;
+    monoUs = baseMonoUs;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = clockSeq.load(std::memory_order_relaxed);
+  } while ((before & 1) || before != after);
+
+  return epochUs + (esp_timer_get_time() - monoUs);
+}
+
+uint32_t softClockNow() {
+  return (uint32_t)(softClockNowUs() / 1000000LL);
+}
@@ -0,0 +1,25 @@
+#ifndef SOFT_CLOCK_H
+#define SOFT_CLOCK_H
+
+#include <Arduino.h>
+
+// In-memory time base.
+//
+// Seeded from the DS1307 at boot and from NTP after every sync, then advanced
+// by esp_timer (microsecond monotonic counter). Readers never touch I2C and
+// never block: they take a snapshot guarded by a sequence counter and retry
+// if a writer was active at the same time.
+
+// Set the clock to the given epoch time in microseconds
+void softClockSet(int64_t epochUs);
+
+// True once the clock has been seeded at least once
+bool softClockValid();
+
+// Current epoch time in microseconds
+int64_t softClockNowUs();
+
+// Current epoch time in whole seconds (DateTime compatible)
+uint32_t softClockNow();
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Bounded single-producer/single-consumer queue for passing small commands
+// between tasks on different cores.
+//
+// Exactly one task may push and exactly one task may pop. Neither side ever
+// blocks or takes a lock: the producer publishes a slot by advancing `tail`
+// with release ordering, the consumer frees it by advancing `head`. A push
+// into a full queue fails and is counted. Pair it with a task notification
+// when the consumer sleeps.
+
+template <typename T, uint32_t N>
+class SpscQueue {
+  static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+ public:
+  // Producer side; returns false if the queue is full
+  bool push(const T &item) {
+    uint32_t tail = tailPos.load(std::memory_order_relaxed);
+    if (tail - headPos.load(std::memory_order_acquire) == N) {
+      drops.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    slots[tail & (N - 1)] = item;
+    tailPos.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side; returns false if the queue is empty
+  bool pop(T &item) {
+    uint32_t head = headPos.load(std::memory_order_relaxed);
+    if (head == tailPos.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = slots[head & (N - 1)];
+    headPos.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Pushes refused because the queue was full
+  uint32_t dropped() const {
+    return drops.load(std::memory_order_relaxed);
+  }
+
+ private:
+  T slots[N];
+  std::atomic<uint32_t> headPos{0};  // Only advanced by the consumer
+  std::atomic<uint32_t> tailPos{0};  // Only advanced by the producer
+  std::atomic<uint32_t> drops{0};
+};
+
+#endif
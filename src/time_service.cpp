@@ -0,0 +1,107 @@
+#include "time_service.h"
+
+#include <atomic>
+#include <esp_timer.h>
+
+#include "bus_stats.h"
+
+static QueueHandle_t commandQueue = NULL;
+// Held by posters so ids go out in queue order and a full queue uses none
+static SemaphoreHandle_t postMutex = NULL;
+static uint32_t nextCommandId = 1;
+static std::atomic<uint32_t> lastPostedId{0};
+static std::atomic<uint32_t> lastCompletedId{0};
+
+// Received but not completed yet: the one being run plus syncs waiting for
+// their round. Only touched by the time-service task.
+#define TIME_COMMAND_MAX_OPEN (TIME_COMMAND_QUEUE_LENGTH + 1)
+static uint32_t openIds[TIME_COMMAND_MAX_OPEN];
+static size_t openCount = 0;
+static uint32_t highestReceivedId = 0;
+
+// Written only by the time-service task; the lock keeps copies consistent
+static TimeSyncStatus publishedStatus;
+static portMUX_TYPE statusLock = portMUX_INITIALIZER_UNLOCKED;
+
+void timeServiceBegin() {
+  commandQueue = xQueueCreate(TIME_COMMAND_QUEUE_LENGTH, sizeof(TimeCommand));
+  postMutex = xSemaphoreCreateMutex();
+}
+
+// Only posters add to the queue, so with the mutex held a free slot stays
+// free. The id is published before the send: the time-service task can run
+// the command as soon as it is queued, and last_completed must never pass
+// last_posted.
+uint32_t timeServicePost(TimeCommand command) {
+  busStatsTakeMutex(postMutex, portMAX_DELAY);
+  if (uxQueueMessagesWaiting(commandQueue) >= TIME_COMMAND_QUEUE_LENGTH) {
+    xSemaphoreGive(postMutex);
+    return 0;
+  }
+  command.id = nextCommandId;
+  command.postedUs = esp_timer_get_time();
+  lastPostedId.store(command.id, std::memory_order_relaxed);
+  if (xQueueSend(commandQueue, &command, 0) != pdTRUE) {
+    lastPostedId.store(command.id - 1, std::memory_order_relaxed);
+    xSemaphoreGive(postMutex);
+    return 0;
+  }
+  nextCommandId++;
+  xSemaphoreGive(postMutex);
+  return command.id;
+}
+
+uint32_t timeServicePost(TimeCommandType type) {
+  TimeCommand command = {};
+  command.type = type;
+  return timeServicePost(command);
+}
+
+bool timeServiceReceive(TimeCommand &command, TickType_t wait) {
+  if (xQueueReceive(commandQueue, &command, wait) != pdTRUE) {
+    return false;
+  }
+  busStatsRecordWait(BUS_WAIT_TIME_QUEUE, (uint32_t)(esp_timer_get_time() - command.postedUs));
+  if (command.id > highestReceivedId) {
+    highestReceivedId = command.id;
+  }
+  if (openCount < TIME_COMMAND_MAX_OPEN) {
+    openIds[openCount++] = command.id;
+  }
+  return true;
+}
+
+// A sync completes when its round ends, after commands received later, so
+// the published id is the one below the oldest command still open
+void timeServiceComplete(const TimeCommand &command) {
+  uint32_t completed = highestReceivedId;
+  size_t kept = 0;
+  for (size_t i = 0; i < openCount; i++) {
+    if (openIds[i] == command.id) {
+      continue;
+    }
+    openIds[kept++] = openIds[i];
+    if (openIds[i] - 1 < completed) {
+      completed = openIds[i] - 1;
+    }
+  }
+  openCount = kept;
+  lastCompletedId.store(completed, std::memory_order_release);
+}
+
+void timeServicePublish(const TimeSyncStatus &status) {
+  portENTER_CRITICAL(&statusLock);
+  publishedStatus = status;
+  portEXIT_CRITICAL(&statusLock);
+}
+
+TimeSyncStatus timeServiceStatus() {
+  portENTER_CRITICAL(&statusLock);
+  TimeSyncStatus status = publishedStatus;
+  portEXIT_CRITICAL(&statusLock);
+  // Completed first: every id it covers was posted before, so the posted id
+  // read after it is at least as high
+  status.lastCompletedId = lastCompletedId.load(std::memory_order_acquire);
+  status.lastPostedId = lastPostedId.load(std::memory_order_relaxed);
+  return status;
+}
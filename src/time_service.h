@@ -0,0 +1,76 @@
+#ifndef TIME_SERVICE_H
+#define TIME_SERVICE_H
+
+#include <Arduino.h>
+
+#include "config_store.h"
+#include "tz_engine.h"
+
+// Command queue and published state of the time-service task.
+//
+// Any task (HTTP handlers, the WiFi task) posts typed commands without
+// waiting for queue space and gets the command id back; the time-service task executes them
+// in order and publishes the id up to which all of them are done (a sync
+// waits for its NTP round), which /syncStatus reports next to the last one
+// posted. The task publishes its sync state as a small struct that readers
+// copy under a spinlock, so status endpoints never wait on a sync in progress.
+
+#define TIME_COMMAND_QUEUE_LENGTH 8
+
+enum TimeCommandType {
+  TIME_CMD_SYNC_NOW,    // Start an NTP round (joins one already running)
+  TIME_CMD_SET_ZONE,    // Switch the display zone (the clock stays UTC)
+  TIME_CMD_SET_MANUAL,  // Set the clock and RTC to a given UTC time
+  TIME_CMD_SET_BRIGHTNESS, // Store and show a display brightness
+  TIME_CMD_SET_POWER      // Store and apply the power settings
+};
+
+struct TimeCommand {
+  TimeCommandType type;
+  uint32_t id;            // Assigned by timeServicePost()
+  char zone[TZ_POSIX_MAX]; // TIME_CMD_SET_ZONE, POSIX TZ string
+  uint32_t epoch;         // TIME_CMD_SET_MANUAL, UTC seconds
+  uint8_t brightness;     // TIME_CMD_SET_BRIGHTNESS, 0-7
+  PowerConfig power;      // TIME_CMD_SET_POWER
+  int64_t postedUs;       // Set by timeServicePost() to measure queue wait
+};
+
+enum TimeSyncState {
+  TIME_SYNC_IDLE,
+  TIME_SYNC_IN_PROGRESS
+};
+
+struct TimeSyncStatus {
+  TimeSyncState state;
+  uint32_t attempts;          // NTP rounds started
+  uint32_t successes;
+  uint32_t lastSuccessEpoch;  // UTC time of the last good sync, 0 = never
+  int32_t lastOffsetMs;       // Clock step applied by the last good sync
+  int32_t lastRttMs;          // Round trip to the chosen server
+  const char *lastError;      // Static string, NULL after a success
+  float rtcDriftPpm;          // Averaged DS1307 drift, 0 until known
+  int32_t rtcResidualUs;      // Last RTC write's latch time minus the edge
+  uint32_t nextSyncMin;       // Current periodic sync interval
+  uint32_t lastPostedId;
+  uint32_t lastCompletedId;   // Every command up to this id is done
+};
+
+// Create the queue; call before any task posts
+void timeServiceBegin();
+
+// Queue a command without waiting for space; returns its id, or 0 if the
+// queue is full (no id is used then, so ids stay consecutive)
+uint32_t timeServicePost(TimeCommand command);
+
+// Shorthand for posting a command with only a type
+uint32_t timeServicePost(TimeCommandType type);
+
+// Used by the time-service task
+bool timeServiceReceive(TimeCommand &command, TickType_t wait);
+void timeServiceComplete(const TimeCommand &command);
+void timeServicePublish(const TimeSyncStatus &status);
+
+// Snapshot of the published state (never blocks on a sync)
+TimeSyncStatus timeServiceStatus();
+
+#endif
@@ -0,0 +1,164 @@
+#include "tm1637_bank.h"
+
+#include <esp_timer.h>
+#include <soc/gpio_reg.h>
+#include <soc/soc.h>
+
+#include "bus_stats.h"
+#include "latency.h"
+#include "power.h"
+
+#define TM1637_BRIGHTNESS_UNSET 0xFF
+
+Tm1637Bank::Tm1637Bank()
+  : displayCount(0),
+    pendingBrightness(7),
+    shownBrightness(TM1637_BRIGHTNESS_UNSET),
+    shownValid(false),
+    clkMask(0),
+    allMask(0),
+    lastUs(0),
+    maxUs(0) {}
+
+bool Tm1637Bank::add(uint8_t clkPin, uint8_t dioPin) {
+  if (displayCount >= TM1637_BANK_MAX) {
+    return false;
+  }
+  Display &display = displays[displayCount++];
+  display.clkPin = clkPin;
+  display.dioPin = dioPin;
+  memset(display.pending, 0, sizeof(display.pending));
+  memset(display.shown, 0, sizeof(display.shown));
+  return true;
+}
+
+void Tm1637Bank::begin() {
+  clkMask = 0;
+  for (uint8_t i = 0; i < displayCount; i++) {
+    // Lines idle high; DIO open-drain for the ACK slot, as on the main display
+    pinMode(displays[i].clkPin, OUTPUT);
+    pinMode(displays[i].dioPin, OUTPUT_OPEN_DRAIN);
+    digitalWrite(displays[i].clkPin, HIGH);
+    digitalWrite(displays[i].dioPin, HIGH);
+    clkMask |= 1ULL << displays[i].clkPin;
+    dioMasks[i] = 1ULL << displays[i].dioPin;
+  }
+  shownValid = false;
+  shownBrightness = TM1637_BRIGHTNESS_UNSET;
+}
+
+void Tm1637Bank::setBrightness(uint8_t level) {
+  pendingBrightness = level > 7 ? 7 : level;
+}
+
+void Tm1637Bank::setRaw(uint8_t index, const uint8_t segments[TM1637_DIGITS]) {
+  if (index >= displayCount) {
+    return;
+  }
+  memcpy(displays[index].pending, segments, TM1637_DIGITS);
+}
+
+void Tm1637Bank::setTime(uint8_t index, int hour, int minute, bool colon) {
+  if (index >= displayCount) {
+    return;
+  }
+  uint8_t *pending = displays[index].pending;
+  pending[0] = TM1637_DIGIT_SEGMENTS[(hour / 10) % 10];
+  pending[1] = TM1637_DIGIT_SEGMENTS[hour % 10];
+  pending[2] = TM1637_DIGIT_SEGMENTS[(minute / 10) % 10];
+  pending[3] = TM1637_DIGIT_SEGMENTS[minute % 10];
+  if (colon) {
+    pending[TM1637_COLON_DIGIT] |= TM1637_COLON_BIT;
+  }
+}
+
+uint8_t Tm1637Bank::flush() {
+  if (displayCount == 0) {
+    return 0;
+  }
+
+  // Union of the changed digits over all displays
+  uint8_t dirtyMask = 0;
+  for (uint8_t d = 0; d < displayCount; d++) {
+    dirtyMask |= tm1637DirtyMask(displays[d].pending, displays[d].shown, shownValid);
+  }
+  bool brightness = pendingBrightness != shownBrightness;
+  if (dirtyMask == 0 && !brightness) {
+    return 0;
+  }
+
+  // Fold each display's DIO into one bit per tick; the transactions depend
+  // only on the mask, so the last encoded wave supplies the shared CLK samples
+  uint16_t length = 0;
+  uint8_t dirtyCount = 0;
+  for (uint8_t d = 0; d < displayCount; d++) {
+    dirtyCount = tm1637WaveFlush(wave, displays[d].pending, dirtyMask,
+                                 brightness ? pendingBrightness : -1);
+    if (wave.overflow || (d > 0 && wave.length != length)) {
+      return 0;
+    }
+    length = wave.length;
+    for (uint16_t t = 0; t < length; t++) {
+      uint8_t bit = (wave.samples[t] & TM1637_WAVE_DIO) ? (1 << d) : 0;
+      dioBits[t] = d ? (dioBits[t] | bit) : bit;
+    }
+    memcpy(displays[d].shown, displays[d].pending, TM1637_DIGITS);
+  }
+  shownValid = true;
+  shownBrightness = pendingBrightness;
+
+  int64_t startUs = esp_timer_get_time();
+  {
+    PowerLock lock;
+    play(wave);
+  }
+  lastUs = (uint32_t)(esp_timer_get_time() - startUs);
+  if (lastUs > maxUs) {
+    maxUs = lastUs;
+  }
+  LATENCY_RECORD(LATENCY_DISPLAY_BANK, lastUs);
+  busStatsCountGpioCycles(wave.clockCycles);
+  return dirtyCount;
+}
+
+uint16_t Tm1637Bank::litSegments() const {
+  uint16_t count = 0;
+  for (uint8_t d = 0; shownValid && d < displayCount; d++) {
+    for (uint8_t i = 0; i < TM1637_DIGITS; i++) {
+      count += __builtin_popcount(displays[d].shown[i]);
+    }
+  }
+  return count;
+}
+
+// Function to play the folded waveform: per tick, one set and one clear
+// write covers every CLK and DIO line of the bank
+void Tm1637Bank::play(const Tm1637Wave &clkWave) {
+  allMask = clkMask;
+  for (uint8_t d = 0; d < displayCount; d++) {
+    allMask |= dioMasks[d];
+  }
+  tm1637WavePlay(clkWave, playTick, this);
+}
+
+void Tm1637Bank::playTick(uint16_t index, uint8_t sample, uint8_t changed, void *arg) {
+  Tm1637Bank *self = static_cast<Tm1637Bank *>(arg);
+  uint64_t high = (sample & TM1637_WAVE_CLK) ? self->clkMask : 0;
+  uint8_t bits = self->dioBits[index];
+  for (uint8_t d = 0; d < self->displayCount; d++) {
+    if (bits & (1 << d)) {
+      high |= self->dioMasks[d];
+    }
+  }
+  uint64_t low = self->allMask & ~high;
+
+  // A tick moves either the CLK lines or the DIO lines, never both, so
+  // the set and clear writes may land a few cycles apart
+  REG_WRITE(GPIO_OUT_W1TS_REG, (uint32_t)high);
+  REG_WRITE(GPIO_OUT_W1TC_REG, (uint32_t)low);
+  if ((self->allMask >> 32) != 0) {
+    REG_WRITE(GPIO_OUT1_W1TS_REG, (uint32_t)(high >> 32));
+    REG_WRITE(GPIO_OUT1_W1TC_REG, (uint32_t)(low >> 32));
+  }
+  delayMicroseconds(TM1637_TICK_US);
+}
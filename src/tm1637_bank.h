@@ -0,0 +1,81 @@
+#ifndef TM1637_BANK_H
+#define TM1637_BANK_H
+
+#include <Arduino.h>
+
+#include "tm1637_frame.h"
+#include "tm1637_wave.h"
+
+// Several TM1637 displays clocked in lockstep.
+//
+// Each display keeps its own framebuffer, but a flush sends every display
+// the same transactions: the union of the changed digits (or a burst for
+// all), with each display's own data. The CLK waveform then depends only
+// on that structure, so it is identical for all displays and they can
+// share one CLK line. Every tick is one write to the GPIO set register and
+// one to the clear register (GPIO_OUT_W1TS/W1TC, plus the OUT1 pair for
+// pins 32 and up). That covers all displays at once, so N displays take
+// about as long on the bus as one.
+//
+// Per-flush bus time goes to the `display_bank` latency probe.
+//
+// Bit-bang only; the single main display keeps its own backend
+// (Tm1637Frame). Pins must be outputs 0-48, and DIO lines are open-drain.
+
+#define TM1637_BANK_MAX 8
+
+class Tm1637Bank {
+public:
+  Tm1637Bank();
+
+  // Add a display before begin(); CLK may repeat, DIO must not. False when full.
+  bool add(uint8_t clkPin, uint8_t dioPin);
+  void begin();
+  uint8_t count() const { return displayCount; }
+
+  void setBrightness(uint8_t level);  // 0-7, all displays
+  void setRaw(uint8_t index, const uint8_t segments[TM1637_DIGITS]);
+  void setTime(uint8_t index, int hour, int minute, bool colon);
+
+  // Send the changed digits of all displays in one pass; returns the number
+  // of data bytes written per display
+  uint8_t flush();
+
+  // Segments lit over all displays by the last flush (energy estimate)
+  uint16_t litSegments() const;
+
+  // Bus time of the last flush that sent something, and the longest so far
+  uint32_t lastFrameUs() const { return lastUs; }
+  uint32_t maxFrameUs() const { return maxUs; }
+
+private:
+  struct Display {
+    uint8_t clkPin;
+    uint8_t dioPin;
+    uint8_t pending[TM1637_DIGITS];
+    uint8_t shown[TM1637_DIGITS];
+  };
+
+  void play(const Tm1637Wave &clkWave);
+  static void playTick(uint16_t index, uint8_t sample, uint8_t changed, void *arg);
+
+  Display displays[TM1637_BANK_MAX];
+  uint8_t displayCount;
+  uint8_t pendingBrightness;
+  uint8_t shownBrightness;
+  bool shownValid;
+
+  // One encoded display at a time, folded into a DIO bit per display per tick
+  Tm1637Wave wave;
+  uint8_t dioBits[TM1637_WAVE_MAX_TICKS];
+
+  // Pin masks over GPIO 0-63 for the set/clear registers
+  uint64_t clkMask;
+  uint64_t dioMasks[TM1637_BANK_MAX];
+  uint64_t allMask;
+
+  uint32_t lastUs;
+  uint32_t maxUs;
+};
+
+#endif
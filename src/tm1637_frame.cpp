@@ -0,0 +1,112 @@
+#include "tm1637_frame.h"
+
+#include "bus_stats.h"
+#include "power.h"
+
+#define TM1637_BRIGHTNESS_UNSET 0xFF
+
+Tm1637Frame::Tm1637Frame(uint8_t clkPin, uint8_t dioPin)
+  : clkPin(clkPin),
+    dioPin(dioPin),
+    useRmt(false),
+    pending{0, 0, 0, 0},
+    shown{0, 0, 0, 0},
+    pendingBrightness(7),
+    shownBrightness(TM1637_BRIGHTNESS_UNSET),
+    shownValid(false) {}
+
+void Tm1637Frame::begin() {
+#if CLOCK_TM1637_RMT
+  useRmt = rmt.begin(clkPin, dioPin);
+#endif
+  if (!useRmt) {
+    // Both lines idle high; the module has its own pull-ups. DIO is
+    // open-drain so the chip can pull it low in the ACK slot.
+    pinMode(clkPin, OUTPUT);
+    pinMode(dioPin, OUTPUT_OPEN_DRAIN);
+    digitalWrite(clkPin, HIGH);
+    digitalWrite(dioPin, HIGH);
+  }
+  shownValid = false;
+  shownBrightness = TM1637_BRIGHTNESS_UNSET;
+}
+
+void Tm1637Frame::setBrightness(uint8_t level) {
+  pendingBrightness = level > 7 ? 7 : level;
+}
+
+void Tm1637Frame::clear() {
+  for (uint8_t i = 0; i < TM1637_DIGITS; i++) {
+    pending[i] = 0;
+  }
+}
+
+void Tm1637Frame::setRaw(const uint8_t segments[TM1637_DIGITS]) {
+  for (uint8_t i = 0; i < TM1637_DIGITS; i++) {
+    pending[i] = segments[i];
+  }
+}
+
+void Tm1637Frame::setTime(int hour, int minute, bool colon) {
+  pending[0] = TM1637_DIGIT_SEGMENTS[(hour / 10) % 10];
+  pending[1] = TM1637_DIGIT_SEGMENTS[hour % 10];
+  pending[2] = TM1637_DIGIT_SEGMENTS[(minute / 10) % 10];
+  pending[3] = TM1637_DIGIT_SEGMENTS[minute % 10];
+  if (colon) {
+    pending[TM1637_COLON_DIGIT] |= TM1637_COLON_BIT;
+  }
+}
+
+uint8_t Tm1637Frame::flush() {
+  uint8_t dirtyMask = tm1637DirtyMask(pending, shown, shownValid);
+  int brightness = pendingBrightness != shownBrightness ? pendingBrightness : -1;
+  uint8_t dirtyCount = tm1637WaveFlush(wave, pending, dirtyMask, brightness);
+
+  for (uint8_t i = 0; i < TM1637_DIGITS; i++) {
+    shown[i] = pending[i];
+  }
+  shownValid = true;
+  shownBrightness = pendingBrightness;
+
+  if (wave.length > 0) {
+#if CLOCK_TM1637_RMT
+    if (useRmt) {
+      // The pins belong to the RMT now; a frame that could not be queued
+      // is resent in full next time
+      if (!rmt.send(wave)) {
+        shownValid = false;
+        shownBrightness = TM1637_BRIGHTNESS_UNSET;
+      }
+    } else {
+      PowerLock lock;
+      tm1637WavePlay(wave, playTick, this);
+    }
+#else
+    PowerLock lock;
+    tm1637WavePlay(wave, playTick, this);
+#endif
+    busStatsCountGpioCycles(wave.clockCycles);
+  }
+
+  return dirtyCount;
+}
+
+uint8_t Tm1637Frame::litSegments() const {
+  uint8_t count = 0;
+  for (uint8_t i = 0; shownValid && i < TM1637_DIGITS; i++) {
+    count += __builtin_popcount(shown[i]);
+  }
+  return count;
+}
+
+// Bit-bang backend: one sample per tick, only the line that changes is written
+void Tm1637Frame::playTick(uint16_t index, uint8_t sample, uint8_t changed, void *arg) {
+  Tm1637Frame *self = static_cast<Tm1637Frame *>(arg);
+  if (changed & TM1637_WAVE_CLK) {
+    digitalWrite(self->clkPin, (sample & TM1637_WAVE_CLK) ? HIGH : LOW);
+  }
+  if (changed & TM1637_WAVE_DIO) {
+    digitalWrite(self->dioPin, (sample & TM1637_WAVE_DIO) ? HIGH : LOW);
+  }
+  delayMicroseconds(TM1637_TICK_US);
+}
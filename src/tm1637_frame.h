@@ -0,0 +1,74 @@
+#ifndef TM1637_FRAME_H
+#define TM1637_FRAME_H
+
+#include <Arduino.h>
+
+#include "tm1637_rmt.h"
+#include "tm1637_wave.h"
+
+// Segment mapping: A=0x01, B=0x02, C=0x04, D=0x08, E=0x10, F=0x20, G=0x40
+// On 4-digit clock modules the colon is bit 7 of the second digit.
+#define TM1637_COLON_DIGIT 1
+#define TM1637_COLON_BIT 0x80
+
+// Digit-to-segment encoding, resolved at compile time
+constexpr uint8_t TM1637_DIGIT_SEGMENTS[10] = {
+  0x3F,  // 0
+  0x06,  // 1
+  0x5B,  // 2
+  0x4F,  // 3
+  0x66,  // 4
+  0x6D,  // 5
+  0x7D,  // 6
+  0x07,  // 7
+  0x7F,  // 8
+  0x6F   // 9
+};
+
+// Framebuffer for a TM1637 4-digit display.
+//
+// Keeps the raw segment bytes last sent to the chip and only pushes the
+// addresses that changed. A colon blink is therefore a single one-byte
+// fixed-address write instead of a full frame. Nothing here allocates.
+//
+// flush() encodes its writes into one tm1637_wave waveform and hands it to
+// the backend: the RMT peripheral when built with it and its channels are
+// free, otherwise bit-bang on the GPIOs. Both play the same samples.
+class Tm1637Frame {
+public:
+  Tm1637Frame(uint8_t clkPin, uint8_t dioPin);
+
+  void begin();
+  void setBrightness(uint8_t level);  // 0-7
+  void clear();
+  void setRaw(const uint8_t segments[TM1637_DIGITS]);
+  void setTime(int hour, int minute, bool colon);
+
+  // Send every changed address to the chip; returns the number of data bytes written
+  uint8_t flush();
+
+  // Segments lit by the last flush and the level in effect (energy estimate)
+  uint8_t litSegments() const;
+  uint8_t brightness() const { return pendingBrightness; }
+
+  // True when frames go out through the RMT peripheral
+  bool usesRmt() const { return useRmt; }
+
+private:
+  static void playTick(uint16_t index, uint8_t sample, uint8_t changed, void *arg);
+
+  uint8_t clkPin;
+  uint8_t dioPin;
+  Tm1637Wave wave;
+  bool useRmt;
+#if CLOCK_TM1637_RMT
+  Tm1637Rmt rmt;
+#endif
+  uint8_t pending[TM1637_DIGITS];
+  uint8_t shown[TM1637_DIGITS];
+  uint8_t pendingBrightness;
+  uint8_t shownBrightness;
+  bool shownValid;
+};
+
+#endif
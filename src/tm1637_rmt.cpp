@@ -0,0 +1,103 @@
+#include "tm1637_rmt.h"
+
+#if CLOCK_TM1637_RMT
+
+#include <driver/gpio.h>
+#include <esp_rom_gpio.h>
+#include <esp_timer.h>
+#include <soc/rmt_periph.h>
+
+#include "latency.h"
+#include "log.h"
+#include "power.h"
+
+// 80 MHz APB / 80 = 1 us per RMT tick
+#define TM1637_RMT_CLK_DIV 80
+
+// tm1637WaveItems() packs straight into the driver's items
+static_assert(sizeof(rmt_item32_t) == sizeof(uint32_t), "rmt_item32_t is one 32-bit word");
+
+Tm1637Rmt::Tm1637Rmt() : itemCount{0, 0}, ready(false), transferring(false), startUs(0) {}
+
+// Function to configure one TX channel that idles high
+static bool configureChannel(rmt_channel_t channel, uint8_t pin) {
+  rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)pin, channel);
+  config.clk_div = TM1637_RMT_CLK_DIV;
+  config.tx_config.idle_output_en = true;
+  config.tx_config.idle_level = RMT_IDLE_LEVEL_HIGH;
+  if (rmt_config(&config) != ESP_OK) {
+    return false;
+  }
+  return rmt_driver_install(channel, 0, 0) == ESP_OK;
+}
+
+bool Tm1637Rmt::begin(uint8_t clkPin, uint8_t dioPin) {
+  if (!configureChannel(TM1637_RMT_CLK_CHANNEL, clkPin)) {
+    LOGW("[Display] ⚠ RMT channel for CLK unavailable, using bit-bang");
+    return false;
+  }
+  if (!configureChannel(TM1637_RMT_DIO_CHANNEL, dioPin)) {
+    rmt_driver_uninstall(TM1637_RMT_CLK_CHANNEL);
+    LOGW("[Display] ⚠ RMT channel for DIO unavailable, using bit-bang");
+    return false;
+  }
+
+  // Open-drain DIO: setting the direction reconnects the pin to plain GPIO
+  // output, so route the RMT signal back afterwards
+  gpio_set_direction((gpio_num_t)dioPin, GPIO_MODE_INPUT_OUTPUT_OD);
+  esp_rom_gpio_connect_out_signal(dioPin,
+      rmt_periph_signals.groups[0].channels[TM1637_RMT_DIO_CHANNEL].tx_sig, false, false);
+
+  rmt_add_channel_to_group(TM1637_RMT_CLK_CHANNEL);
+  rmt_add_channel_to_group(TM1637_RMT_DIO_CHANNEL);
+  rmt_register_tx_end_callback(onTransferDone, this);
+
+  ready = true;
+  LOGI("[Display] ✓ TM1637 on RMT channels %d/%d", (int)TM1637_RMT_CLK_CHANNEL,
+       (int)TM1637_RMT_DIO_CHANNEL);
+  return true;
+}
+
+// Function to pack one line's runs into RMT items, two runs per item
+bool Tm1637Rmt::encode(const Tm1637Wave &wave, uint8_t line, uint8_t index) {
+  itemCount[index] = tm1637WaveItems(wave, line, &items[index][0].val, TM1637_RMT_MAX_ITEMS);
+  return itemCount[index] != 0;
+}
+
+bool Tm1637Rmt::send(const Tm1637Wave &wave) {
+  if (!ready || wave.overflow || wave.length == 0) {
+    return false;
+  }
+
+  TickType_t timeout = pdMS_TO_TICKS(TM1637_RMT_WAIT_MS);
+  if (rmt_wait_tx_done(TM1637_RMT_CLK_CHANNEL, timeout) != ESP_OK ||
+      rmt_wait_tx_done(TM1637_RMT_DIO_CHANNEL, timeout) != ESP_OK) {
+    return false;
+  }
+
+  if (!encode(wave, TM1637_WAVE_CLK, 0) || !encode(wave, TM1637_WAVE_DIO, 1)) {
+    return false;
+  }
+
+  // Neither channel starts until both have been started (sync group); the
+  // CPU lock is released by the end interrupt
+  powerLockAcquire();
+  startUs = esp_timer_get_time();
+  transferring.store(true, std::memory_order_release);
+  rmt_write_items(TM1637_RMT_CLK_CHANNEL, items[0], itemCount[0], false);
+  rmt_write_items(TM1637_RMT_DIO_CHANNEL, items[1], itemCount[1], false);
+  return true;
+}
+
+// Runs in the RMT interrupt; both lines end on the same tick, so DIO stands for the frame
+void Tm1637Rmt::onTransferDone(rmt_channel_t channel, void *arg) {
+  if (channel != TM1637_RMT_DIO_CHANNEL) {
+    return;
+  }
+  Tm1637Rmt *self = static_cast<Tm1637Rmt *>(arg);
+  LATENCY_RECORD(LATENCY_DISPLAY_WIRE, (uint32_t)(esp_timer_get_time() - self->startUs));
+  self->transferring.store(false, std::memory_order_release);
+  powerLockRelease();
+}
+
+#endif
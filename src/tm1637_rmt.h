@@ -0,0 +1,60 @@
+#ifndef TM1637_RMT_H
+#define TM1637_RMT_H
+
+#include <Arduino.h>
+
+// TM1637 transfers through the RMT peripheral.
+//
+// CLK and DIO each get an RMT TX channel. Both channels are in one sync
+// group, so they start on the same APB cycle. A waveform from tm1637_wave is
+// run-length encoded into RMT items, 1 us per RMT tick. send() returns once
+// the transfer is queued; the CPU is free while the frame clocks out (about
+// 1 ms for a full frame). The end-of-transfer interrupt clears busy() and
+// records the time on the wire (`display_wire` latency probe). DIO is
+// open-drain, so the ACK slot is the released line and the chip can pull it
+// low without contention.
+//
+// Build with -DCLOCK_TM1637_RMT=0 to keep the bit-bang backend only.
+
+#ifndef CLOCK_TM1637_RMT
+#define CLOCK_TM1637_RMT 1
+#endif
+
+#if CLOCK_TM1637_RMT
+
+#include <atomic>
+#include <driver/rmt.h>
+
+#include "tm1637_wave.h"
+
+#define TM1637_RMT_CLK_CHANNEL RMT_CHANNEL_0
+#define TM1637_RMT_DIO_CHANNEL RMT_CHANNEL_1
+#define TM1637_RMT_MAX_ITEMS 96   // Per line; a full flush needs ~45
+#define TM1637_RMT_WAIT_MS 10     // Longest wait for the previous transfer
+
+class Tm1637Rmt {
+public:
+  Tm1637Rmt();
+
+  // Claim both channels and route them to the pins; false leaves the pins as GPIO
+  bool begin(uint8_t clkPin, uint8_t dioPin);
+
+  // Queue a waveform; waits for the previous transfer first, since its items are reused
+  bool send(const Tm1637Wave &wave);
+
+  bool busy() const { return transferring.load(std::memory_order_acquire); }
+
+private:
+  bool encode(const Tm1637Wave &wave, uint8_t line, uint8_t index);
+  static void onTransferDone(rmt_channel_t channel, void *arg);
+
+  rmt_item32_t items[2][TM1637_RMT_MAX_ITEMS];
+  size_t itemCount[2];
+  bool ready;
+  std::atomic<bool> transferring;
+  int64_t startUs;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,162 @@
+#include "tm1637_wave.h"
+
+// Function to append `ticks` samples at the given levels
+static void hold(Tm1637Wave &wave, bool clk, bool dio, uint8_t ticks) {
+  uint8_t sample = (clk ? TM1637_WAVE_CLK : 0) | (dio ? TM1637_WAVE_DIO : 0);
+  for (uint8_t i = 0; i < ticks; i++) {
+    if (wave.length >= TM1637_WAVE_MAX_TICKS) {
+      wave.overflow = true;
+      return;
+    }
+    wave.samples[wave.length++] = sample;
+  }
+}
+
+// Function to read the DIO level the waveform currently ends with
+static bool lastDio(const Tm1637Wave &wave) {
+  return wave.length == 0 || (wave.samples[wave.length - 1] & TM1637_WAVE_DIO);
+}
+
+void tm1637WaveClear(Tm1637Wave &wave) {
+  wave.length = 0;
+  wave.clockCycles = 0;
+  wave.overflow = false;
+}
+
+// Start condition: DIO falls while CLK is high
+void tm1637WaveStart(Tm1637Wave &wave) {
+  hold(wave, true, true, 1);
+  hold(wave, true, false, 2);
+}
+
+// Each bit: CLK falls, then DIO moves, then CLK rises and the chip latches.
+// The ninth clock is the ACK slot: DIO is released and the chip pulls it low.
+void tm1637WaveByte(Tm1637Wave &wave, uint8_t value) {
+  for (uint8_t bit = 0; bit < 9; bit++) {
+    bool dio = bit < 8 ? (value >> bit) & 0x01 : true;
+    hold(wave, false, lastDio(wave), 1);
+    hold(wave, false, dio, 1);
+    hold(wave, true, dio, 2);
+  }
+  wave.clockCycles += 9;
+}
+
+// Stop condition: DIO rises while CLK is high
+void tm1637WaveStop(Tm1637Wave &wave) {
+  hold(wave, false, lastDio(wave), 1);
+  hold(wave, false, false, 1);
+  hold(wave, true, false, 2);
+  hold(wave, true, true, 2);
+  wave.clockCycles += 1;
+}
+
+void tm1637WaveCommand(Tm1637Wave &wave, uint8_t command) {
+  tm1637WaveStart(wave);
+  tm1637WaveByte(wave, command);
+  tm1637WaveStop(wave);
+}
+
+void tm1637WaveFixed(Tm1637Wave &wave, uint8_t address, uint8_t value) {
+  tm1637WaveStart(wave);
+  tm1637WaveByte(wave, TM1637_CMD_ADDRESS | address);
+  tm1637WaveByte(wave, value);
+  tm1637WaveStop(wave);
+}
+
+void tm1637WaveBurst(Tm1637Wave &wave, const uint8_t *values, uint8_t count) {
+  tm1637WaveCommand(wave, TM1637_CMD_DATA_AUTO);
+  tm1637WaveStart(wave);
+  tm1637WaveByte(wave, TM1637_CMD_ADDRESS);
+  for (uint8_t i = 0; i < count; i++) {
+    tm1637WaveByte(wave, values[i]);
+  }
+  tm1637WaveStop(wave);
+}
+
+uint8_t tm1637DirtyMask(const uint8_t pending[TM1637_DIGITS], const uint8_t shown[TM1637_DIGITS],
+                        bool shownValid) {
+  uint8_t dirtyMask = 0;
+  for (uint8_t i = 0; i < TM1637_DIGITS; i++) {
+    if (!shownValid || pending[i] != shown[i]) {
+      dirtyMask |= (1 << i);
+    }
+  }
+  return dirtyMask;
+}
+
+uint8_t tm1637WaveFlush(Tm1637Wave &wave, const uint8_t digits[TM1637_DIGITS], uint8_t dirtyMask,
+                        int brightness) {
+  tm1637WaveClear(wave);
+  uint8_t written = __builtin_popcount(dirtyMask);
+  if (written >= TM1637_BURST_THRESHOLD) {
+    tm1637WaveBurst(wave, digits, TM1637_DIGITS);
+    written = TM1637_DIGITS;
+  } else if (written > 0) {
+    tm1637WaveCommand(wave, TM1637_CMD_DATA_FIXED);
+    for (uint8_t i = 0; i < TM1637_DIGITS; i++) {
+      if (dirtyMask & (1 << i)) {
+        tm1637WaveFixed(wave, i, digits[i]);
+      }
+    }
+  }
+  if (brightness >= 0) {
+    tm1637WaveCommand(wave, TM1637_CMD_DISPLAY_ON | (brightness & 0x07));
+  }
+  return written;
+}
+
+// Function to pack one run into the next half item
+static bool addItemRun(uint32_t *items, size_t &halves, size_t maxItems, uint16_t ticks,
+                       uint8_t level) {
+  if (halves / 2 >= maxItems) {
+    return false;
+  }
+  uint32_t half = (uint32_t)(ticks * TM1637_TICK_US) | (uint32_t)level << 15;
+  if (halves % 2 == 0) {
+    items[halves / 2] = half;
+  } else {
+    items[halves / 2] |= half << 16;
+  }
+  halves++;
+  return true;
+}
+
+size_t tm1637WaveItems(const Tm1637Wave &wave, uint8_t line, uint32_t *items, size_t maxItems) {
+  size_t halves = 0;
+  uint16_t ticks = 0;
+  uint8_t level = 0;
+  for (uint16_t i = 0; i < wave.length; i++) {
+    uint8_t sample = (wave.samples[i] & line) ? 1 : 0;
+    if (ticks > 0 && sample != level) {
+      if (!addItemRun(items, halves, maxItems, ticks, level)) {
+        return 0;
+      }
+      ticks = 0;
+    }
+    level = sample;
+    ticks++;
+  }
+  if (ticks > 0 && !addItemRun(items, halves, maxItems, ticks, level)) {
+    return 0;
+  }
+  // End marker: the spare half of the last item (level high, the idle
+  // level), or a whole zero item
+  if (halves % 2 == 1) {
+    items[halves / 2] |= (uint32_t)1 << 31;
+    return halves / 2 + 1;
+  }
+  if (halves / 2 >= maxItems) {
+    return 0;
+  }
+  items[halves / 2] = 0;
+  return halves / 2 + 1;
+}
+
+void tm1637WavePlay(const Tm1637Wave &wave, Tm1637TickFn tick, void *arg) {
+  uint8_t last = TM1637_WAVE_CLK | TM1637_WAVE_DIO;
+  for (uint16_t i = 0; i < wave.length; i++) {
+    uint8_t sample = wave.samples[i];
+    tick(i, sample, sample ^ last, arg);
+    last = sample;
+  }
+}
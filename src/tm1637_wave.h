@@ -0,0 +1,89 @@
+#ifndef TM1637_WAVE_H
+#define TM1637_WAVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// TM1637 wire protocol as a sampled waveform.
+//
+// A transfer is described as the levels of CLK and DIO on a fixed tick grid,
+// one sample per tick. Both display backends play the same samples: the
+// bit-bang backend writes them to the pins tick by tick, the RMT backend
+// turns each line into runs (level, ticks) for the peripheral. Because the
+// encoder is the single source of timing, the two backends put identical
+// waveforms on the wire; tools/tm1637_sim.cpp checks this on the host. The
+// flush encoder, the RMT item packing and the bit-bang player live here too,
+// with no Arduino dependency, so the host tool runs the production code.
+//
+// Timing rules the encoder keeps: DIO only changes while CLK is low, except
+// for start (DIO falls) and stop (DIO rises) while CLK is steadily high; CLK
+// and DIO never change on the same tick. A DIO level of 1 means "released":
+// the line is open-drain and the module's pull-up (or the chip's ACK) sets it.
+
+#define TM1637_DIGITS 4
+#define TM1637_TICK_US 4            // Shortest level; a bit takes 4 ticks
+#define TM1637_WAVE_MAX_TICKS 512   // A full flush needs ~300
+
+// Above this many changed digits one auto-increment burst is cheaper than
+// separate fixed-address writes
+#define TM1637_BURST_THRESHOLD 3
+
+#define TM1637_WAVE_CLK 0x01
+#define TM1637_WAVE_DIO 0x02
+
+// TM1637 commands
+#define TM1637_CMD_DATA_AUTO 0x40   // Write data, auto-increment address
+#define TM1637_CMD_DATA_FIXED 0x44  // Write data, fixed address
+#define TM1637_CMD_ADDRESS 0xC0     // OR'ed with the digit address
+#define TM1637_CMD_DISPLAY_ON 0x88  // OR'ed with brightness 0-7
+
+struct Tm1637Wave {
+  uint16_t length;                         // Samples used
+  uint16_t clockCycles;                    // CLK pulses, for the bus counters
+  bool overflow;                           // A transfer did not fit
+  uint8_t samples[TM1637_WAVE_MAX_TICKS];  // TM1637_WAVE_CLK | TM1637_WAVE_DIO
+};
+
+// Start an empty waveform (both lines idle high)
+void tm1637WaveClear(Tm1637Wave &wave);
+
+// Protocol pieces
+void tm1637WaveStart(Tm1637Wave &wave);
+void tm1637WaveByte(Tm1637Wave &wave, uint8_t value);  // LSB first plus ACK slot
+void tm1637WaveStop(Tm1637Wave &wave);
+
+// Whole transactions as the frame buffer uses them
+void tm1637WaveCommand(Tm1637Wave &wave, uint8_t command);
+void tm1637WaveFixed(Tm1637Wave &wave, uint8_t address, uint8_t value);
+void tm1637WaveBurst(Tm1637Wave &wave, const uint8_t *values, uint8_t count);
+
+// Digits whose segments differ from what the chip shows, one bit per digit;
+// all of them when the chip's contents are unknown
+uint8_t tm1637DirtyMask(const uint8_t pending[TM1637_DIGITS], const uint8_t shown[TM1637_DIGITS],
+                        bool shownValid);
+
+// Encode one flush: the digits in dirtyMask (one auto-increment burst of all
+// four from TM1637_BURST_THRESHOLD up, fixed-address writes below), then the
+// display control command when brightness is 0-7 (-1 leaves it alone). The
+// transactions depend only on the mask and brightness, never on the data.
+// Returns the number of data bytes written.
+uint8_t tm1637WaveFlush(Tm1637Wave &wave, const uint8_t digits[TM1637_DIGITS], uint8_t dirtyMask,
+                        int brightness);
+
+// Pack one line (TM1637_WAVE_CLK or TM1637_WAVE_DIO) into RMT items, two runs per 32-bit item in the
+// rmt_item32_t layout (duration0:15, level0:1, duration1:15, level1:1) at
+// 1 us per RMT tick, ended by a zero duration. Returns the number of items,
+// 0 if they do not fit in maxItems.
+#define TM1637_ITEM_DURATION0(item) ((item) & 0x7FFF)
+#define TM1637_ITEM_LEVEL0(item) (((item) >> 15) & 0x01)
+#define TM1637_ITEM_DURATION1(item) (((item) >> 16) & 0x7FFF)
+#define TM1637_ITEM_LEVEL1(item) (((item) >> 31) & 0x01)
+size_t tm1637WaveItems(const Tm1637Wave &wave, uint8_t line, uint32_t *items, size_t maxItems);
+
+// Bit-bang: call `tick` once per sample, in order, with the lines that
+// changed since the previous one (the bus starts idle high). The callback
+// sets the pins and waits TM1637_TICK_US.
+typedef void (*Tm1637TickFn)(uint16_t index, uint8_t sample, uint8_t changed, void *arg);
+void tm1637WavePlay(const Tm1637Wave &wave, Tm1637TickFn tick, void *arg);
+
+#endif
@@ -0,0 +1,404 @@
+#include "tz_engine.h"
+
+#include <atomic>
+#include <ctype.h>
+
+// One DST transition rule: Mm.w.d, Jn (1-365, no Feb 29) or n (0-365)
+struct TzRule {
+  char kind;  // 'M', 'J' or 'D'
+  uint8_t month;
+  uint8_t week;
+  uint8_t weekday;
+  uint16_t day;
+  int32_t timeS;  // Local wall time of the change, may be negative or > 24 h
+};
+
+struct TzZone {
+  char posix[TZ_POSIX_MAX];
+  int32_t stdOffsetS;  // Local minus UTC
+  int32_t dstOffsetS;
+  bool hasDst;
+  TzRule start;
+  TzRule end;
+};
+
+// Offset valid for UTC times in [fromUs, untilUs), computed for one zone
+struct TzWindow {
+  int64_t fromUs;
+  int64_t untilUs;
+  int32_t offsetS;
+  bool dst;
+  uint32_t generation;
+};
+
+// Two zone slots: tzSet() fills the inactive one, then bumps the generation.
+// Readers re-check the generation after using a slot and retry on a change.
+static TzZone zones[2] = {{"UTC0", 0, 0, false, {}, {}}, {}};
+static std::atomic<uint32_t> zoneGeneration{0};
+static portMUX_TYPE zoneLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Cached window, guarded by a sequence counter (odd = write in progress)
+static std::atomic<uint32_t> windowSeq{0};
+static TzWindow cachedWindow = {0, 0, 0, false, UINT32_MAX};
+static portMUX_TYPE windowLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Slot zones, each with a private window; fromUs > untilUs marks it stale
+static TzZone slotZones[TZ_SLOTS] = {};
+static TzWindow slotWindows[TZ_SLOTS] = {};
+
+static bool parseNumber(const char *&p, long max, long &value) {
+  if (!isdigit((unsigned char)*p)) {
+    return false;
+  }
+  value = 0;
+  while (isdigit((unsigned char)*p)) {
+    value = value * 10 + (*p++ - '0');
+    if (value > max) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Zone abbreviation: three or more letters, or anything inside <...>
+static bool parseName(const char *&p) {
+  const char *q = p;
+  if (*q == '<') {
+    q = strchr(q, '>');
+    if (!q || q - p < 4) {
+      return false;
+    }
+    p = q + 1;
+    return true;
+  }
+  while (isalpha((unsigned char)*q)) {
+    q++;
+  }
+  if (q - p < 3) {
+    return false;
+  }
+  p = q;
+  return true;
+}
+
+// [+-]hh[:mm[:ss]]
+static bool parseTime(const char *&p, long maxHours, int32_t &seconds) {
+  int sign = 1;
+  if (*p == '+' || *p == '-') {
+    sign = (*p == '-') ? -1 : 1;
+    p++;
+  }
+  long hours;
+  long minutes = 0;
+  long secs = 0;
+  if (!parseNumber(p, maxHours, hours)) {
+    return false;
+  }
+  if (*p == ':') {
+    p++;
+    if (!parseNumber(p, 59, minutes)) {
+      return false;
+    }
+    if (*p == ':') {
+      p++;
+      if (!parseNumber(p, 59, secs)) {
+        return false;
+      }
+    }
+  }
+  seconds = sign * (int32_t)(hours * 3600 + minutes * 60 + secs);
+  return true;
+}
+
+static bool parseRule(const char *&p, TzRule &rule) {
+  long a;
+  long b;
+  long c;
+  memset(&rule, 0, sizeof(rule));
+  if (*p == 'M') {
+    p++;
+    if (!parseNumber(p, 12, a) || a < 1 || *p++ != '.' ||
+        !parseNumber(p, 5, b) || b < 1 || *p++ != '.' ||
+        !parseNumber(p, 6, c)) {
+      return false;
+    }
+    rule.kind = 'M';
+    rule.month = a;
+    rule.week = b;
+    rule.weekday = c;
+  } else if (*p == 'J') {
+    p++;
+    if (!parseNumber(p, 365, a) || a < 1) {
+      return false;
+    }
+    rule.kind = 'J';
+    rule.day = a;
+  } else if (parseNumber(p, 365, a)) {
+    rule.kind = 'D';
+    rule.day = a;
+  } else {
+    return false;
+  }
+
+  rule.timeS = 2 * 3600;
+  if (*p == '/') {
+    p++;
+    return parseTime(p, 167, rule.timeS);
+  }
+  return true;
+}
+
+static bool parseZone(const char *posix, TzZone &zone) {
+  if (strlen(posix) >= TZ_POSIX_MAX) {
+    return false;
+  }
+  const char *p = posix;
+  int32_t offset;
+
+  // POSIX offsets count hours west of UTC, the opposite of UTC+h notation
+  if (!parseName(p) || !parseTime(p, 24, offset)) {
+    return false;
+  }
+  zone.stdOffsetS = -offset;
+  zone.hasDst = false;
+
+  if (*p) {
+    if (!parseName(p)) {
+      return false;
+    }
+    zone.hasDst = true;
+    zone.dstOffsetS = zone.stdOffsetS + 3600;
+    if (*p && *p != ',') {
+      if (!parseTime(p, 24, offset)) {
+        return false;
+      }
+      zone.dstOffsetS = -offset;
+    }
+    if (*p == ',') {
+      p++;
+      if (!parseRule(p, zone.start) || *p++ != ',' || !parseRule(p, zone.end)) {
+        return false;
+      }
+    } else {
+      // No rules given: the POSIX default (US rules)
+      const char *us = "M3.2.0,M11.1.0";
+      parseRule(us, zone.start);
+      us++;
+      parseRule(us, zone.end);
+    }
+  }
+  if (*p) {
+    return false;
+  }
+
+  strcpy(zone.posix, posix);
+  return true;
+}
+
+static bool isLeapYear(int64_t year) {
+  return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static int daysInMonth(int64_t year, int month) {
+  static const uint8_t days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  return (month == 2 && isLeapYear(year)) ? 29 : days[month - 1];
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+static int64_t daysFromCivil(int64_t year, int month, int day) {
+  year -= month <= 2;
+  int64_t era = (year >= 0 ? year : year - 399) / 400;
+  int64_t yearOfEra = year - era * 400;
+  int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return era * 146097 + dayOfEra - 719468;
+}
+
+static int64_t yearFromDays(int64_t days) {
+  days += 719468;
+  int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  int64_t dayOfEra = days - era * 146097;
+  int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+  return yearOfEra + era * 400 + (monthIndex >= 10 ? 1 : 0);
+}
+
+// Local date of a rule in a given year, as days since the epoch
+static int64_t ruleDay(const TzRule &rule, int64_t year) {
+  int64_t jan1 = daysFromCivil(year, 1, 1);
+  switch (rule.kind) {
+    case 'M': {
+      int64_t first = daysFromCivil(year, rule.month, 1);
+      int firstWeekday = (int)(((first + 4) % 7 + 7) % 7);  // 1970-01-01 was a Thursday
+      int day = 1 + (rule.weekday - firstWeekday + 7) % 7 + (rule.week - 1) * 7;
+      while (day > daysInMonth(year, rule.month)) {
+        day -= 7;
+      }
+      return first + day - 1;
+    }
+    case 'J':
+      return jan1 + rule.day - 1 + (isLeapYear(year) && rule.day >= 60 ? 1 : 0);
+    default:
+      return jan1 + rule.day;
+  }
+}
+
+// UTC instant of a transition; the rule time is wall time before the change
+static int64_t transitionUs(const TzRule &rule, int64_t year, int32_t offsetBeforeS) {
+  int64_t localS = ruleDay(rule, year) * 86400LL + rule.timeS;
+  return (localS - offsetBeforeS) * 1000000LL;
+}
+
+static void computeWindow(const TzZone &zone, int64_t utcUs, TzWindow &window) {
+  window.fromUs = INT64_MIN;
+  window.untilUs = INT64_MAX;
+  window.offsetS = zone.stdOffsetS;
+  window.dst = false;
+  if (!zone.hasDst) {
+    return;
+  }
+
+  // Transitions of the neighbouring years bracket any instant in this one,
+  // in either hemisphere
+  struct {
+    int64_t atUs;
+    bool dst;
+  } transitions[6];
+  int64_t seconds = utcUs / 1000000LL - (utcUs % 1000000LL < 0 ? 1 : 0);
+  int64_t days = seconds / 86400 - (seconds % 86400 < 0 ? 1 : 0);
+  int64_t year = yearFromDays(days);
+  int count = 0;
+  for (int64_t y = year - 1; y <= year + 1; y++) {
+    transitions[count].atUs = transitionUs(zone.start, y, zone.stdOffsetS);
+    transitions[count++].dst = true;
+    transitions[count].atUs = transitionUs(zone.end, y, zone.dstOffsetS);
+    transitions[count++].dst = false;
+  }
+  for (int i = 1; i < count; i++) {
+    for (int j = i; j > 0 && transitions[j].atUs < transitions[j - 1].atUs; j--) {
+      auto swap = transitions[j];
+      transitions[j] = transitions[j - 1];
+      transitions[j - 1] = swap;
+    }
+  }
+
+  for (int i = 0; i < count; i++) {
+    if (transitions[i].atUs <= utcUs) {
+      window.fromUs = transitions[i].atUs;
+      window.dst = transitions[i].dst;
+    } else {
+      window.untilUs = transitions[i].atUs;
+      break;
+    }
+  }
+  window.offsetS = window.dst ? zone.dstOffsetS : zone.stdOffsetS;
+}
+
+static void readWindow(TzWindow &window) {
+  uint32_t before;
+  uint32_t after;
+  do {
+    before = windowSeq.load(std::memory_order_acquire);
+    window = cachedWindow;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = windowSeq.load(std::memory_order_relaxed);
+  } while ((before & 1) || before != after);
+}
+
+static void publishWindow(const TzWindow &window) {
+  portENTER_CRITICAL(&windowLock);
+  uint32_t seq = windowSeq.load(std::memory_order_relaxed);
+  windowSeq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  cachedWindow = window;
+  windowSeq.store(seq + 2, std::memory_order_release);
+  portEXIT_CRITICAL(&windowLock);
+}
+
+static void windowAt(int64_t utcUs, TzWindow &window) {
+  readWindow(window);
+  uint32_t generation = zoneGeneration.load(std::memory_order_acquire);
+  if (window.generation == generation && utcUs >= window.fromUs && utcUs < window.untilUs) {
+    return;
+  }
+
+  // Slow path: once per transition or zone change
+  do {
+    generation = zoneGeneration.load(std::memory_order_acquire);
+    computeWindow(zones[generation & 1], utcUs, window);
+    window.generation = generation;
+  } while (zoneGeneration.load(std::memory_order_acquire) != generation);
+  publishWindow(window);
+}
+
+bool tzSet(const char *posix) {
+  TzZone zone;
+  if (!parseZone(posix, zone)) {
+    return false;
+  }
+  portENTER_CRITICAL(&zoneLock);
+  uint32_t generation = zoneGeneration.load(std::memory_order_relaxed);
+  zones[(generation + 1) & 1] = zone;
+  zoneGeneration.store(generation + 1, std::memory_order_release);
+  portEXIT_CRITICAL(&zoneLock);
+  return true;
+}
+
+bool tzValid(const char *posix) {
+  TzZone zone;
+  return parseZone(posix, zone);
+}
+
+void tzGet(char *buffer, size_t size) {
+  uint32_t generation;
+  do {
+    generation = zoneGeneration.load(std::memory_order_acquire);
+    strncpy(buffer, zones[generation & 1].posix, size - 1);
+    buffer[size - 1] = 0;
+  } while (zoneGeneration.load(std::memory_order_acquire) != generation);
+}
+
+int64_t tzLocalUs(int64_t utcUs) {
+  TzWindow window;
+  windowAt(utcUs, window);
+  return utcUs + (int64_t)window.offsetS * 1000000LL;
+}
+
+void tzInfoAt(int64_t utcUs, TzInfo &info) {
+  TzWindow window;
+  windowAt(utcUs, window);
+  info.offsetS = window.offsetS;
+  info.dst = window.dst;
+  info.nextTransitionUs = window.untilUs;
+}
+
+bool tzSlotSet(uint8_t slot, const char *posix) {
+  TzZone zone;
+  if (slot >= TZ_SLOTS || !parseZone(posix, zone)) {
+    return false;
+  }
+  slotZones[slot] = zone;
+  slotWindows[slot].fromUs = INT64_MAX;
+  slotWindows[slot].untilUs = INT64_MIN;
+  return true;
+}
+
+int64_t tzSlotLocalUs(uint8_t slot, int64_t utcUs) {
+  if (slot >= TZ_SLOTS) {
+    return utcUs;
+  }
+  TzWindow &window = slotWindows[slot];
+  if (utcUs < window.fromUs || utcUs >= window.untilUs) {
+    computeWindow(slotZones[slot], utcUs, window);
+  }
+  return utcUs + (int64_t)window.offsetS * 1000000LL;
+}
+
+void tzFromUtcOffsetHours(int hours, char *buffer, size_t size) {
+  if (hours == 0) {
+    snprintf(buffer, size, "UTC0");
+  } else {
+    snprintf(buffer, size, "<%+03d>%d", hours, -hours);
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef TZ_ENGINE_H
+#define TZ_ENGINE_H
+
+#include <Arduino.h>
+
+// UTC to local time conversion driven by POSIX TZ strings.
+//
+// The clock and the DS1307 hold UTC; the zone only matters when time is shown.
+// A zone is given as a POSIX TZ string ("CET-1CEST,M3.5.0,M10.5.0/3",
+// "IST-5:30", "<+0545>-5:45"), with DST rules in Mm.w.d, Jn or n form.
+//
+// The converter caches the current UTC offset together with the interval it
+// is valid for (previous and next transition). Converting a time inside that
+// interval is a range check and an add; the calendar work to find the next
+// transition runs once per transition or zone change. The cache is shared by
+// all tasks and guarded by a sequence counter like the soft clock.
+
+#define TZ_POSIX_MAX 48
+
+struct TzInfo {
+  int32_t offsetS;            // Local minus UTC, seconds
+  bool dst;
+  int64_t nextTransitionUs;   // UTC, INT64_MAX if the zone has no DST
+};
+
+// Parse and activate a zone; returns false (keeping the old one) if invalid
+bool tzSet(const char *posix);
+
+// Check that a string parses as a POSIX TZ zone
+bool tzValid(const char *posix);
+
+// Copy the active zone string
+void tzGet(char *buffer, size_t size);
+
+// Local time for a UTC time (microseconds since the epoch)
+int64_t tzLocalUs(int64_t utcUs);
+
+// Offset, DST flag and next transition in effect at a UTC time
+void tzInfoAt(int64_t utcUs, TzInfo &info);
+
+// Extra zones for displays that show another place than the active zone.
+// Each slot keeps its own cached window and belongs to one task (the display
+// task), so there is no sequence counter; the active zone is unaffected.
+#define TZ_SLOTS 8
+
+// Parse a zone into a slot; returns false (slot unchanged) if invalid
+bool tzSlotSet(uint8_t slot, const char *posix);
+
+// Local time in a slot's zone for a UTC time (microseconds since the epoch)
+int64_t tzSlotLocalUs(uint8_t slot, int64_t utcUs);
+
+// POSIX string for a fixed whole-hour UTC offset (legacy timezone setting)
+void tzFromUtcOffsetHours(int hours, char *buffer, size_t size);
+
+#endif
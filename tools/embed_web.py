@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""Embed the web assets in web/ as gzip-compressed flash arrays.
+
+Runs as a PlatformIO pre-build script (extra_scripts = pre:tools/embed_web.py)
+and writes src/web_assets.h with one WebAsset entry per file: the gzip
+body, its length and a strong ETag derived from the content, plus the
+uncompressed file with its own ETag for clients that do not accept gzip
+(the two are different representations, so they must not share one). The
+header is
+only rewritten when it changes, so unchanged assets do not trigger a
+rebuild. It can also be run by hand from the project root.
+"""
+
+import gzip
+import hashlib
+import pathlib
+
+try:
+    Import('env')  # noqa: F821 - provided by PlatformIO/SCons
+    ROOT = pathlib.Path(env['PROJECT_DIR'])  # noqa: F821
+except NameError:
+    ROOT = pathlib.Path(__file__).resolve().parent.parent
+
+WEB_DIR = ROOT / 'web'
+OUTPUT = ROOT / 'src' / 'web_assets.h'
+
+CONTENT_TYPES = {
+    '.html': 'text/html',
+    '.css': 'text/css',
+    '.js': 'application/javascript',
+    '.json': 'application/json',
+    '.svg': 'image/svg+xml',
+    '.ico': 'image/x-icon',
+}
+
+
+def url_path(path):
+    rel = path.relative_to(WEB_DIR).as_posix()
+    if rel == 'index.html':
+        return '/'
+    return '/' + rel
+
+
+def symbol(path, suffix):
+    rel = path.relative_to(WEB_DIR).as_posix()
+    return 'web_' + ''.join(c if c.isalnum() else '_' for c in rel) + suffix
+
+
+def c_array(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append('  ' + ', '.join('0x%02x' % b for b in data[i:i + 16]) + ',')
+    return '\n'.join(lines)
+
+
+def generate():
+    assets = sorted(p for p in WEB_DIR.rglob('*') if p.is_file() and p.suffix in CONTENT_TYPES)
+    out = [
+        '// Generated by tools/embed_web.py from web/ - do not edit',
+        '#ifndef WEB_ASSETS_H',
+        '#define WEB_ASSETS_H',
+        '',
+        '#include <Arduino.h>',
+        '',
+        'struct WebAsset {',
+        '  const char *path;',
+        '  const char *contentType;',
+        '  const uint8_t *gzip;',
+        '  size_t length;',
+        '  const char *etag;',
+        '  const uint8_t *plain;  // Same file uncompressed',
+        '  size_t plainLength;',
+        '  const char *plainEtag;',
+        '};',
+        '',
+    ]
+    entries = []
+    total_raw = total_gz = 0
+    for path in assets:
+        raw = path.read_bytes()
+        # mtime=0 keeps the output (and the ETag) reproducible
+        data = gzip.compress(raw, compresslevel=9, mtime=0)
+        digest = hashlib.sha256(raw).hexdigest()[:16]
+        etag = '"%s"' % digest
+        plain_etag = '"%s-id"' % digest
+        total_raw += len(raw)
+        total_gz += len(data)
+        gz_symbol = symbol(path, '_gz')
+        plain_symbol = symbol(path, '')
+        out.append('// %s: %d bytes, %d gzipped' % (path.relative_to(ROOT).as_posix(), len(raw), len(data)))
+        out.append('static const uint8_t %s[] PROGMEM = {' % gz_symbol)
+        out.append(c_array(data))
+        out.append('};')
+        out.append('static const uint8_t %s[] PROGMEM = {' % plain_symbol)
+        out.append(c_array(raw))
+        out.append('};')
+        out.append('')
+        entries.append('  {"%s", "%s", %s, sizeof(%s), "%s",\n   %s, sizeof(%s), "%s"},' % (
+            url_path(path), CONTENT_TYPES[path.suffix], gz_symbol, gz_symbol,
+            etag.replace('"', '\\"'), plain_symbol, plain_symbol,
+            plain_etag.replace('"', '\\"')))
+    out.append('static const WebAsset webAssets[] = {')
+    out.extend(entries)
+    out.append('};')
+    out.append('')
+    out.append('#define WEB_ASSET_COUNT (sizeof(webAssets) / sizeof(webAssets[0]))')
+    out.append('')
+    out.append('#endif')
+    text = '\n'.join(out) + '\n'
+
+    if not OUTPUT.exists() or OUTPUT.read_text() != text:
+        OUTPUT.write_text(text)
+        print('embed_web: %d assets, %d -> %d bytes' % (len(assets), total_raw, total_gz))
+
+
+generate()
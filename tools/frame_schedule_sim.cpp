@@ -0,0 +1,189 @@
+// Host check for the display task's wake-up schedule (src/frame_schedule.*).
+//
+// Runs the display loop against a model of the RTOS: the in-memory clock is
+// the tick counter's microsecond timer plus an offset, a sleep of n ticks
+// ends on the n-th tick boundary (so up to one tick early in wall time) plus
+// a little scheduling latency, and drawing a frame takes 20 us to 1.2 ms.
+// For a spread of tick phases it:
+//   - counts wake-ups per simulated minute and requires exactly 120 (two per
+//     second) in every minute without a clock step;
+//   - requires every scheduled frame to be drawn for a half-second edge, no
+//     more than 2 ms late, consecutive frames one edge apart, the
+//     colon alternating and the minute changing on its whole-second edge;
+//   - steps the clock forward and back (NTP corrections, RTC re-seeds,
+//     manual sets) with a notification, as the firmware does, and requires
+//     the minutes around each step to stay within two wake-ups of 120: the
+//     notified one, and one edge gained or lost as the step shifts the phase.
+//
+// Build and run from the repository root:
+//   g++ -std=gnu++11 -O2 -Wall -Wextra -Isrc tools/frame_schedule_sim.cpp src/frame_schedule.cpp -o frame_schedule_sim && ./frame_schedule_sim
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "frame_schedule.h"
+
+#define MINUTE_US 60000000LL
+
+static int failures = 0;
+
+static void fail(const char *name, const char *what, int64_t atUs) {
+  if (failures < 20) {
+    printf("FAIL %s: %s (at %lld us)\n", name, what, (long long)atUs);
+  }
+  failures++;
+}
+
+static int64_t randomUs(int64_t below) {
+  return (int64_t)(((uint64_t)rand() << 16 ^ (uint64_t)rand()) % (uint64_t)below);
+}
+
+struct Step {
+  int64_t atMonoUs;  // When the clock is stepped (tick timer)
+  int64_t byUs;      // Clock step, followed by a notification
+};
+
+struct Result {
+  int wakeups;
+  int earlyWakeups;  // Woke short of the edge and drew it anyway
+  int rollovers;
+};
+
+// Function to run the display loop for `minutes` and check every frame
+static Result run(const char *name, int64_t offsetUs, const std::vector<Step> &steps, int minutes) {
+  Result result = {0, 0, 0};
+  std::vector<int> perMinute(minutes + 1, 0);
+  std::vector<bool> stepped(minutes + 1, false);
+
+  int64_t monoUs = 1000000LL + randomUs(1000);
+  int64_t endUs = monoUs + minutes * MINUTE_US;
+  int64_t startUs = monoUs;
+  int64_t dueUs = 0;
+  int64_t lastRenderUs = 0;
+  bool lastScheduled = false;
+  size_t nextStep = 0;
+
+  while (monoUs < endUs) {
+    // Wake-up: draw the frame
+    int64_t clockUs = monoUs + offsetUs;
+    int64_t renderUs = frameRenderUs(clockUs, dueUs);
+    int minute = (int)((monoUs - startUs) / MINUTE_US);
+    if (monoUs != startUs) {  // The first frame is drawn at task start
+      perMinute[minute]++;
+      result.wakeups++;
+    }
+    if (renderUs != clockUs) {
+      result.earlyWakeups++;
+    }
+
+    if (dueUs != 0) {
+      int64_t lateUs = renderUs - dueUs;
+      if (lateUs < 0 || lateUs > 2000) {
+        fail(name, "frame not drawn for its edge", monoUs);
+      }
+      int64_t edgeUs = renderUs - renderUs % FRAME_PERIOD_US;
+      int64_t lastEdgeUs = lastRenderUs - lastRenderUs % FRAME_PERIOD_US;
+      if (lastScheduled && edgeUs - lastEdgeUs != FRAME_PERIOD_US) {
+        fail(name, "frames not one edge apart", monoUs);
+      }
+      if (lastScheduled && frameColonLit(renderUs) == frameColonLit(lastRenderUs)) {
+        fail(name, "colon did not toggle", monoUs);
+      }
+      if (lastScheduled && renderUs / MINUTE_US != lastRenderUs / MINUTE_US) {
+        if (renderUs % MINUTE_US > 2000) {
+          fail(name, "minute changed off its edge", monoUs);
+        }
+        result.rollovers++;
+      }
+    }
+    lastScheduled = dueUs != 0;
+    lastRenderUs = renderUs;
+
+    monoUs += 20 + randomUs(1200);  // Drawing the frame
+    dueUs = frameNextEdgeUs(renderUs);
+    uint32_t ticks = frameWaitMs(monoUs + offsetUs, dueUs);
+
+    // Sleep: ends on a tick boundary, unless a clock step notifies first
+    int64_t wakeUs = ticks == 0 ? monoUs : (monoUs / FRAME_TICK_US + ticks) * FRAME_TICK_US;
+    wakeUs += randomUs(40);
+    if (nextStep < steps.size() && steps[nextStep].atMonoUs <= wakeUs) {
+      const Step &step = steps[nextStep++];
+      int64_t atUs = step.atMonoUs > monoUs ? step.atMonoUs : monoUs;
+      offsetUs += step.byUs;
+      stepped[(atUs - startUs) / MINUTE_US] = true;
+      wakeUs = atUs + randomUs(40);
+      dueUs = 0;  // Notified: not a scheduled frame
+    }
+    monoUs = wakeUs;
+  }
+
+  for (int m = 0; m < minutes; m++) {
+    int expected = (int)(MINUTE_US / FRAME_PERIOD_US);
+    if (!stepped[m] && (m == 0 || !stepped[m - 1])) {
+      if (perMinute[m] != expected) {
+        char what[64];
+        snprintf(what, sizeof(what), "%d wake-ups in a steady minute", perMinute[m]);
+        fail(name, what, startUs + m * MINUTE_US);
+      }
+    } else if (abs(perMinute[m] - expected) > 2) {
+      // The step shifts the edges by less than one period; the notification is one more
+      char what[64];
+      snprintf(what, sizeof(what), "%d wake-ups in a minute with a step", perMinute[m]);
+      fail(name, what, startUs + m * MINUTE_US);
+    }
+  }
+  return result;
+}
+
+int main() {
+  srand(2002);
+  const int64_t epochUs = 1790000000LL * 1000000LL;  // Any epoch; only phases matter
+  const int minutes = 30;
+
+  // Steady clock across the tick phases, including ones that wake early
+  int totalEarly = 0;
+  for (int i = 0; i < 40; i++) {
+    Result result = run("steady", epochUs + randomUs(1000000), std::vector<Step>(), minutes);
+    totalEarly += result.earlyWakeups;
+    if (result.rollovers != minutes && result.rollovers != minutes - 1) {
+      fail("steady", "minute rollovers missing", 0);
+    }
+    if (i == 0) {
+      printf("ok   steady          %d wake-ups in %d min (%.1f/s)\n", result.wakeups, minutes,
+             result.wakeups / (minutes * 60.0));
+    }
+  }
+  printf("ok   tick phases     40 runs, %d wake-ups short of the edge drawn as the edge\n",
+         totalEarly);
+
+  // Clock steps as the firmware makes them
+  const struct {
+    const char *name;
+    int64_t byUs;
+  } cases[] = {
+    {"ntp +37 ms", 37000},
+    {"ntp -480 ms", -480000},
+    {"ntp +0.2 ms", 200},
+    {"rtc re-seed +3 s", 3000000},
+    {"manual set -2 s", -2000000},
+    {"manual set +1 h", 3600000000LL},
+  };
+  for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+    std::vector<Step> steps;
+    for (int m = 3; m < minutes; m += 7) {
+      Step step = {1000000LL + m * MINUTE_US + randomUs(MINUTE_US), cases[c].byUs};
+      steps.push_back(step);
+    }
+    Result result = run(cases[c].name, epochUs + randomUs(1000000), steps, minutes);
+    printf("ok   %-16s %d wake-ups in %d min, %u steps\n", cases[c].name, result.wakeups,
+           minutes, (unsigned)steps.size());
+  }
+
+  if (failures) {
+    printf("%d failure(s)\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Decode compact (tokenized) clock logs back into text.
+
+Firmware built with -DCLOCK_LOG_COMPACT=1 prints lines such as
+
+    ~3f2a9c01 1700000000 "pool.ntp.org"
+
+where the token is the FNV-1a hash of the LOGx() format string. This tool
+scans the sources for those format strings, rebuilds the token table and
+expands every token line it reads. Other lines pass through unchanged.
+
+Usage:
+    pio device monitor | tools/log_decode.py
+    tools/log_decode.py capture.log
+"""
+
+import argparse
+import pathlib
+import re
+import shlex
+import sys
+
+ROOT = pathlib.Path(__file__).resolve().parent.parent
+
+# LOGE/LOGW/LOGI/LOGD("...") and LOG_TOKEN("..."), including adjacent literals
+CALL_RE = re.compile(r'\b(?:LOG[EWID]|LOG_TOKEN)\(\s*((?:"(?:[^"\\]|\\.)*"\s*)+)')
+LITERAL_RE = re.compile(r'"((?:[^"\\]|\\.)*)"')
+TOKEN_LINE_RE = re.compile(r'^~([0-9a-f]{8})(.*)$')
+SPEC_RE = re.compile(r'%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z|j|t)?([diouxXeEfgGcs%])')
+
+ESCAPES = {'n': '\n', 't': '\t', 'r': '\r', '0': '\0', '\\': '\\', '"': '"', "'": "'"}
+
+
+def unescape(literal):
+    out = []
+    i = 0
+    while i < len(literal):
+        ch = literal[i]
+        if ch == '\\' and i + 1 < len(literal):
+            out.append(ESCAPES.get(literal[i + 1], literal[i + 1]))
+            i += 2
+        else:
+            out.append(ch)
+            i += 1
+    return ''.join(out)
+
+
+def fnv1a(data):
+    h = 2166136261
+    for byte in data:
+        h = ((h ^ byte) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def build_table(source_dir):
+    table = {}
+    for path in sorted(source_dir.rglob('*')):
+        if path.suffix not in ('.c', '.cpp', '.h'):
+            continue
+        text = path.read_text(encoding='utf-8', errors='replace')
+        for match in CALL_RE.finditer(text):
+            fmt = ''.join(unescape(lit) for lit in LITERAL_RE.findall(match.group(1)))
+            table[fnv1a(fmt.encode('utf-8'))] = fmt
+    return table
+
+
+def render(fmt, args):
+    values = iter(args)
+
+    def substitute(match):
+        flags, conv = match.group(1), match.group(2)
+        if conv == '%':
+            return '%'
+        raw = next(values, '?')
+        try:
+            if conv in 'diouxXc':
+                value = int(raw)
+                if conv == 'u':
+                    conv = 'd'
+            elif conv in 'eEfgG':
+                value = float(raw)
+            else:
+                value = raw
+            return ('%' + flags + conv) % value
+        except (TypeError, ValueError):
+            return raw
+
+    return SPEC_RE.sub(substitute, fmt)
+
+
+def decode_line(line, table):
+    match = TOKEN_LINE_RE.match(line)
+    if not match:
+        return line
+    token = int(match.group(1), 16)
+    fmt = table.get(token)
+    if fmt is None:
+        return '<unknown token %08x>%s' % (token, match.group(2))
+    try:
+        args = shlex.split(match.group(2), posix=True)
+    except ValueError:
+        args = match.group(2).split()
+    return render(fmt, args)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('logfile', nargs='?', help='capture to decode (default: stdin)')
+    parser.add_argument('--src', default=str(ROOT / 'src'), help='firmware source directory')
+    args = parser.parse_args()
+
+    table = build_table(pathlib.Path(args.src))
+    stream = open(args.logfile, encoding='utf-8', errors='replace') if args.logfile else sys.stdin
+    with stream:
+        for line in stream:
+            print(decode_line(line.rstrip('\r\n'), table), flush=True)
+
+
+if __name__ == '__main__':
+    main()
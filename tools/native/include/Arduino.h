@@ -0,0 +1,125 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// Host stand-in for the parts of the Arduino-ESP32 core the firmware uses,
+// for the native simulation (tools/native). Time, GPIO and the heap are
+// modelled in tools/native/sim_arduino.cpp.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_TIMEOUT 0x107
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define PROGMEM
+
+typedef uint8_t byte;
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define OUTPUT_OPEN_DRAIN 0x13
+
+template <class T, class L, class H>
+T constrain(T value, L low, H high) {
+  return value < low ? (T)low : (value > high ? (T)high : value);
+}
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+
+bool setCpuFrequencyMhz(uint32_t mhz);
+uint32_t getCpuFrequencyMhz();
+bool psramFound();
+
+class String {
+ public:
+  String() {}
+  String(const char *text) : value(text ? text : "") {}
+  String &operator+=(const char *text) {
+    value += text;
+    return *this;
+  }
+  String &operator+=(const String &other) {
+    value += other.value;
+    return *this;
+  }
+  String &operator+=(char c) {
+    value += c;
+    return *this;
+  }
+  const char *c_str() const { return value.c_str(); }
+  size_t length() const { return value.size(); }
+
+ private:
+  std::string value;
+};
+
+class IPAddress {
+ public:
+  IPAddress() : address(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+      : address((uint32_t)a | (uint32_t)b << 8 | (uint32_t)c << 16 | (uint32_t)d << 24) {}
+  IPAddress(uint32_t address) : address(address) {}
+  operator uint32_t() const { return address; }
+  uint8_t operator[](int index) const { return (uint8_t)(address >> (8 * index)); }
+  bool operator==(const IPAddress &other) const { return address == other.address; }
+  bool operator!=(const IPAddress &other) const { return address != other.address; }
+  String toString() const;
+
+ private:
+  uint32_t address;  // Network order, like the ESP32 core
+};
+
+// Lines go to stdout stamped with simulated time
+class HardwareSerial {
+ public:
+  void begin(unsigned long baud) {}
+  void flush() {}
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *data, size_t length);
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+extern HardwareSerial Serial;
+
+class EspClass {
+ public:
+  const char *getChipModel() { return "ESP32-S3 (native sim)"; }
+  uint8_t getChipCores() { return 2; }
+  uint32_t getCpuFreqMHz() { return getCpuFrequencyMhz(); }
+  uint32_t getFlashChipSize() { return 8 * 1024 * 1024; }
+  uint32_t getHeapSize();
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint32_t getPsramSize() { return 8 * 1024 * 1024; }
+  uint32_t getFreePsram() { return 8 * 1024 * 1024 - 2048; }
+  void restart();
+};
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef NATIVE_ASYNCTCP_H
+#define NATIVE_ASYNCTCP_H
+
+// Host stand-in for esp32async/AsyncTCP on the virtual network. Callbacks
+// run in the "async_tcp" task, as in the library; the peers are HTTP and
+// SSE clients modelled in tools/native/sim_network.cpp.
+
+#include <Arduino.h>
+
+#include <functional>
+
+class AsyncClient;
+
+typedef std::function<void(void *, AsyncClient *)> AcConnectHandler;
+typedef std::function<void(void *, AsyncClient *, size_t, uint32_t)> AcAckHandler;
+typedef std::function<void(void *, AsyncClient *, void *, size_t)> AcDataHandler;
+
+#define ASYNC_WRITE_FLAG_COPY 0x01
+#define SIM_TCP_SND_BUF 5744  // CONFIG_TCP_SND_BUF_DEFAULT
+
+class AsyncClient {
+ public:
+  AsyncClient();
+  ~AsyncClient();
+
+  void onData(AcDataHandler handler, void *arg = NULL);
+  void onAck(AcAckHandler handler, void *arg = NULL);
+  void onPoll(AcConnectHandler handler, void *arg = NULL);
+  void onDisconnect(AcConnectHandler handler, void *arg = NULL);
+
+  size_t space();
+  size_t add(const char *data, size_t size, uint8_t apiflags = ASYNC_WRITE_FLAG_COPY);
+  bool send();
+  void close(bool now = false);
+  bool connected();
+  void setNoDelay(bool noDelay) {}
+
+  // Harness side (sim_network.cpp)
+  int slot;
+  AcDataHandler dataHandler;
+  void *dataArg;
+  AcAckHandler ackHandler;
+  void *ackArg;
+  AcConnectHandler pollHandler;
+  void *pollArg;
+  AcConnectHandler disconnectHandler;
+  void *disconnectArg;
+  size_t queued;    // Added, not yet sent
+  size_t inFlight;  // Sent, not yet acknowledged
+  bool closing;
+};
+
+class AsyncServer {
+ public:
+  AsyncServer(uint16_t port) : port(port) {}
+  void onClient(AcConnectHandler handler, void *arg);
+  void setNoDelay(bool noDelay) {}
+  void begin();
+
+  // Harness side
+  uint16_t port;
+  AcConnectHandler clientHandler;
+  void *clientArg = NULL;
+};
+
+#endif
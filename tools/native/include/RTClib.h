@@ -0,0 +1,36 @@
+#ifndef NATIVE_RTCLIB_H
+#define NATIVE_RTCLIB_H
+
+// Host stand-in for adafruit/RTClib: DateTime as in the library and a DS1307
+// model with its own crystal error (tools/native/sim_hardware.cpp)
+
+#include <Arduino.h>
+#include <Wire.h>
+
+class DateTime {
+ public:
+  DateTime(uint32_t t = 946684800);
+  DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0, uint8_t min = 0,
+           uint8_t sec = 0);
+  uint16_t year() const { return 2000U + yOff; }
+  uint8_t month() const { return m; }
+  uint8_t day() const { return d; }
+  uint8_t hour() const { return hh; }
+  uint8_t minute() const { return mm; }
+  uint8_t second() const { return ss; }
+  uint8_t dayOfTheWeek() const;
+  uint32_t unixtime() const;
+
+ private:
+  uint8_t yOff, m, d, hh, mm, ss;
+};
+
+class RTC_DS1307 {
+ public:
+  bool begin(TwoWire *wire = &Wire);
+  void adjust(const DateTime &dt);
+  uint8_t isrunning();
+  DateTime now();
+};
+
+#endif
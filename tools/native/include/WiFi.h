@@ -0,0 +1,30 @@
+#ifndef NATIVE_WIFI_H
+#define NATIVE_WIFI_H
+
+// Host stand-in for the station interface: always associated after a short
+// connect, DNS through the virtual network (tools/native/sim_network.cpp)
+
+#include <Arduino.h>
+#include <esp_wifi.h>
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_CONNECTED = 3,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+class WiFiClass {
+ public:
+  wl_status_t status();
+  String SSID();
+  IPAddress localIP();
+  IPAddress softAPIP();
+  IPAddress gatewayIP();
+  IPAddress subnetMask();
+  IPAddress dnsIP();
+  int8_t RSSI();
+  int hostByName(const char *name, IPAddress &address);
+};
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef NATIVE_WIFIMANAGER_H
+#define NATIVE_WIFIMANAGER_H
+
+// Host stand-in for tzapu/WiFiManager: saved credentials always work, so
+// autoConnect() succeeds after the simulated association time
+
+#include <WiFi.h>
+
+#include <functional>
+
+class WiFiManager {
+ public:
+  void setConfigPortalBlocking(bool blocking) {}
+  void setConfigPortalTimeout(unsigned long seconds) {}
+  void setAPCallback(std::function<void(WiFiManager *)> callback) {}
+  bool autoConnect(const char *apName, const char *apPassword);
+  bool process() { return false; }
+  bool getConfigPortalActive() { return false; }
+};
+
+#endif
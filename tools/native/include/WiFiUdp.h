@@ -0,0 +1,36 @@
+#ifndef NATIVE_WIFIUDP_H
+#define NATIVE_WIFIUDP_H
+
+// Host stand-in for WiFiUDP on the virtual network (tools/native/sim_network.cpp)
+
+#include <WiFi.h>
+
+#define SIM_UDP_MAX_PACKET 64
+
+class WiFiUDP {
+ public:
+  uint8_t begin(uint16_t port);
+  void stop();
+  int beginPacket(IPAddress address, uint16_t port);
+  size_t write(const uint8_t *data, size_t length);
+  int endPacket();
+  int parsePacket();
+  int read(uint8_t *data, size_t length);
+  void flush();
+  IPAddress remoteIP() { return packetFrom; }
+  uint16_t remotePort() { return packetFromPort; }
+
+ private:
+  int socket = -1;
+  IPAddress sendTo;
+  uint16_t sendToPort = 0;
+  uint8_t sendBuffer[SIM_UDP_MAX_PACKET];
+  size_t sendLength = 0;
+  uint8_t packet[SIM_UDP_MAX_PACKET];
+  size_t packetLength = 0;
+  size_t packetRead = 0;
+  IPAddress packetFrom;
+  uint16_t packetFromPort = 0;
+};
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef NATIVE_WIRE_H
+#define NATIVE_WIRE_H
+
+// Host stand-in for the I2C bus; the DS1307 model in RTClib.h does the
+// transactions (tools/native/sim_hardware.cpp)
+
+#include <Arduino.h>
+
+class TwoWire {
+ public:
+  bool begin(int sda, int scl, uint32_t frequency = 100000);
+  uint32_t getClock() const { return frequency; }
+
+ private:
+  uint32_t frequency = 0;
+};
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef NATIVE_ESP_PM_H
+#define NATIVE_ESP_PM_H
+
+// Host stand-in for esp_pm.h. CONFIG_PM_ENABLE is left undefined, as in the
+// stock Arduino-ESP32 build, so power.cpp scales the CPU with
+// setCpuFrequencyMhz() and takes no PM locks.
+
+#include <Arduino.h>
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef NATIVE_ESP_WIFI_H
+#define NATIVE_ESP_WIFI_H
+
+// Host stand-in for esp_wifi.h: the power-save mode is only recorded
+// (tools/native/sim_network.cpp)
+
+#include <Arduino.h>
+
+typedef enum { WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM } wifi_ps_type_t;
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef NATIVE_LWIP_PBUF_H
+#define NATIVE_LWIP_PBUF_H
+
+// Host stand-in for lwIP packet buffers: single heap-allocated pbufs
+
+#include <Arduino.h>
+
+typedef int8_t err_t;
+typedef uint16_t u16_t;
+
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_USE -8
+
+typedef enum { PBUF_TRANSPORT } pbuf_layer;
+typedef enum { PBUF_RAM } pbuf_type;
+
+struct pbuf {
+  struct pbuf *next;
+  void *payload;
+  u16_t tot_len;
+  u16_t len;
+};
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type);
+uint8_t pbuf_free(struct pbuf *p);
+u16_t pbuf_copy_partial(const struct pbuf *p, void *data, u16_t length, u16_t offset);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef NATIVE_LWIP_TCPIP_H
+#define NATIVE_LWIP_TCPIP_H
+
+// Host stand-in: calls run in the "tiT" task (tools/native/sim_network.cpp)
+
+#include <lwip/pbuf.h>
+
+typedef void (*tcpip_callback_fn)(void *ctx);
+
+err_t tcpip_callback(tcpip_callback_fn function, void *ctx);
+
+#endif
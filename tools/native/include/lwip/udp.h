@@ -0,0 +1,26 @@
+#ifndef NATIVE_LWIP_UDP_H
+#define NATIVE_LWIP_UDP_H
+
+// Host stand-in for the lwIP raw UDP API on the virtual network
+// (tools/native/sim_network.cpp); callbacks run in the "tiT" task
+
+#include <lwip/pbuf.h>
+
+typedef struct ip_addr {
+  uint32_t addr;
+} ip_addr_t;
+
+extern const ip_addr_t ip_addr_any;
+#define IP_ADDR_ANY (&ip_addr_any)
+
+struct udp_pcb;
+typedef void (*udp_recv_fn)(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                            const ip_addr_t *addr, u16_t port);
+
+struct udp_pcb *udp_new();
+void udp_remove(struct udp_pcb *pcb);
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *addr, u16_t port);
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *arg);
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef NATIVE_NVS_FLASH_H
+#define NATIVE_NVS_FLASH_H
+
+// Host stand-in for the NVS partition (tools/native/sim_nvs.cpp)
+
+#include <Arduino.h>
+
+#define ESP_ERR_NVS_BASE 0x1100
+#define ESP_ERR_NVS_NOT_FOUND (ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_NO_FREE_PAGES (ESP_ERR_NVS_BASE + 0x0d)
+#define ESP_ERR_NVS_NEW_VERSION_FOUND (ESP_ERR_NVS_BASE + 0x10)
+
+typedef struct {
+  size_t used_entries;
+  size_t free_entries;
+  size_t total_entries;
+  size_t namespace_count;
+} nvs_stats_t;
+
+esp_err_t nvs_flash_init();
+esp_err_t nvs_flash_erase();
+esp_err_t nvs_get_stats(const char *partition, nvs_stats_t *stats);
+
+#endif
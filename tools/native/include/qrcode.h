@@ -0,0 +1,44 @@
+#ifndef NATIVE_QRCODE_H
+#define NATIVE_QRCODE_H
+
+// Host stand-in for ricmoo/QRCode: a blank symbol of the right size, enough
+// for the portal banner to be formatted
+
+#include <stdint.h>
+
+typedef struct QRCode {
+  uint8_t version;
+  uint8_t size;
+  uint8_t ecc;
+  uint8_t mode;
+  uint8_t mask;
+  uint8_t *modules;
+} QRCode;
+
+#define ECC_LOW 0
+
+static inline uint16_t qrcode_getBufferSize(uint8_t version) {
+  uint16_t size = version * 4 + 17;
+  return (size * size + 7) / 8;
+}
+
+static inline int8_t qrcode_initText(QRCode *qrcode, uint8_t *modules, uint8_t version,
+                                     uint8_t ecc, const char *data) {
+  qrcode->version = version;
+  qrcode->size = version * 4 + 17;
+  qrcode->ecc = ecc;
+  qrcode->mode = 0;
+  qrcode->mask = 0;
+  qrcode->modules = modules;
+  for (uint16_t i = 0; i < qrcode_getBufferSize(version); i++) {
+    modules[i] = 0;
+  }
+  return 0;
+}
+
+static inline bool qrcode_getModule(QRCode *qrcode, uint8_t x, uint8_t y) {
+  uint16_t offset = y * qrcode->size + x;
+  return (qrcode->modules[offset >> 3] >> (7 - (offset & 7))) & 1;
+}
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef NATIVE_GPIO_REG_H
+#define NATIVE_GPIO_REG_H
+
+// ESP32-S3 GPIO output set/clear registers
+
+#define GPIO_OUT_W1TS_REG 0x60004008
+#define GPIO_OUT_W1TC_REG 0x6000400C
+#define GPIO_OUT1_W1TS_REG 0x60004014
+#define GPIO_OUT1_W1TC_REG 0x60004018
+
+#endif
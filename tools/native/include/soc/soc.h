@@ -0,0 +1,11 @@
+#ifndef NATIVE_SOC_H
+#define NATIVE_SOC_H
+
+// Host stand-in: register writes go to the GPIO model (tools/native/sim_arduino.cpp)
+
+#include <stdint.h>
+
+void simRegWrite(uint32_t reg, uint32_t value);
+#define REG_WRITE(reg, value) simRegWrite((uint32_t)(reg), (uint32_t)(value))
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <Arduino.h>
+#include <unistd.h>
+
+// Internals shared by the host fakes of the native simulation.
+//
+// The firmware's tasks run as host threads under a virtual-time scheduler
+// (sim_rtos.cpp): exactly one of them executes at a time, and virtual time
+// only moves when every runnable task has blocked or is busy-waiting, so a
+// simulated day passes in seconds and every run with the same seed is the
+// same. Time is esp_timer time in microseconds since boot.
+
+#define SIM_CORES 2
+#define SIM_HOUR_US 3600000000LL
+
+// Scheduler
+int64_t simNowUs();
+bool simInTask();              // Called from a firmware task
+void simConsume(uint32_t us);  // Keep the caller's core busy (spin, bit-bang)
+void simBlock(uint32_t us);    // Wait without using the core (I2C, DNS)
+void simSleepUntil(int64_t atUs);
+void simWakeEarlier(TaskHandle_t task, int64_t atUs);  // Cut short a simSleepUntil()
+TaskHandle_t simCreateWorldTask(TaskFunction_t code, const char *name, void *parameters);
+void simRun();     // Start the scheduler; returns once simFinish() is called
+void simFinish();  // From a task: stop the simulation
+
+// World events: run in the world task at `atUs` (sim_main.cpp)
+void simAt(int64_t atUs, void (*event)(void *), void *arg);
+
+// True UTC for the hardware models: ESP time through the crystal error
+int64_t simTrueUnixUs();
+int64_t simTrueUnixUsAt(int64_t espUs);
+
+// Counters, reported per simulated hour (sim_main.cpp)
+struct SimCounters {
+  uint32_t i2cTransactions;
+  uint32_t i2cBusyUs;
+  uint32_t clkEdges;         // Rising edges on the TM1637 CLK pins
+  uint32_t mutexTakes;
+  uint32_t mutexContended;
+  uint64_t mutexWaitUs;
+  uint32_t mutexMaxWaitUs;
+  uint32_t queueSends;
+  uint32_t notifications;
+  uint32_t contextSwitches;
+  uint32_t httpRequests;
+  uint32_t sseEvents;
+  uint32_t ntpRequests;
+  uint32_t nvsCommits;
+};
+extern SimCounters simCounters;
+
+// Per-task CPU time, for runtime_stats and the report
+void simTaskRunTimes(void (*each)(const char *name, int core, uint64_t busyUs, void *arg),
+                     void *arg);
+
+// Hardware models
+void simHardwareBegin(int64_t rtcErrorUs, double rtcPpm, uint32_t seed);
+int64_t simRtcErrorUs();  // DS1307 against true UTC
+uint32_t simTakePinEdges(uint8_t pin);  // Rising edges since the last call
+void simHeapBaseline();   // Heap in use now is the harness's, not the firmware's
+uint32_t simHeapUsed();
+
+// NVS contents as an older firmware left them, and a look at them afterwards
+void simNvsSeedI32(const char *space, const char *key, int32_t value);
+bool simNvsHasKey(const char *space, const char *key);
+
+// Network model: load, and what the peers saw since the last call
+struct SimServedStats {  // LAN clients of the firmware's SNTP server
+  uint32_t synced;
+  uint32_t unsynchronized;  // Answered with leap 3
+  uint32_t mismatched;      // Originate not echoed
+  int64_t worstErrorUs;     // Served transmit time against true UTC
+};
+
+struct SimHttpStats {
+  uint32_t ok;
+  uint32_t notModified;
+  uint32_t errors;
+  uint32_t noResponse;  // Closed without a status line
+  uint32_t truncated;   // 2xx, closed before every response arrived in full
+  uint32_t refused;     // Nothing listening yet
+  uint32_t sseRefused;   // Subscribers answered 503 or left without a PCB
+  uint32_t sseDropped;   // Accepted subscribers the firmware closed
+  int64_t slowestUs;    // Connect to close
+};
+
+void simNetworkBegin(uint32_t seed, int sseClients, int httpPerMinute, int ntpPerMinute);
+SimServedStats simTakeServedStats();
+SimHttpStats simTakeHttpStats();
+
+// Log output
+extern bool simQuiet;
+void simPrintf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+#endif
@@ -0,0 +1,237 @@
+// Arduino core stand-ins for the native simulation: time, GPIO with edge
+// counting, the serial console and the heap figures.
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <malloc.h>
+#include <soc/gpio_reg.h>
+#include <soc/soc.h>
+#include <stdarg.h>
+
+#include <new>
+
+#include "sim.h"
+
+#define SIM_GPIO_COUNT 49
+#define SIM_HEAP_SIZE (320 * 1024)  // Internal RAM left to the application
+
+HardwareSerial Serial;
+EspClass ESP;
+bool simQuiet = false;
+
+static uint8_t pinLevel[SIM_GPIO_COUNT];
+static uint32_t pinRisingEdges[SIM_GPIO_COUNT];
+static uint32_t cpuMhz = 240;
+static size_t heapBaseline = 0;
+static uint32_t minFreeHeap = SIM_HEAP_SIZE;
+
+// ---------------------------------------------------------------------------
+// Time
+
+unsigned long millis() {
+  return (unsigned long)(esp_timer_get_time() / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)esp_timer_get_time();
+}
+
+void delay(uint32_t ms) {
+  vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+// Busy-waits, as the Arduino core does
+void delayMicroseconds(uint32_t us) {
+  simConsume(us);
+}
+
+bool setCpuFrequencyMhz(uint32_t mhz) {
+  cpuMhz = mhz;
+  return true;
+}
+
+uint32_t getCpuFrequencyMhz() {
+  return cpuMhz;
+}
+
+bool psramFound() {
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// GPIO: levels only; rising edges are what the report counts on CLK pins
+
+static void setPin(uint8_t pin, bool high) {
+  if (pin >= SIM_GPIO_COUNT) {
+    return;
+  }
+  if (high && !pinLevel[pin]) {
+    pinRisingEdges[pin]++;
+  }
+  pinLevel[pin] = high;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  setPin(pin, value != LOW);
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < SIM_GPIO_COUNT ? pinLevel[pin] : LOW;
+}
+
+// Ambient light on an unconnected pin: mid-scale
+uint16_t analogRead(uint8_t pin) {
+  return 2048;
+}
+
+void simRegWrite(uint32_t reg, uint32_t value) {
+  int base = reg == GPIO_OUT1_W1TS_REG || reg == GPIO_OUT1_W1TC_REG ? 32 : 0;
+  bool high = reg == GPIO_OUT_W1TS_REG || reg == GPIO_OUT1_W1TS_REG;
+  for (int bit = 0; bit < 32; bit++) {
+    if (value & (1UL << bit)) {
+      setPin(base + bit, high);
+    }
+  }
+}
+
+uint32_t simTakePinEdges(uint8_t pin) {
+  uint32_t edges = pinRisingEdges[pin];
+  pinRisingEdges[pin] = 0;
+  return edges;
+}
+
+// ---------------------------------------------------------------------------
+// Serial console: firmware lines stamped with simulated time since boot
+
+static bool atLineStart = true;
+
+static void stamp() {
+  int64_t us = simNowUs();
+  int64_t s = us / 1000000LL;
+  printf("[d%lld %02d:%02d:%02d.%03d] ", (long long)(s / 86400), (int)(s / 3600 % 24),
+         (int)(s / 60 % 60), (int)(s % 60), (int)(us / 1000 % 1000));
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t length) {
+  if (simQuiet) {
+    return length;
+  }
+  for (size_t i = 0; i < length; i++) {
+    if (atLineStart) {
+      stamp();
+    }
+    putchar(data[i]);
+    atLineStart = data[i] == '\n';
+  }
+  return length;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::printf(const char *format, ...) {
+  char line[256];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+  if (length < 0) {
+    return 0;
+  }
+  return write((const uint8_t *)line, (size_t)length < sizeof(line) ? length : sizeof(line) - 1);
+}
+
+void simPrintf(const char *format, ...) {
+  if (!atLineStart) {
+    putchar('\n');
+    atLineStart = true;
+  }
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+}
+
+String IPAddress::toString() const {
+  char text[16];
+  snprintf(text, sizeof(text), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+  return String(text);
+}
+
+// ---------------------------------------------------------------------------
+// Heap: the host allocator's bytes in use since the scheduler started,
+// charged against the ESP32-S3's internal RAM
+
+void simHeapBaseline() {
+  heapBaseline = mallinfo2().uordblks;
+}
+
+uint32_t simHeapUsed() {
+  size_t used = mallinfo2().uordblks;
+  return used > heapBaseline ? (uint32_t)(used - heapBaseline) : 0;
+}
+
+uint32_t EspClass::getHeapSize() {
+  return SIM_HEAP_SIZE;
+}
+
+uint32_t EspClass::getFreeHeap() {
+  uint32_t used = simHeapUsed();
+  uint32_t free = used < SIM_HEAP_SIZE ? SIM_HEAP_SIZE - used : 0;
+  if (free < minFreeHeap) {
+    minFreeHeap = free;
+  }
+  return free;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+  getFreeHeap();
+  return minFreeHeap;
+}
+
+// Fragmentation is not modelled
+uint32_t EspClass::getMaxAllocHeap() {
+  return getFreeHeap();
+}
+
+void EspClass::restart() {
+  fflush(stdout);
+  fprintf(stderr, "sim: ESP.restart() called at %lld us\n", (long long)simNowUs());
+  _exit(3);
+}
+
+// ---------------------------------------------------------------------------
+// new and delete through malloc, so -Wl,--wrap=malloc sees them as it does
+// on the target (the host's libstdc++ would call its own malloc otherwise)
+
+void *operator new(size_t size) {
+  void *p = malloc(size ? size : 1);
+  if (p == NULL) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+  free(p);
+}
+
+void operator delete[](void *p) noexcept {
+  free(p);
+}
+
+void operator delete(void *p, size_t size) noexcept {
+  free(p);
+}
+
+void operator delete[](void *p, size_t size) noexcept {
+  free(p);
+}
@@ -0,0 +1,132 @@
+// I2C and DS1307 model for the native simulation.
+//
+// The DS1307 counts from its own crystal, off by a fixed ppm, and is read
+// and written at 100 kHz: a transaction blocks the caller for its length on
+// the bus (the Wire driver sleeps on the I2C interrupt) after a few tens of
+// microseconds of driver work. Reads latch the time registers on the
+// repeated start; writing the seconds register restarts the RTC's second,
+// as on the real chip.
+
+#include <RTClib.h>
+#include <Wire.h>
+
+#include "sim.h"
+
+#define SIM_I2C_BYTE_US 90     // 9 bits at 100 kHz
+#define SIM_I2C_DRIVER_US 40   // CPU time in the Wire driver per transaction
+#define SIM_DS1307_ADDRESS 0x68
+
+TwoWire Wire;
+
+static bool rtcPresent = true;
+static int64_t rtcSecondStartTrueUs;  // True time the current RTC count started
+static uint32_t rtcSecondValue;        // RTC seconds at that moment
+static double rtcPpm = 0.0;
+
+// ---------------------------------------------------------------------------
+// DateTime, days since 1970-01-01 in the proleptic Gregorian calendar
+
+static int64_t daysFromCivil(int y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  unsigned yoe = (unsigned)(y - era * 400);
+  unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int64_t)doe - 719468;
+}
+
+DateTime::DateTime(uint32_t t) {
+  int64_t days = t / 86400;
+  uint32_t rest = t % 86400;
+  hh = rest / 3600;
+  mm = rest / 60 % 60;
+  ss = rest % 60;
+
+  days += 719468;
+  int64_t era = days / 146097;
+  unsigned doe = (unsigned)(days - era * 146097);
+  unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  unsigned mp = (5 * doy + 2) / 153;
+  d = doy - (153 * mp + 2) / 5 + 1;
+  m = mp < 10 ? mp + 3 : mp - 9;
+  int year = (int)(yoe + era * 400) + (m <= 2);
+  yOff = (uint8_t)(year - 2000);
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min,
+                   uint8_t sec)
+    : yOff(year >= 2000 ? year - 2000 : year), m(month), d(day), hh(hour), mm(min), ss(sec) {}
+
+uint32_t DateTime::unixtime() const {
+  int64_t days = daysFromCivil(2000 + yOff, m, d);
+  return (uint32_t)(days * 86400 + hh * 3600 + mm * 60 + ss);
+}
+
+uint8_t DateTime::dayOfTheWeek() const {
+  int64_t days = daysFromCivil(2000 + yOff, m, d);
+  return (uint8_t)((days + 4) % 7);  // 1970-01-01 was a Thursday
+}
+
+// ---------------------------------------------------------------------------
+// I2C bus
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+  this->frequency = frequency;
+  return true;
+}
+
+// Run one transaction of `bytes` bytes; returns the true time `latchBytes`
+// into it, where the DS1307 latches or takes the seconds register
+static int64_t transaction(int bytes, int latchBytes) {
+  simConsume(SIM_I2C_DRIVER_US);
+  int64_t latchUs = simTrueUnixUsAt(simNowUs() + latchBytes * SIM_I2C_BYTE_US);
+  simBlock(bytes * SIM_I2C_BYTE_US);
+  simCounters.i2cTransactions++;
+  simCounters.i2cBusyUs += bytes * SIM_I2C_BYTE_US;
+  return latchUs;
+}
+
+// ---------------------------------------------------------------------------
+// DS1307
+
+static int64_t rtcClockUsAt(int64_t trueUs) {
+  double elapsedUs = (double)(trueUs - rtcSecondStartTrueUs) * (1.0 + rtcPpm * 1e-6);
+  return (int64_t)rtcSecondValue * 1000000LL + (int64_t)elapsedUs;
+}
+
+void simHardwareBegin(int64_t rtcErrorUs, double ppm, uint32_t seed) {
+  rtcPpm = ppm;
+  int64_t trueUs = simTrueUnixUsAt(0);
+  int64_t rtcUs = trueUs + rtcErrorUs;
+  rtcSecondValue = (uint32_t)(rtcUs / 1000000LL);
+  rtcSecondStartTrueUs = trueUs - rtcUs % 1000000LL;
+}
+
+int64_t simRtcErrorUs() {
+  int64_t trueUs = simTrueUnixUs();
+  return rtcClockUsAt(trueUs) - trueUs;
+}
+
+bool RTC_DS1307::begin(TwoWire *wire) {
+  transaction(1, 0);  // Address probe
+  return rtcPresent;
+}
+
+uint8_t RTC_DS1307::isrunning() {
+  transaction(4, 2);
+  return 1;
+}
+
+DateTime RTC_DS1307::now() {
+  // Register pointer write, then a 7-byte read latched on the repeated start
+  int64_t latchUs = transaction(10, 2);
+  return DateTime((uint32_t)(rtcClockUsAt(latchUs) / 1000000LL));
+}
+
+void RTC_DS1307::adjust(const DateTime &dt) {
+  // Address, register, seconds ... year; the seconds byte restarts the second
+  int64_t latchUs = transaction(9, 3);
+  rtcSecondValue = dt.unixtime();
+  rtcSecondStartTrueUs = latchUs;
+}
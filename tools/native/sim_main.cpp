@@ -0,0 +1,366 @@
+// Native simulation of the clock firmware: runs setup() and every task the
+// firmware starts against the host fakes in tools/native/, under virtual
+// time, and prints what the buses, locks and allocator did per simulated
+// hour. A simulated day takes about ten seconds.
+//
+// Build (or `pio run -e native`):
+//   python3 tools/embed_web.py
+//   g++ -std=gnu++11 -O2 -Itools/native/include -Isrc -DCLOCK_TM1637_RMT=0
+//     -DCLOCK_ALLOC_STATS=1 src/*.cpp tools/native/*.cpp
+//     -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc -lpthread -o clock_sim
+//   ./clock_sim --days 7 --quiet
+//
+// Options:
+//   --days N, --hours N   Length of the run (default 1 day)
+//   --esp-ppm X           ESP32 crystal error against true time (default 12)
+//   --rtc-ppm X           DS1307 crystal error (default -35)
+//   --rtc-error MS        DS1307 offset from true UTC at boot (default 2300)
+//   --http-per-min N      HTTP requests per minute (default 6)
+//   --sse N               SSE subscribers kept connected (default 2)
+//   --ntp-per-min N       Requests to the firmware's SNTP server (default 4)
+//   --seed N              Network randomness (default 1)
+//   --legacy-tz H         Boot from schema 1 settings: "timezone" = H hours
+//                         in NVS and the DS1307 on that local time
+//   --quiet               Firmware log off; hourly reports only
+//
+// Exit status: 0 at the end of the run, 2 on a simulated deadlock, 3 if the
+// firmware restarts itself, 4 if any SSE subscriber was refused (so
+// `--sse 20` is the 20-viewer load test), 5 if a --legacy-tz run ends with
+// the RTC migration still recorded as pending, 6 if any HTTP request failed
+// or its body was cut short.
+
+#include <Arduino.h>
+
+#include "bus_stats.h"
+#include "sim.h"
+#include "soft_clock.h"
+
+#define SIM_BOOT_UNIX_US 1792108800000000LL  // 2026-10-16 00:00:00 UTC
+#define SIM_EVENTS 1024
+#define SIM_CLK_PIN 12
+#define SIM_EXTRA_CLK_PIN 14
+
+void setup();
+void loop();
+
+struct SimEvent {
+  int64_t atUs;
+  uint64_t order;
+  void (*event)(void *);
+  void *arg;
+};
+
+static double espPpm = 12.0;
+static int64_t endUs = 24 * SIM_HOUR_US;
+
+// World events, a binary min-heap on (time, order)
+static SimEvent events[SIM_EVENTS];
+static int eventCount = 0;
+static uint64_t eventOrder = 0;
+static TaskHandle_t worldTask = NULL;
+
+// Totals for the summary
+static SimCounters totals;
+static uint32_t totalAllocs = 0;
+static int64_t worstSoftClockErrorUs = 0;
+static int64_t worstServedErrorUs = 0;
+static uint32_t totalHttpOk = 0;
+static uint32_t totalHttpFailed = 0;
+static uint32_t totalSseRefused = 0;
+static uint32_t totalSseDropped = 0;
+static uint32_t totalSseEvents = 0;
+static int hours = 0;
+
+int64_t simTrueUnixUsAt(int64_t espUs) {
+  return SIM_BOOT_UNIX_US + (int64_t)((double)espUs / (1.0 + espPpm * 1e-6));
+}
+
+int64_t simTrueUnixUs() {
+  return simTrueUnixUsAt(simNowUs());
+}
+
+static bool before(const SimEvent &a, const SimEvent &b) {
+  return a.atUs < b.atUs || (a.atUs == b.atUs && a.order < b.order);
+}
+
+void simAt(int64_t atUs, void (*event)(void *), void *arg) {
+  if (eventCount == SIM_EVENTS) {
+    fprintf(stderr, "sim: world event heap full\n");
+    _exit(2);
+  }
+  int i = eventCount++;
+  events[i] = {atUs, ++eventOrder, event, arg};
+  while (i > 0 && before(events[i], events[(i - 1) / 2])) {
+    SimEvent parent = events[(i - 1) / 2];
+    events[(i - 1) / 2] = events[i];
+    events[i] = parent;
+    i = (i - 1) / 2;
+  }
+  if (worldTask != NULL && xTaskGetCurrentTaskHandle() != worldTask) {
+    simWakeEarlier(worldTask, atUs);
+  }
+}
+
+static SimEvent popEvent() {
+  SimEvent first = events[0];
+  events[0] = events[--eventCount];
+  int i = 0;
+  while (true) {
+    int smallest = i;
+    for (int child = 2 * i + 1; child <= 2 * i + 2 && child < eventCount; child++) {
+      if (before(events[child], events[smallest])) {
+        smallest = child;
+      }
+    }
+    if (smallest == i) {
+      break;
+    }
+    SimEvent swap = events[i];
+    events[i] = events[smallest];
+    events[smallest] = swap;
+    i = smallest;
+  }
+  return first;
+}
+
+static void worldMain(void *parameters) {
+  while (true) {
+    while (eventCount > 0 && events[0].atUs <= simNowUs()) {
+      SimEvent next = popEvent();
+      next.event(next.arg);
+    }
+    simSleepUntil(eventCount > 0 ? events[0].atUs : INT64_MAX);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Hourly report
+
+struct TaskTimes {
+  uint64_t previousUs[32];
+  int index;
+};
+
+static TaskTimes taskTimes;
+
+static void printTaskTime(const char *name, int core, uint64_t busyUs, void *arg) {
+  TaskTimes &times = *(TaskTimes *)arg;
+  uint64_t usedUs = busyUs - times.previousUs[times.index];
+  times.previousUs[times.index++] = busyUs;
+  if (usedUs > 0) {
+    simPrintf("  %-12s %7.3f%%\n", name, usedUs * 100.0 / SIM_HOUR_US);
+  }
+}
+
+static void hourlyReport(void *arg) {
+  static uint32_t allocsBefore = 0;
+  hours++;
+  SimCounters c = simCounters;
+  simCounters = SimCounters();
+  c.clkEdges = simTakePinEdges(SIM_CLK_PIN) + simTakePinEdges(SIM_EXTRA_CLK_PIN);
+
+  uint32_t allocs, allocBytes;
+  busStatsAllocations(allocs, allocBytes);
+  uint32_t hourAllocs = allocs - allocsBefore;
+  allocsBefore = allocs;
+
+  int64_t softErrorUs = softClockNowUs() - simTrueUnixUs();
+  if (softClockValid() && llabs(softErrorUs) > llabs(worstSoftClockErrorUs)) {
+    worstSoftClockErrorUs = softErrorUs;
+  }
+  SimServedStats served = simTakeServedStats();
+  if (llabs(served.worstErrorUs) > llabs(worstServedErrorUs)) {
+    worstServedErrorUs = served.worstErrorUs;
+  }
+  SimHttpStats http = simTakeHttpStats();
+  totalHttpOk += http.ok + http.notModified;
+  totalHttpFailed += http.errors + http.noResponse + http.truncated + http.refused;
+  totalSseRefused += http.sseRefused;
+  totalSseDropped += http.sseDropped;
+  totalSseEvents += c.sseEvents;
+
+  simPrintf("=== sim hour %d (day %d) ===\n", hours, (hours - 1) / 24 + 1);
+  simPrintf("  i2c          %u transactions, bus busy %u us\n", c.i2cTransactions,
+            c.i2cBusyUs);
+  simPrintf("  tm1637       %u CLK edges\n", c.clkEdges);
+  simPrintf("  mutex        %u takes, %u contended, wait %llu us total, %u us max\n",
+            c.mutexTakes, c.mutexContended, (unsigned long long)c.mutexWaitUs,
+            c.mutexMaxWaitUs);
+  simPrintf("  alloc        %u allocations, heap in use %u bytes\n", hourAllocs,
+            simHeapUsed());
+  simPrintf("  rtos         %u queue sends, %u notifications, %u switches\n", c.queueSends,
+            c.notifications, c.contextSwitches);
+  simPrintf("  clock        soft clock %+lld us, DS1307 %+lld us against true UTC\n",
+            (long long)(softClockValid() ? softErrorUs : 0), (long long)simRtcErrorUs());
+  simPrintf("  sntp         %u upstream requests; served %u, %u unsynchronized, "
+            "worst %+lld us\n", c.ntpRequests, served.synced, served.unsynchronized,
+            (long long)served.worstErrorUs);
+  simPrintf("  http         %u ok, %u 304, %u errors, %u unanswered, %u truncated, "
+            "%u refused, slowest %lld us\n", http.ok, http.notModified, http.errors,
+            http.noResponse, http.truncated, http.refused, (long long)http.slowestUs);
+  simPrintf("  sse          %u events, %u subscribers refused, %u dropped\n", c.sseEvents,
+            http.sseRefused, http.sseDropped);
+  simPrintf("  nvs          %u commits\n", c.nvsCommits);
+  taskTimes.index = 0;
+  simTaskRunTimes(printTaskTime, &taskTimes);
+
+  totals.i2cTransactions += c.i2cTransactions;
+  totals.clkEdges += c.clkEdges;
+  totals.mutexTakes += c.mutexTakes;
+  totals.mutexContended += c.mutexContended;
+  totals.mutexWaitUs += c.mutexWaitUs;
+  if (c.mutexMaxWaitUs > totals.mutexMaxWaitUs) {
+    totals.mutexMaxWaitUs = c.mutexMaxWaitUs;
+  }
+  totals.nvsCommits += c.nvsCommits;
+  totalAllocs += hourAllocs;
+
+  if (simNowUs() >= endUs) {
+    simFinish();
+  }
+  simAt(simNowUs() + SIM_HOUR_US, hourlyReport, NULL);
+}
+
+// ---------------------------------------------------------------------------
+// Tasks the ESP-IDF and Arduino core start on the device, idle here. They
+// are not modelled, but they belong in the task list /metrics reports.
+
+static void systemTask(void *parameters) {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+}
+
+static void startSystemTasks() {
+  static const struct {
+    const char *name;
+    uint32_t stackBytes;
+    UBaseType_t priority;
+    BaseType_t core;
+  } systemTasks[] = {
+    {"ipc0", 1280, 24, 0},
+    {"ipc1", 1280, 24, 1},
+    {"wifi", 6656, 23, 0},
+    {"sys_evt", 2304, 20, 0},
+    {"arduino_events", 4096, 19, tskNO_AFFINITY},
+    {"Tmr Svc", 2048, 1, 0},
+  };
+  for (size_t i = 0; i < sizeof(systemTasks) / sizeof(systemTasks[0]); i++) {
+    xTaskCreatePinnedToCore(systemTask, systemTasks[i].name, systemTasks[i].stackBytes, NULL,
+                            systemTasks[i].priority, NULL, systemTasks[i].core);
+  }
+}
+
+// Firmware entry: the Arduino core's loopTask
+
+static void loopTask(void *parameters) {
+  setup();
+  while (true) {
+    loop();
+  }
+}
+
+static const char *argument(int argc, char **argv, int &i) {
+  if (i + 1 >= argc) {
+    fprintf(stderr, "sim: %s needs a value\n", argv[i]);
+    exit(1);
+  }
+  return argv[++i];
+}
+
+int main(int argc, char **argv) {
+  double rtcPpm = -35.0;
+  int64_t rtcErrorUs = 2300000;
+  int httpPerMinute = 6;
+  int sseClients = 2;
+  int ntpPerMinute = 4;
+  uint32_t seed = 1;
+  int legacyHours = 0;
+  bool legacy = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--days") == 0) {
+      endUs = (int64_t)(atof(argument(argc, argv, i)) * 24 * SIM_HOUR_US);
+    } else if (strcmp(argv[i], "--hours") == 0) {
+      endUs = (int64_t)(atof(argument(argc, argv, i)) * SIM_HOUR_US);
+    } else if (strcmp(argv[i], "--esp-ppm") == 0) {
+      espPpm = atof(argument(argc, argv, i));
+    } else if (strcmp(argv[i], "--rtc-ppm") == 0) {
+      rtcPpm = atof(argument(argc, argv, i));
+    } else if (strcmp(argv[i], "--rtc-error") == 0) {
+      rtcErrorUs = (int64_t)(atof(argument(argc, argv, i)) * 1000);
+    } else if (strcmp(argv[i], "--http-per-min") == 0) {
+      httpPerMinute = atoi(argument(argc, argv, i));
+    } else if (strcmp(argv[i], "--sse") == 0) {
+      sseClients = atoi(argument(argc, argv, i));
+    } else if (strcmp(argv[i], "--ntp-per-min") == 0) {
+      ntpPerMinute = atoi(argument(argc, argv, i));
+    } else if (strcmp(argv[i], "--seed") == 0) {
+      seed = (uint32_t)strtoul(argument(argc, argv, i), NULL, 0);
+    } else if (strcmp(argv[i], "--legacy-tz") == 0) {
+      legacyHours = atoi(argument(argc, argv, i));
+      legacy = true;
+    } else if (strcmp(argv[i], "--quiet") == 0) {
+      simQuiet = true;
+    } else {
+      fprintf(stderr, "sim: unknown option %s (see tools/native/sim_main.cpp)\n", argv[i]);
+      return 1;
+    }
+  }
+  if (endUs < SIM_HOUR_US) {
+    endUs = SIM_HOUR_US;
+  }
+
+  if (legacy) {
+    simNvsSeedI32("clock", "timezone", legacyHours);
+    rtcErrorUs += (int64_t)legacyHours * 3600 * 1000000LL;
+  }
+
+  simHeapBaseline();
+  simHardwareBegin(rtcErrorUs, rtcPpm, seed);
+  startSystemTasks();
+  xTaskCreatePinnedToCore(loopTask, "loopTask", 8192, NULL, 1, NULL, 1);
+  worldTask = simCreateWorldTask(worldMain, "world", NULL);
+  simNetworkBegin(seed, sseClients, httpPerMinute, ntpPerMinute);
+  simAt(SIM_HOUR_US, hourlyReport, NULL);
+
+  simRun();
+
+  simPrintf("=== sim summary: %d hours, ESP32 %+.1f ppm, DS1307 %+.1f ppm ===\n", hours,
+            espPpm, rtcPpm);
+  simPrintf("  per hour     %.0f I2C transactions, %.0f CLK edges, %.0f mutex takes "
+            "(%.1f contended), %.0f allocations\n", totals.i2cTransactions / (double)hours,
+            totals.clkEdges / (double)hours, totals.mutexTakes / (double)hours,
+            totals.mutexContended / (double)hours, totalAllocs / (double)hours);
+  simPrintf("  mutex wait   %llu us total, %u us max\n",
+            (unsigned long long)totals.mutexWaitUs, totals.mutexMaxWaitUs);
+  simPrintf("  clock        worst soft clock %+lld us, worst served %+lld us\n",
+            (long long)worstSoftClockErrorUs, (long long)worstServedErrorUs);
+  simPrintf("  http         %u answered, %u failed; %u NVS commits\n", totalHttpOk,
+            totalHttpFailed, totals.nvsCommits);
+  simPrintf("  sse          %d subscribers, %.0f events per hour, %u refused, %u dropped\n",
+            sseClients, totalSseEvents / (double)hours, totalSseRefused, totalSseDropped);
+
+  // Every wanted subscriber must be accepted
+  if (totalSseRefused > 0) {
+    simPrintf("FAIL %u SSE subscribers refused\n", totalSseRefused);
+    fflush(stdout);
+    _exit(4);
+  }
+  // Every request must be answered in full (/metrics with the whole task
+  // list is larger than the TCP send buffer)
+  if (totalHttpFailed > 0) {
+    simPrintf("FAIL %u HTTP requests failed\n", totalHttpFailed);
+    fflush(stdout);
+    _exit(6);
+  }
+
+  // The old key and the flag go once the RTC holds UTC
+  if (legacy && (simNvsHasKey("clock", "timezone") || simNvsHasKey("clock", "rtc_utc"))) {
+    simPrintf("FAIL RTC migration still pending\n");
+    fflush(stdout);
+    _exit(5);
+  }
+  fflush(stdout);
+  _exit(0);
+}
@@ -0,0 +1,914 @@
+// Virtual network for the native simulation.
+//
+// - WiFi: saved credentials always work; association takes a few seconds.
+// - DNS: pool names resolve to the NTP stand-ins after a lookup delay.
+// - UDP: four NTP stand-ins, each with its own offset from true UTC, path
+//   delay, jitter and loss, answer the firmware's SNTP client; a handful of
+//   LAN clients query the firmware's SNTP server and check the time it
+//   serves against true UTC.
+// - TCP: HTTP clients (one request per connection) and SSE subscribers on
+//   port 80, through the AsyncTCP stand-in.
+// In modem sleep, inbound packets wait for the next DTIM beacon.
+// Callbacks run where the real stack runs them: lwIP's in the "tiT" task,
+// AsyncTCP's in the "async_tcp" task.
+
+#include <AsyncTCP.h>
+#include <WiFi.h>
+#include <WiFiManager.h>
+#include <WiFiUdp.h>
+#include <esp_wifi.h>
+#include <lwip/tcpip.h>
+#include <lwip/udp.h>
+
+#include "sim.h"
+#include "sntp_client.h"
+
+#define SIM_LOCAL_IP IPAddress(192, 168, 1, 50)
+#define SIM_GATEWAY_IP IPAddress(192, 168, 1, 1)
+#define SIM_ASSOCIATE_US 2500000
+#define SIM_DNS_US 25000
+#define SIM_DTIM_US 307200  // Beacon every 102.4 ms, DTIM 3
+#define SIM_LAN_DELAY_US 1500
+#define SIM_UDP_SOCKETS 4
+#define SIM_UDP_QUEUE 8
+#define SIM_MAILBOX_SIZE 64
+#define SIM_TCP_SLOTS 32  // Active TCP PCBs
+#define SIM_TCP_POLL_US 500000
+#define SIM_TCP_RTT_US 3000
+#define SIM_NTP_CLIENTS 4
+
+// ---------------------------------------------------------------------------
+// Mailboxes: calls handed to the tcpip and AsyncTCP tasks
+
+struct SimCall {
+  void (*function)(void *);
+  void *arg;
+};
+
+struct SimMailbox {
+  TaskHandle_t task;
+  SimCall calls[SIM_MAILBOX_SIZE];
+  uint32_t head;
+  uint32_t tail;
+};
+
+static SimMailbox tcpipMailbox;
+static SimMailbox asyncMailbox;
+
+static bool post(SimMailbox &mailbox, void (*function)(void *), void *arg) {
+  if (mailbox.tail - mailbox.head >= SIM_MAILBOX_SIZE) {
+    return false;
+  }
+  mailbox.calls[mailbox.tail % SIM_MAILBOX_SIZE] = {function, arg};
+  mailbox.tail++;
+  xTaskNotifyGive(mailbox.task);
+  return true;
+}
+
+static void mailboxTask(void *parameters) {
+  SimMailbox &mailbox = *(SimMailbox *)parameters;
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    while (mailbox.head != mailbox.tail) {
+      SimCall call = mailbox.calls[mailbox.head % SIM_MAILBOX_SIZE];
+      mailbox.head++;
+      call.function(call.arg);
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Radio
+
+WiFiClass WiFi;
+static bool linkUp = false;
+static wifi_ps_type_t powerSave = WIFI_PS_NONE;
+static uint32_t seedState = 1;
+
+static uint32_t random32() {
+  seedState ^= seedState << 13;
+  seedState ^= seedState >> 17;
+  seedState ^= seedState << 5;
+  return seedState;
+}
+
+static int64_t randomUs(int64_t below) {
+  return below > 0 ? (int64_t)(random32() % (uint32_t)below) : 0;
+}
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type) {
+  powerSave = type;
+  return ESP_OK;
+}
+
+// When a packet that reached the AP at `atUs` reaches the firmware
+static int64_t inboundUs(int64_t atUs) {
+  if (powerSave == WIFI_PS_NONE) {
+    return atUs;
+  }
+  return (atUs / SIM_DTIM_US + 1) * SIM_DTIM_US;
+}
+
+bool WiFiManager::autoConnect(const char *apName, const char *apPassword) {
+  simBlock(SIM_ASSOCIATE_US);
+  linkUp = true;
+  return true;
+}
+
+wl_status_t WiFiClass::status() {
+  return linkUp ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+String WiFiClass::SSID() {
+  return String("simulated");
+}
+
+IPAddress WiFiClass::localIP() {
+  return SIM_LOCAL_IP;
+}
+
+IPAddress WiFiClass::softAPIP() {
+  return IPAddress(192, 168, 4, 1);
+}
+
+IPAddress WiFiClass::gatewayIP() {
+  return SIM_GATEWAY_IP;
+}
+
+IPAddress WiFiClass::subnetMask() {
+  return IPAddress(255, 255, 255, 0);
+}
+
+IPAddress WiFiClass::dnsIP() {
+  return SIM_GATEWAY_IP;
+}
+
+int8_t WiFiClass::RSSI() {
+  return -58;
+}
+
+// ---------------------------------------------------------------------------
+// NTP stand-ins
+
+struct SimNtpServer {
+  const char *name;
+  IPAddress address;
+  int64_t offsetUs;   // Its clock against true UTC
+  int64_t outUs;      // One-way delay to it
+  int64_t backUs;     // One-way delay back
+  int64_t jitterUs;   // Added to each direction, uniformly
+  uint8_t stratum;
+  uint8_t leap;
+  uint32_t lossPerMille;
+};
+
+static SimNtpServer ntpServers[] = {
+  {"0.pool.ntp.org", IPAddress(203, 0, 113, 10), 400, 9000, 9000, 2000, 2, 0, 20},
+  {"1.pool.ntp.org", IPAddress(203, 0, 113, 11), -1200, 17000, 18000, 8000, 2, 0, 20},
+  {"2.pool.ntp.org", IPAddress(203, 0, 113, 12), 150, 22000, 38000, 3000, 3, 0, 20},
+  {"time.google.com", IPAddress(203, 0, 113, 13), 0, 6000, 6000, 1000, 1, 0, 10},
+};
+static const size_t ntpServerCount = sizeof(ntpServers) / sizeof(ntpServers[0]);
+
+int WiFiClass::hostByName(const char *name, IPAddress &address) {
+  simBlock(SIM_DNS_US);
+  for (size_t i = 0; i < ntpServerCount; i++) {
+    if (strcmp(ntpServers[i].name, name) == 0) {
+      address = ntpServers[i].address;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void writeU32(uint8_t *p, uint32_t value) {
+  p[0] = value >> 24;
+  p[1] = value >> 16;
+  p[2] = value >> 8;
+  p[3] = value;
+}
+
+static void writeU64(uint8_t *p, uint64_t value) {
+  writeU32(p, (uint32_t)(value >> 32));
+  writeU32(p + 4, (uint32_t)value);
+}
+
+static uint64_t readU64(const uint8_t *p) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++) {
+    value = value << 8 | p[i];
+  }
+  return value;
+}
+
+// ---------------------------------------------------------------------------
+// UDP sockets: WiFiUDP and lwIP PCBs share the port table
+
+struct SimDatagram {
+  int64_t arrivalUs;
+  IPAddress from;
+  uint16_t fromPort;
+  uint8_t length;
+  uint8_t data[SIM_UDP_MAX_PACKET];
+};
+
+struct SimUdpSocket {
+  bool used;
+  uint16_t port;
+  SimDatagram queue[SIM_UDP_QUEUE];  // WiFiUDP only
+  uint32_t head;
+  uint32_t tail;
+  struct udp_pcb *pcb;  // lwIP only
+};
+
+struct udp_pcb {
+  int socket;
+  udp_recv_fn recv;
+  void *recvArg;
+};
+
+const ip_addr_t ip_addr_any = {0};
+
+static SimUdpSocket sockets[SIM_UDP_SOCKETS];
+
+static int openSocket(uint16_t port) {
+  for (int i = 0; i < SIM_UDP_SOCKETS; i++) {
+    if (sockets[i].used && sockets[i].port == port) {
+      return -1;
+    }
+  }
+  for (int i = 0; i < SIM_UDP_SOCKETS; i++) {
+    if (!sockets[i].used) {
+      sockets[i] = SimUdpSocket();
+      sockets[i].used = true;
+      sockets[i].port = port;
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void enqueue(int socket, const SimDatagram &datagram) {
+  SimUdpSocket &s = sockets[socket];
+  if (s.tail - s.head < SIM_UDP_QUEUE) {
+    s.queue[s.tail % SIM_UDP_QUEUE] = datagram;
+    s.tail++;
+  }
+}
+
+// An NTP stand-in answers a request sent at `sentUs`
+static void answerNtp(int socket, SimNtpServer &server, const uint8_t *request, uint16_t fromPort) {
+  if (random32() % 1000 < server.lossPerMille) {
+    return;
+  }
+  int64_t sentUs = simNowUs();
+  int64_t outUs = server.outUs + randomUs(server.jitterUs);
+  int64_t backUs = server.backUs + randomUs(server.jitterUs);
+  int64_t receiveUs = simTrueUnixUsAt(sentUs + outUs) + server.offsetUs;
+  int64_t transmitUs = receiveUs + 25;
+
+  SimDatagram reply = {};
+  reply.arrivalUs = inboundUs(sentUs + outUs + 25 + backUs);
+  reply.from = server.address;
+  reply.fromPort = SNTP_PORT;
+  reply.length = 48;
+  uint8_t *p = reply.data;
+  p[0] = (uint8_t)(server.leap << 6 | 4 << 3 | 4);
+  p[1] = server.stratum;
+  p[2] = request[2];
+  p[3] = (uint8_t)-20;
+  writeU32(p + 4, 0x00000200);  // Root delay ~8 ms
+  writeU32(p + 8, 0x00000100);  // Root dispersion ~4 ms
+  memcpy(p + 12, "SIM", 4);
+  writeU64(p + 16, sntpFromUnixUs(receiveUs - 16000000LL));
+  memcpy(p + 24, request + 40, 8);
+  writeU64(p + 32, sntpFromUnixUs(receiveUs));
+  writeU64(p + 40, sntpFromUnixUs(transmitUs));
+  enqueue(socket, reply);
+  simCounters.ntpRequests++;
+}
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+  stop();
+  socket = openSocket(port);
+  return socket >= 0 ? 1 : 0;
+}
+
+void WiFiUDP::stop() {
+  if (socket >= 0) {
+    sockets[socket].used = false;
+    socket = -1;
+  }
+}
+
+int WiFiUDP::beginPacket(IPAddress address, uint16_t port) {
+  if (!linkUp) {
+    return 0;
+  }
+  sendTo = address;
+  sendToPort = port;
+  sendLength = 0;
+  return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *data, size_t length) {
+  if (sendLength + length > sizeof(sendBuffer)) {
+    length = sizeof(sendBuffer) - sendLength;
+  }
+  memcpy(sendBuffer + sendLength, data, length);
+  sendLength += length;
+  return length;
+}
+
+int WiFiUDP::endPacket() {
+  if (socket < 0 || !linkUp) {
+    return 0;
+  }
+  simConsume(60);  // Down the stack and into the driver
+  for (size_t i = 0; i < ntpServerCount; i++) {
+    if (ntpServers[i].address == sendTo && sendToPort == SNTP_PORT && sendLength >= 48) {
+      answerNtp(socket, ntpServers[i], sendBuffer, sockets[socket].port);
+    }
+  }
+  return 1;  // Anything else is lost on the way
+}
+
+int WiFiUDP::parsePacket() {
+  if (socket < 0) {
+    return 0;
+  }
+  SimUdpSocket &s = sockets[socket];
+  // Earliest arrival first; the stand-ins answer out of order
+  uint32_t earliest = s.tail;
+  for (uint32_t i = s.head; i != s.tail; i++) {
+    if (s.queue[i % SIM_UDP_QUEUE].arrivalUs <= simNowUs() &&
+        (earliest == s.tail ||
+         s.queue[i % SIM_UDP_QUEUE].arrivalUs < s.queue[earliest % SIM_UDP_QUEUE].arrivalUs)) {
+      earliest = i;
+    }
+  }
+  if (earliest == s.tail) {
+    return 0;
+  }
+  SimDatagram datagram = s.queue[earliest % SIM_UDP_QUEUE];
+  s.queue[earliest % SIM_UDP_QUEUE] = s.queue[s.head % SIM_UDP_QUEUE];
+  s.head++;
+  memcpy(packet, datagram.data, datagram.length);
+  packetLength = datagram.length;
+  packetRead = 0;
+  packetFrom = datagram.from;
+  packetFromPort = datagram.fromPort;
+  return (int)packetLength;
+}
+
+int WiFiUDP::read(uint8_t *data, size_t length) {
+  size_t left = packetLength - packetRead;
+  if (length > left) {
+    length = left;
+  }
+  memcpy(data, packet + packetRead, length);
+  packetRead += length;
+  return (int)length;
+}
+
+void WiFiUDP::flush() {
+  packetRead = packetLength;
+}
+
+// ---------------------------------------------------------------------------
+// lwIP raw UDP, for the firmware's SNTP server
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type) {
+  struct pbuf *p = (struct pbuf *)malloc(sizeof(struct pbuf) + length);
+  if (p == NULL) {
+    return NULL;
+  }
+  p->next = NULL;
+  p->payload = p + 1;
+  p->tot_len = length;
+  p->len = length;
+  return p;
+}
+
+uint8_t pbuf_free(struct pbuf *p) {
+  free(p);
+  return 1;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *p, void *data, u16_t length, u16_t offset) {
+  if (offset >= p->len) {
+    return 0;
+  }
+  if (length > p->len - offset) {
+    length = p->len - offset;
+  }
+  memcpy(data, (const uint8_t *)p->payload + offset, length);
+  return length;
+}
+
+err_t tcpip_callback(tcpip_callback_fn function, void *ctx) {
+  return post(tcpipMailbox, function, ctx) ? ERR_OK : ERR_MEM;
+}
+
+struct udp_pcb *udp_new() {
+  struct udp_pcb *pcb = (struct udp_pcb *)calloc(1, sizeof(struct udp_pcb));
+  if (pcb != NULL) {
+    pcb->socket = -1;
+  }
+  return pcb;
+}
+
+void udp_remove(struct udp_pcb *pcb) {
+  if (pcb->socket >= 0) {
+    sockets[pcb->socket].used = false;
+  }
+  free(pcb);
+}
+
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *addr, u16_t port) {
+  pcb->socket = openSocket(port);
+  if (pcb->socket < 0) {
+    return ERR_USE;
+  }
+  sockets[pcb->socket].pcb = pcb;
+  return ERR_OK;
+}
+
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *arg) {
+  pcb->recv = recv;
+  pcb->recvArg = arg;
+}
+
+// LAN clients of the firmware's SNTP server
+struct SimNtpClient {
+  IPAddress address;
+  uint16_t port;
+  uint64_t transmit;  // Echoed back as originate
+};
+
+static SimNtpClient ntpClients[SIM_NTP_CLIENTS];
+static int64_t ntpClientPeriodUs = 0;
+static SimServedStats served;
+
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port) {
+  simConsume(40);
+  for (int i = 0; i < SIM_NTP_CLIENTS; i++) {
+    SimNtpClient &client = ntpClients[i];
+    if ((uint32_t)client.address != addr->addr || client.port != port || p->len < 48) {
+      continue;
+    }
+    const uint8_t *reply = (const uint8_t *)p->payload;
+    if (readU64(reply + 24) != client.transmit) {
+      served.mismatched++;
+    } else if (reply[0] >> 6 == 3) {
+      served.unsynchronized++;
+    } else {
+      // T3 against true UTC when it left; the LAN hop is the client's problem
+      int64_t errorUs = sntpToUnixUs(readU64(reply + 40)) - simTrueUnixUs();
+      served.synced++;
+      if (llabs(errorUs) > llabs(served.worstErrorUs)) {
+        served.worstErrorUs = errorUs;
+      }
+    }
+  }
+  return ERR_OK;
+}
+
+static void deliverNtpRequest(void *arg) {
+  SimNtpClient &client = *(SimNtpClient *)arg;
+  for (int i = 0; i < SIM_UDP_SOCKETS; i++) {
+    SimUdpSocket &s = sockets[i];
+    if (!s.used || s.port != SNTP_PORT || s.pcb == NULL || s.pcb->recv == NULL) {
+      continue;
+    }
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, 48, PBUF_RAM);
+    if (p == NULL) {
+      return;
+    }
+    uint8_t *request = (uint8_t *)p->payload;
+    memset(request, 0, 48);
+    request[0] = 0 << 6 | 4 << 3 | 3;
+    request[2] = 6;
+    writeU64(request + 40, client.transmit);
+    ip_addr_t from = {(uint32_t)client.address};
+    s.pcb->recv(s.pcb->recvArg, s.pcb, p, &from, client.port);
+    return;
+  }
+}
+
+static void arriveNtpRequest(void *arg) {
+  tcpip_callback(deliverNtpRequest, arg);
+}
+
+static void sendNtpRequest(void *arg) {
+  SimNtpClient &client = *(SimNtpClient *)arg;
+  if (linkUp) {
+    client.transmit = ((uint64_t)random32() << 32) | random32();
+    simAt(inboundUs(simNowUs() + SIM_LAN_DELAY_US), arriveNtpRequest, arg);
+  }
+  simAt(simNowUs() + ntpClientPeriodUs, sendNtpRequest, arg);
+}
+
+SimServedStats simTakeServedStats() {
+  SimServedStats stats = served;
+  served = SimServedStats();
+  return stats;
+}
+
+// ---------------------------------------------------------------------------
+// TCP: AsyncTCP stand-in with modelled peers
+
+enum SimPeerKind { SIM_PEER_HTTP, SIM_PEER_SSE };
+
+struct SimTcpSlot {
+  bool used;
+  uint32_t generation;
+  SimPeerKind kind;
+  AsyncClient *client;
+  const char *request;
+  char head[13];  // Status line start, "HTTP/1.1 200"
+  size_t headLength;
+  long contentLength;  // Of the response being received, -1 between responses
+  long bodyBytes;      // Of it received so far
+  int responses;       // Received in full
+  int64_t openedUs;
+};
+
+// One pending callback for a connection; stale once the generation moves on
+struct SimTcpEvent {
+  void (*handler)(SimTcpSlot &slot, size_t length);
+  int slot;
+  uint32_t generation;
+  size_t length;
+};
+
+#define SIM_TCP_EVENTS 128
+static SimTcpSlot slots[SIM_TCP_SLOTS];
+static SimTcpEvent tcpEvents[SIM_TCP_EVENTS];
+static uint32_t tcpEventNext = 0;
+static AsyncServer *listening = NULL;
+static SimHttpStats http;
+
+static void runTcpEvent(void *arg) {
+  SimTcpEvent &event = *(SimTcpEvent *)arg;
+  SimTcpSlot &slot = slots[event.slot];
+  if (slot.used && slot.generation == event.generation) {
+    event.handler(slot, event.length);
+  }
+}
+
+static void postTcpEvent(void (*handler)(SimTcpSlot &, size_t), int index, size_t length) {
+  SimTcpEvent &event = tcpEvents[tcpEventNext++ % SIM_TCP_EVENTS];
+  event.handler = handler;
+  event.slot = index;
+  event.generation = slots[index].generation;
+  event.length = length;
+  post(asyncMailbox, runTcpEvent, &event);
+}
+
+// Deliver from the world task at `atUs`
+static void postTcpEventAt(int64_t atUs, void (*handler)(SimTcpSlot &, size_t), int index,
+                           size_t length);
+
+static void freeSlot(SimTcpSlot &slot) {
+  if (slot.kind == SIM_PEER_HTTP) {
+    int status = slot.headLength >= 12 ? atoi(slot.head + 9) : 0;
+    int requests = 0;
+    for (const char *r = slot.request; (r = strstr(r, " HTTP/1.1\r\n")) != NULL; r++) {
+      requests++;
+    }
+    if (status >= 200 && status < 300 && slot.responses < requests) {
+      http.truncated++;
+    } else if (status >= 200 && status < 300) {
+      http.ok++;
+    } else if (status >= 300 && status < 400) {
+      http.notModified++;
+    } else if (status != 0) {
+      http.errors++;
+    } else {
+      http.noResponse++;
+    }
+    int64_t tookUs = simNowUs() - slot.openedUs;
+    if (tookUs > http.slowestUs) {
+      http.slowestUs = tookUs;
+    }
+  } else if (slot.headLength >= 12 && atoi(slot.head + 9) == 200) {
+    http.sseDropped++;
+  } else {
+    http.sseRefused++;
+  }
+  slot.used = false;
+  slot.generation++;
+}
+
+static void onPollEvent(SimTcpSlot &slot, size_t length);
+
+static void onDataEvent(SimTcpSlot &slot, size_t length) {
+  AsyncClient *client = slot.client;
+  if (client == NULL || !client->dataHandler) {
+    return;
+  }
+  char request[160];
+  size_t size = strlen(slot.request);
+  memcpy(request, slot.request, size);
+  client->dataHandler(client->dataArg, client, request, size);
+}
+
+static void onAckEvent(SimTcpSlot &slot, size_t length) {
+  AsyncClient *client = slot.client;
+  if (client == NULL) {
+    return;
+  }
+  client->inFlight -= length;
+  if (client->ackHandler) {
+    client->ackHandler(client->ackArg, client, length, SIM_TCP_RTT_US / 1000);
+  }
+}
+
+static void onPollEvent(SimTcpSlot &slot, size_t length) {
+  AsyncClient *client = slot.client;
+  if (client == NULL) {
+    return;
+  }
+  int index = client->slot;
+  if (client->pollHandler) {
+    client->pollHandler(client->pollArg, client);
+  }
+  if (slots[index].used && slots[index].client != NULL) {
+    postTcpEventAt(simNowUs() + SIM_TCP_POLL_US, onPollEvent, index, 0);
+  }
+}
+
+static void onDisconnectEvent(SimTcpSlot &slot, size_t length) {
+  AsyncClient *client = slot.client;
+  freeSlot(slot);
+  if (client != NULL) {
+    client->slot = -1;
+    if (client->disconnectHandler) {
+      client->disconnectHandler(client->disconnectArg, client);
+    }
+  }
+}
+
+static void onAcceptEvent(SimTcpSlot &slot, size_t length) {
+  int index = (int)(&slot - slots);
+  if (listening == NULL || !listening->clientHandler) {
+    http.refused++;
+    freeSlot(slot);
+    return;
+  }
+  AsyncClient *client = new AsyncClient();
+  client->slot = index;
+  slot.client = client;
+  listening->clientHandler(listening->clientArg, client);
+  if (slots[index].used && slots[index].client == client) {
+    postTcpEventAt(simNowUs() + SIM_TCP_RTT_US / 2, onDataEvent, index, 0);
+    postTcpEventAt(simNowUs() + SIM_TCP_POLL_US, onPollEvent, index, 0);
+  }
+}
+
+struct SimTcpTimed {
+  void (*handler)(SimTcpSlot &, size_t);
+  int slot;
+  uint32_t generation;
+  size_t length;
+};
+
+#define SIM_TCP_TIMED 256
+static SimTcpTimed tcpTimed[SIM_TCP_TIMED];
+static uint32_t tcpTimedNext = 0;
+
+static void releaseTimed(void *arg) {
+  SimTcpTimed &timed = *(SimTcpTimed *)arg;
+  if (slots[timed.slot].generation == timed.generation) {
+    postTcpEvent(timed.handler, timed.slot, timed.length);
+  }
+}
+
+static void postTcpEventAt(int64_t atUs, void (*handler)(SimTcpSlot &, size_t), int index,
+                           size_t length) {
+  SimTcpTimed &timed = tcpTimed[tcpTimedNext++ % SIM_TCP_TIMED];
+  timed.handler = handler;
+  timed.slot = index;
+  timed.generation = slots[index].generation;
+  timed.length = length;
+  simAt(inboundUs(atUs), releaseTimed, &timed);
+}
+
+static int openConnection(SimPeerKind kind, const char *request) {
+  for (int i = 0; i < SIM_TCP_SLOTS; i++) {
+    SimTcpSlot &slot = slots[i];
+    if (slot.used) {
+      continue;
+    }
+    slot.used = true;
+    slot.generation++;
+    slot.kind = kind;
+    slot.client = NULL;
+    slot.request = request;
+    slot.headLength = 0;
+    slot.contentLength = -1;
+    slot.bodyBytes = 0;
+    slot.responses = 0;
+    slot.openedUs = simNowUs();
+    postTcpEventAt(simNowUs() + SIM_TCP_RTT_US, onAcceptEvent, i, 0);
+    return i;
+  }
+  return -1;
+}
+
+AsyncClient::AsyncClient()
+    : slot(-1), dataArg(NULL), ackArg(NULL), pollArg(NULL), disconnectArg(NULL), queued(0),
+      inFlight(0), closing(false) {}
+
+AsyncClient::~AsyncClient() {
+  if (slot >= 0 && slots[slot].client == this) {
+    slots[slot].client = NULL;
+  }
+}
+
+void AsyncClient::onData(AcDataHandler handler, void *arg) {
+  dataHandler = handler;
+  dataArg = arg;
+}
+
+void AsyncClient::onAck(AcAckHandler handler, void *arg) {
+  ackHandler = handler;
+  ackArg = arg;
+}
+
+void AsyncClient::onPoll(AcConnectHandler handler, void *arg) {
+  pollHandler = handler;
+  pollArg = arg;
+}
+
+void AsyncClient::onDisconnect(AcConnectHandler handler, void *arg) {
+  disconnectHandler = handler;
+  disconnectArg = arg;
+}
+
+size_t AsyncClient::space() {
+  if (closing || slot < 0) {
+    return 0;
+  }
+  return SIM_TCP_SND_BUF - queued - inFlight;
+}
+
+size_t AsyncClient::add(const char *data, size_t size, uint8_t apiflags) {
+  size_t room = space();
+  if (size > room) {
+    size = room;
+  }
+  if (size == 0) {
+    return 0;
+  }
+  SimTcpSlot &s = slots[slot];
+  for (size_t i = 0; i < size && s.headLength < sizeof(s.head) - 1; i++) {
+    s.head[s.headLength++] = data[i];
+  }
+  s.head[s.headLength] = '\0';
+  // Count complete responses; the server queues each head in one add()
+  for (size_t offset = 0; s.kind == SIM_PEER_HTTP && offset < size;) {
+    if (s.contentLength < 0) {
+      const char *head = data + offset;
+      const char *headEnd = (const char *)memmem(head, size - offset, "\r\n\r\n", 4);
+      if (headEnd == NULL) {
+        break;
+      }
+      const char *field = (const char *)memmem(head, headEnd - head, "Content-Length: ", 16);
+      s.contentLength = field ? atol(field + 16) : 0;
+      s.bodyBytes = 0;
+      offset = headEnd + 4 - data;
+    }
+    long take = s.contentLength - s.bodyBytes;
+    if (take > (long)(size - offset)) {
+      take = (long)(size - offset);
+    }
+    s.bodyBytes += take;
+    offset += take;
+    if (s.bodyBytes == s.contentLength) {
+      s.responses++;
+      s.contentLength = -1;
+    }
+  }
+  if (s.kind == SIM_PEER_SSE && strncmp(data, "event:", 6) == 0) {
+    simCounters.sseEvents++;
+  }
+  simConsume(5 + (uint32_t)size / 64);  // Copy into the send buffer
+  queued += size;
+  return size;
+}
+
+bool AsyncClient::send() {
+  if (closing || slot < 0 || queued == 0) {
+    return false;
+  }
+  simConsume(30);
+  inFlight += queued;
+  postTcpEventAt(simNowUs() + SIM_TCP_RTT_US, onAckEvent, slot, queued);
+  queued = 0;
+  return true;
+}
+
+void AsyncClient::close(bool now) {
+  if (closing || slot < 0) {
+    return;
+  }
+  closing = true;
+  postTcpEvent(onDisconnectEvent, slot, 0);
+}
+
+bool AsyncClient::connected() {
+  return slot >= 0 && !closing;
+}
+
+void AsyncServer::onClient(AcConnectHandler handler, void *arg) {
+  clientHandler = handler;
+  clientArg = arg;
+}
+
+void AsyncServer::begin() {
+  listening = this;
+}
+
+// ---------------------------------------------------------------------------
+// Load: periodic HTTP requests and long-lived SSE subscribers
+
+static const char *const httpRequests[] = {
+  "GET /getTime HTTP/1.1\r\nHost: clock\r\nConnection: close\r\n\r\n",
+  "GET /getTime HTTP/1.1\r\nHost: clock\r\nConnection: close\r\n\r\n",
+  "GET /syncStatus HTTP/1.1\r\nHost: clock\r\nConnection: close\r\n\r\n",
+  "GET /getTime HTTP/1.1\r\nHost: clock\r\nConnection: close\r\n\r\n",
+  "GET /power HTTP/1.1\r\nHost: clock\r\nConnection: close\r\n\r\n",
+  "GET /metrics HTTP/1.1\r\nHost: clock\r\nConnection: close\r\n\r\n",
+  // Pipelined: the second body no longer fits behind the first in the send buffer
+  "GET /metrics HTTP/1.1\r\nHost: clock\r\n\r\n"
+  "GET /metrics HTTP/1.1\r\nHost: clock\r\nConnection: close\r\n\r\n",
+  "GET / HTTP/1.1\r\nHost: clock\r\nAccept-Encoding: gzip, deflate, br\r\n"
+  "Connection: close\r\n\r\n",
+  "GET / HTTP/1.1\r\nHost: clock\r\nConnection: close\r\n\r\n",  // No gzip
+};
+static const char sseRequest[] = "GET /events HTTP/1.1\r\nHost: clock\r\n\r\n";
+static int64_t httpPeriodUs = 0;
+static int sseWanted = 0;
+
+static void httpLoad(void *arg) {
+  static uint32_t sent = 0;
+  if (linkUp) {
+    openConnection(SIM_PEER_HTTP, httpRequests[sent++ % (sizeof(httpRequests) / sizeof(httpRequests[0]))]);
+    simCounters.httpRequests++;
+  }
+  simAt(simNowUs() + httpPeriodUs, httpLoad, NULL);
+}
+
+// Every 10 s, reconnect the missing subscribers. Viewers arrive 20 ms apart
+// rather than in one burst, which would only measure the HTTP connection pool.
+static void sseLoad(void *arg) {
+  static int arriving = 0;
+  if (arriving == 0) {
+    int open = 0;
+    for (int i = 0; i < SIM_TCP_SLOTS; i++) {
+      open += slots[i].used && slots[i].kind == SIM_PEER_SSE;
+    }
+    arriving = linkUp && listening != NULL ? sseWanted - open : 0;
+  }
+  if (arriving > 0) {
+    if (openConnection(SIM_PEER_SSE, sseRequest) < 0) {
+      http.sseRefused++;
+    }
+    if (--arriving > 0) {
+      simAt(simNowUs() + 20000LL, sseLoad, NULL);
+      return;
+    }
+  }
+  simAt(simNowUs() + 10000000LL, sseLoad, NULL);
+}
+
+SimHttpStats simTakeHttpStats() {
+  SimHttpStats stats = http;
+  http = SimHttpStats();
+  return stats;
+}
+
+void simNetworkBegin(uint32_t seed, int sseClients, int httpPerMinute, int ntpPerMinute) {
+  seedState = seed ? seed : 1;
+  xTaskCreatePinnedToCore(mailboxTask, "tiT", 3072, &tcpipMailbox, 18, &tcpipMailbox.task,
+                          tskNO_AFFINITY);
+  xTaskCreatePinnedToCore(mailboxTask, "async_tcp", 8192, &asyncMailbox, 3, &asyncMailbox.task,
+                          tskNO_AFFINITY);
+
+  sseWanted = sseClients;
+  simAt(20000000LL, sseLoad, NULL);
+  if (httpPerMinute > 0) {
+    httpPeriodUs = 60000000LL / httpPerMinute;
+    simAt(15000000LL, httpLoad, NULL);
+  }
+  if (ntpPerMinute > 0) {
+    ntpClientPeriodUs = 60000000LL * SIM_NTP_CLIENTS / ntpPerMinute;
+    for (int i = 0; i < SIM_NTP_CLIENTS; i++) {
+      ntpClients[i].address = IPAddress(192, 168, 1, 100 + i);
+      ntpClients[i].port = 40000 + i;
+      simAt(30000000LL + i * ntpClientPeriodUs / SIM_NTP_CLIENTS, sendNtpRequest, &ntpClients[i]);
+    }
+  }
+}
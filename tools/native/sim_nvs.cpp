@@ -0,0 +1,227 @@
+// NVS stand-in for the native simulation: a fixed table in RAM, empty at
+// boot like a freshly erased partition. A commit is a flash write and keeps
+// the caller busy for a few milliseconds.
+
+#include <nvs.h>
+
+#include "sim.h"
+
+#define SIM_NVS_ENTRIES 32
+#define SIM_NVS_KEY_SIZE 16
+#define SIM_NVS_STRING_SIZE 64
+#define SIM_NVS_NAMESPACES 4
+#define SIM_NVS_COMMIT_US 3000
+
+enum SimNvsType { SIM_NVS_EMPTY, SIM_NVS_U8, SIM_NVS_U16, SIM_NVS_U32, SIM_NVS_I32, SIM_NVS_STR };
+
+struct SimNvsEntry {
+  uint32_t space;
+  SimNvsType type;
+  char key[SIM_NVS_KEY_SIZE];
+  uint32_t value;
+  char text[SIM_NVS_STRING_SIZE];
+};
+
+static SimNvsEntry entries[SIM_NVS_ENTRIES];
+static char namespaces[SIM_NVS_NAMESPACES][SIM_NVS_KEY_SIZE];
+static bool initialized = false;
+
+static SimNvsEntry *findEntry(nvs_handle_t handle, const char *key, SimNvsType type) {
+  for (int i = 0; i < SIM_NVS_ENTRIES; i++) {
+    SimNvsEntry &entry = entries[i];
+    if (entry.type != SIM_NVS_EMPTY && entry.space == handle && strcmp(entry.key, key) == 0) {
+      return type == SIM_NVS_EMPTY || entry.type == type ? &entry : NULL;
+    }
+  }
+  return NULL;
+}
+
+static SimNvsEntry *setEntry(nvs_handle_t handle, const char *key, SimNvsType type) {
+  SimNvsEntry *entry = findEntry(handle, key, SIM_NVS_EMPTY);
+  for (int i = 0; entry == NULL && i < SIM_NVS_ENTRIES; i++) {
+    if (entries[i].type == SIM_NVS_EMPTY) {
+      entry = &entries[i];
+    }
+  }
+  if (entry != NULL) {
+    entry->space = handle;
+    entry->type = type;
+    snprintf(entry->key, sizeof(entry->key), "%s", key);
+  }
+  return entry;
+}
+
+static nvs_handle_t findSpace(const char *name) {
+  for (int i = 0; i < SIM_NVS_NAMESPACES; i++) {
+    if (strcmp(namespaces[i], name) == 0) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+void simNvsSeedI32(const char *space, const char *key, int32_t value) {
+  nvs_handle_t handle;
+  initialized = true;
+  nvs_open(space, NVS_READWRITE, &handle);
+  nvs_set_i32(handle, key, value);
+  initialized = false;
+}
+
+bool simNvsHasKey(const char *space, const char *key) {
+  nvs_handle_t handle = findSpace(space);
+  return handle != 0 && findEntry(handle, key, SIM_NVS_EMPTY) != NULL;
+}
+
+esp_err_t nvs_flash_init() {
+  initialized = true;
+  return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase() {
+  memset(entries, 0, sizeof(entries));
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_stats(const char *partition, nvs_stats_t *stats) {
+  size_t used = 0;
+  for (int i = 0; i < SIM_NVS_ENTRIES; i++) {
+    used += entries[i].type != SIM_NVS_EMPTY;
+  }
+  size_t spaces = 0;
+  for (int i = 0; i < SIM_NVS_NAMESPACES; i++) {
+    spaces += namespaces[i][0] != '\0';
+  }
+  stats->used_entries = used + spaces;
+  stats->free_entries = SIM_NVS_ENTRIES - used;
+  stats->total_entries = SIM_NVS_ENTRIES + SIM_NVS_NAMESPACES;
+  stats->namespace_count = spaces;
+  return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle) {
+  if (!initialized) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  for (int i = 0; i < SIM_NVS_NAMESPACES; i++) {
+    if (strcmp(namespaces[i], name) == 0 || namespaces[i][0] == '\0') {
+      snprintf(namespaces[i], sizeof(namespaces[i]), "%s", name);
+      *handle = i + 1;
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t handle) {
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+  simConsume(SIM_NVS_COMMIT_US);
+  simCounters.nvsCommits++;
+  return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+  SimNvsEntry *entry = findEntry(handle, key, SIM_NVS_EMPTY);
+  if (entry == NULL) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  entry->type = SIM_NVS_EMPTY;
+  return ESP_OK;
+}
+
+static esp_err_t getValue(nvs_handle_t handle, const char *key, SimNvsType type,
+                          uint32_t &value) {
+  SimNvsEntry *entry = findEntry(handle, key, type);
+  if (entry == NULL) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  value = entry->value;
+  return ESP_OK;
+}
+
+static esp_err_t setValue(nvs_handle_t handle, const char *key, SimNvsType type,
+                          uint32_t value) {
+  SimNvsEntry *entry = setEntry(handle, key, type);
+  if (entry == NULL) {
+    return ESP_ERR_NVS_NO_FREE_PAGES;
+  }
+  entry->value = value;
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *value) {
+  uint32_t raw;
+  esp_err_t err = getValue(handle, key, SIM_NVS_U8, raw);
+  if (err == ESP_OK) {
+    *value = (uint8_t)raw;
+  }
+  return err;
+}
+
+esp_err_t nvs_get_u16(nvs_handle_t handle, const char *key, uint16_t *value) {
+  uint32_t raw;
+  esp_err_t err = getValue(handle, key, SIM_NVS_U16, raw);
+  if (err == ESP_OK) {
+    *value = (uint16_t)raw;
+  }
+  return err;
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *value) {
+  return getValue(handle, key, SIM_NVS_U32, *value);
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char *key, int32_t *value) {
+  uint32_t raw;
+  esp_err_t err = getValue(handle, key, SIM_NVS_I32, raw);
+  if (err == ESP_OK) {
+    *value = (int32_t)raw;
+  }
+  return err;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *value, size_t *length) {
+  SimNvsEntry *entry = findEntry(handle, key, SIM_NVS_STR);
+  if (entry == NULL) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  size_t needed = strlen(entry->text) + 1;
+  if (value != NULL) {
+    if (*length < needed) {
+      return ESP_ERR_NVS_BASE + 0x0c;  // ESP_ERR_NVS_INVALID_LENGTH
+    }
+    memcpy(value, entry->text, needed);
+  }
+  *length = needed;
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value) {
+  return setValue(handle, key, SIM_NVS_U8, value);
+}
+
+esp_err_t nvs_set_u16(nvs_handle_t handle, const char *key, uint16_t value) {
+  return setValue(handle, key, SIM_NVS_U16, value);
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value) {
+  return setValue(handle, key, SIM_NVS_U32, value);
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char *key, int32_t value) {
+  return setValue(handle, key, SIM_NVS_I32, (uint32_t)value);
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value) {
+  if (strlen(value) >= SIM_NVS_STRING_SIZE) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  SimNvsEntry *entry = setEntry(handle, key, SIM_NVS_STR);
+  if (entry == NULL) {
+    return ESP_ERR_NVS_NO_FREE_PAGES;
+  }
+  snprintf(entry->text, sizeof(entry->text), "%s", value);
+  return ESP_OK;
+}
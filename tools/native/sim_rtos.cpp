@@ -0,0 +1,802 @@
+// Virtual-time FreeRTOS for the native simulation.
+//
+// Every task is a host thread, but only the one holding `current` executes;
+// the rest wait on their condition variable. A task gives up the CPU only
+// inside the RTOS API: blocking (delay, notification, mutex, queue), or
+// busy-waiting with simConsume() (delayMicroseconds, spins on the clock,
+// bit-banging). Code between two such calls takes no virtual time.
+//
+// Two cores: a busy-waiting task keeps its core until its wait ends, while
+// tasks pinned to or free to run on the other core carry on. Ready tasks
+// are picked by priority, then in the order they became ready; a task is
+// not preempted while it runs or busy-waits. Timeouts end on tick
+// boundaries, like the tick interrupt does. Harness tasks (the world model
+// in sim_main.cpp) run on a third, virtual core so they never steal ESP32
+// CPU time. When nothing can run, time jumps to the next wake-up.
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "sim.h"
+
+#define SIM_MAX_TASKS 24
+#define SIM_FOREVER INT64_MAX
+#define SIM_TICK_US (1000000LL / configTICK_RATE_HZ)
+
+enum SimState { SIM_READY, SIM_RUNNING, SIM_BUSY, SIM_BLOCKED, SIM_DELETED };
+
+enum SimWait { SIM_WAIT_NONE, SIM_WAIT_DELAY, SIM_WAIT_NOTIFY, SIM_WAIT_SEMAPHORE,
+               SIM_WAIT_QUEUE_RECEIVE, SIM_WAIT_QUEUE_SEND };
+
+struct SimTask {
+  char name[configMAX_TASK_NAME_LEN];
+  TaskFunction_t code;
+  void *parameters;
+  UBaseType_t priority;
+  int affinity;  // Core it is pinned to, or -1
+  int core;      // Core it runs (or last ran) on
+  uint32_t stackBytes;
+  SimState state;
+  SimWait wait;
+  void *waitObject;
+  int64_t wakeUs;      // Busy: end of the wait; blocked: timeout
+  int64_t readyUs;     // Ready since
+  uint64_t order;      // Ready (or blocked) order, for FIFO among equals
+  bool timedOut;
+  uint32_t notifyValue;
+  bool notifyPending;
+  uint32_t criticalDepth;
+  uint64_t busyUs;
+  std::thread thread;
+  std::condition_variable resume;
+};
+
+struct SimSemaphore {
+  SimTask *holder;
+};
+
+struct SimQueue {
+  uint8_t *storage;
+  UBaseType_t length;
+  UBaseType_t itemSize;
+  UBaseType_t head;
+  UBaseType_t count;
+};
+
+SimCounters simCounters;
+
+static std::mutex lock;
+static std::condition_variable finishedCondition;
+static bool finished = false;
+static SimTask tasks[SIM_MAX_TASKS];
+static int taskCount = 0;
+static SimTask idleTasks[SIM_CORES];  // Reported only, never scheduled
+static SimTask *owner[SIM_CORES + 1];  // Running or busy-waiting, per core
+static SimTask *current = NULL;
+static int64_t nowUs = 0;
+static uint64_t coreBusyUs[SIM_CORES];
+static uint64_t orderCounter = 0;
+static thread_local SimTask *self = NULL;
+
+static void fatal(const char *what) {
+  fflush(stdout);
+  fprintf(stderr, "sim: %s at %lld us\n", what, (long long)nowUs);
+  _exit(2);
+}
+
+static void makeReady(SimTask *task, int64_t sinceUs) {
+  task->state = SIM_READY;
+  task->wait = SIM_WAIT_NONE;
+  task->waitObject = NULL;
+  task->readyUs = sinceUs;
+  task->order = ++orderCounter;
+}
+
+static bool canRunOn(const SimTask *task, int core) {
+  if (task->affinity >= 0) {
+    return task->affinity == core;
+  }
+  return core < SIM_CORES;
+}
+
+// Wake blocked tasks whose timeout has passed
+static void expireTimeouts() {
+  for (int i = 0; i < taskCount; i++) {
+    SimTask *task = &tasks[i];
+    if (task->state == SIM_BLOCKED && task->wakeUs <= nowUs) {
+      task->timedOut = true;
+      makeReady(task, task->wakeUs);
+    }
+  }
+}
+
+// The task to run next at the current time, or NULL if none can
+static SimTask *pickRunnable(int &pickedCore) {
+  SimTask *best = NULL;
+  int64_t bestSinceUs = 0;
+  for (int core = 0; core <= SIM_CORES; core++) {
+    SimTask *candidate = NULL;
+    int64_t sinceUs = 0;
+    if (owner[core] != NULL) {
+      if (owner[core]->state != SIM_BUSY || owner[core]->wakeUs > nowUs) {
+        continue;
+      }
+      candidate = owner[core];
+      sinceUs = candidate->wakeUs;
+    } else {
+      for (int i = 0; i < taskCount; i++) {
+        SimTask *task = &tasks[i];
+        if (task->state != SIM_READY || !canRunOn(task, core)) {
+          continue;
+        }
+        if (candidate == NULL || task->priority > candidate->priority ||
+            (task->priority == candidate->priority && task->order < candidate->order)) {
+          candidate = task;
+        }
+      }
+      if (candidate == NULL) {
+        continue;
+      }
+      sinceUs = candidate->readyUs;
+    }
+    if (best == NULL || sinceUs < bestSinceUs ||
+        (sinceUs == bestSinceUs && candidate->priority > best->priority)) {
+      best = candidate;
+      bestSinceUs = sinceUs;
+      pickedCore = core;
+    }
+  }
+  return best;
+}
+
+// Pick the next task, moving time forward until one can run (lock held)
+static SimTask *nextTask() {
+  while (true) {
+    expireTimeouts();
+    int core = 0;
+    SimTask *task = pickRunnable(core);
+    if (task != NULL) {
+      if (task->state == SIM_READY) {
+        task->core = core;
+        owner[core] = task;
+      }
+      task->state = SIM_RUNNING;
+      return task;
+    }
+
+    int64_t nextUs = SIM_FOREVER;
+    for (int i = 0; i < taskCount; i++) {
+      SimTask *other = &tasks[i];
+      if ((other->state == SIM_BUSY || other->state == SIM_BLOCKED) && other->wakeUs < nextUs) {
+        nextUs = other->wakeUs;
+      }
+    }
+    if (nextUs == SIM_FOREVER) {
+      fatal("deadlock, every task is blocked forever");
+    }
+    nowUs = nextUs;
+  }
+}
+
+static void run(SimTask *task) {
+  current = task;
+  simCounters.contextSwitches++;
+  task->resume.notify_one();
+}
+
+// Hand the CPU to the next task and wait for our turn (lock held; the
+// caller has already set its own state)
+static void switchAway(std::unique_lock<std::mutex> &held) {
+  SimTask *me = self;
+  SimTask *next = nextTask();
+  if (next == me) {
+    return;
+  }
+  run(next);
+  me->resume.wait(held, [me] { return current == me; });
+}
+
+static void releaseCore(SimTask *task) {
+  if (owner[task->core] == task) {
+    owner[task->core] = NULL;
+  }
+}
+
+// Block the running task until woken or until `untilUs`; false on timeout
+static bool blockSelf(std::unique_lock<std::mutex> &held, SimWait wait, void *object,
+                      int64_t untilUs) {
+  SimTask *me = self;
+  me->state = SIM_BLOCKED;
+  me->wait = wait;
+  me->waitObject = object;
+  me->wakeUs = untilUs;
+  me->order = ++orderCounter;
+  me->timedOut = false;
+  releaseCore(me);
+  switchAway(held);
+  return !me->timedOut;
+}
+
+static int64_t tickDeadline(TickType_t ticks) {
+  if (ticks == portMAX_DELAY) {
+    return SIM_FOREVER;
+  }
+  return (nowUs / SIM_TICK_US + ticks) * SIM_TICK_US;
+}
+
+// Highest-priority, longest-waiting task blocked on `object`
+static SimTask *firstWaiter(SimWait wait, void *object) {
+  SimTask *first = NULL;
+  for (int i = 0; i < taskCount; i++) {
+    SimTask *task = &tasks[i];
+    if (task->state != SIM_BLOCKED || task->wait != wait || task->waitObject != object) {
+      continue;
+    }
+    if (first == NULL || task->priority > first->priority ||
+        (task->priority == first->priority && task->order < first->order)) {
+      first = task;
+    }
+  }
+  return first;
+}
+
+static void taskMain(SimTask *task) {
+  self = task;
+  {
+    std::unique_lock<std::mutex> held(lock);
+    task->resume.wait(held, [task] { return current == task; });
+  }
+  task->code(task->parameters);
+  vTaskDelete(NULL);
+}
+
+static SimTask *createTask(TaskFunction_t code, const char *name, uint32_t stackBytes,
+                           void *parameters, UBaseType_t priority, int affinity) {
+  std::unique_lock<std::mutex> held(lock);
+  if (taskCount >= SIM_MAX_TASKS) {
+    fatal("too many tasks");
+  }
+  SimTask *task = &tasks[taskCount++];
+  snprintf(task->name, sizeof(task->name), "%s", name);
+  task->code = code;
+  task->parameters = parameters;
+  task->priority = priority;
+  task->affinity = affinity;
+  task->core = affinity >= 0 ? affinity : 0;
+  task->stackBytes = stackBytes;
+  makeReady(task, nowUs);
+  task->thread = std::thread(taskMain, task);
+  return task;
+}
+
+// ---------------------------------------------------------------------------
+// Harness side
+
+int64_t simNowUs() {
+  return nowUs;
+}
+
+bool simInTask() {
+  return self != NULL;
+}
+
+void simConsume(uint32_t us) {
+  if (self == NULL) {
+    nowUs += us;
+    return;
+  }
+  std::unique_lock<std::mutex> held(lock);
+  SimTask *me = self;
+  int64_t untilUs = nowUs + us;
+  me->busyUs += us;
+  if (me->core < SIM_CORES) {
+    coreBusyUs[me->core] += us;
+  }
+  if (me->criticalDepth > 0) {
+    nowUs = untilUs;
+    return;
+  }
+
+  // Fast path: nothing else wants a core before the wait ends
+  bool alone = true;
+  for (int i = 0; i < taskCount && alone; i++) {
+    SimTask *task = &tasks[i];
+    if (task == me) {
+      continue;
+    }
+    if (task->state == SIM_READY) {
+      for (int core = 0; core <= SIM_CORES; core++) {
+        if (owner[core] == NULL && canRunOn(task, core)) {
+          alone = false;
+        }
+      }
+    } else if ((task->state == SIM_BUSY || task->state == SIM_BLOCKED) &&
+               task->wakeUs <= untilUs) {
+      alone = false;
+    }
+  }
+  if (alone) {
+    nowUs = untilUs;
+    return;
+  }
+
+  me->state = SIM_BUSY;
+  me->wakeUs = untilUs;
+  switchAway(held);
+}
+
+void simBlock(uint32_t us) {
+  if (self == NULL) {
+    nowUs += us;
+    return;
+  }
+  std::unique_lock<std::mutex> held(lock);
+  blockSelf(held, SIM_WAIT_DELAY, NULL, nowUs + us);
+}
+
+void simSleepUntil(int64_t atUs) {
+  std::unique_lock<std::mutex> held(lock);
+  if (atUs > nowUs) {
+    blockSelf(held, SIM_WAIT_DELAY, NULL, atUs);
+  }
+}
+
+void simWakeEarlier(TaskHandle_t task, int64_t atUs) {
+  std::unique_lock<std::mutex> held(lock);
+  if (task->state == SIM_BLOCKED && task->wait == SIM_WAIT_DELAY && atUs < task->wakeUs) {
+    task->wakeUs = atUs < nowUs ? nowUs : atUs;
+  }
+}
+
+TaskHandle_t simCreateWorldTask(TaskFunction_t code, const char *name, void *parameters) {
+  return createTask(code, name, 0, parameters, configMAX_PRIORITIES - 1, SIM_CORES);
+}
+
+void simRun() {
+  std::unique_lock<std::mutex> held(lock);
+  run(nextTask());
+  finishedCondition.wait(held, [] { return finished; });
+}
+
+void simFinish() {
+  std::unique_lock<std::mutex> held(lock);
+  finished = true;
+  finishedCondition.notify_all();
+  // The caller never runs again; the main thread reports and exits
+  self->resume.wait(held, [] { return false; });
+}
+
+void simTaskRunTimes(void (*each)(const char *name, int core, uint64_t busyUs, void *arg),
+                     void *arg) {
+  for (int i = 0; i < taskCount; i++) {
+    if (tasks[i].affinity != SIM_CORES) {
+      each(tasks[i].name, tasks[i].affinity, tasks[i].busyUs, arg);
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Critical sections
+
+void simEnterCritical(portMUX_TYPE *mux) {
+  if (self != NULL) {
+    self->criticalDepth++;
+  }
+  mux->count++;
+}
+
+void simExitCritical(portMUX_TYPE *mux) {
+  mux->count--;
+  if (self != NULL) {
+    self->criticalDepth--;
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Tasks
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stackDepth,
+                                   void *parameters, UBaseType_t priority,
+                                   TaskHandle_t *created, BaseType_t coreId) {
+  int affinity = coreId >= 0 && coreId < SIM_CORES ? coreId : -1;
+  SimTask *task = createTask(code, name, stackDepth, parameters, priority, affinity);
+  if (created != NULL) {
+    *created = task;
+  }
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stackDepth,
+                       void *parameters, UBaseType_t priority, TaskHandle_t *created) {
+  return xTaskCreatePinnedToCore(code, name, stackDepth, parameters, priority, created,
+                                 tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  std::unique_lock<std::mutex> held(lock);
+  if (task != NULL && task != self) {
+    releaseCore(task);
+    task->state = SIM_DELETED;
+    return;
+  }
+  SimTask *me = self;
+  me->state = SIM_DELETED;
+  releaseCore(me);
+  switchAway(held);
+  me->resume.wait(held, [] { return false; });
+}
+
+void vTaskDelay(TickType_t ticks) {
+  std::unique_lock<std::mutex> held(lock);
+  if (ticks == 0) {
+    makeReady(self, nowUs);
+    releaseCore(self);
+    switchAway(held);
+    return;
+  }
+  blockSelf(held, SIM_WAIT_DELAY, NULL, tickDeadline(ticks));
+}
+
+TickType_t xTaskGetTickCount() {
+  return (TickType_t)(nowUs / SIM_TICK_US);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return self;
+}
+
+TaskHandle_t xTaskGetIdleTaskHandleForCPU(UBaseType_t cpu) {
+  return cpu < SIM_CORES ? &idleTasks[cpu] : NULL;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+  return (task != NULL ? task : self)->priority;
+}
+
+// Stack use is not modelled: report the whole stack as headroom
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  return (task != NULL ? task : self)->stackBytes;
+}
+
+char *pcTaskGetName(TaskHandle_t task) {
+  return (task != NULL ? task : self)->name;
+}
+
+BaseType_t xPortGetCoreID() {
+  return self != NULL && self->core < SIM_CORES ? self->core : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Notifications
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+  std::unique_lock<std::mutex> held(lock);
+  switch (action) {
+    case eSetBits:
+      task->notifyValue |= value;
+      break;
+    case eIncrement:
+      task->notifyValue++;
+      break;
+    case eSetValueWithOverwrite:
+      task->notifyValue = value;
+      break;
+    case eSetValueWithoutOverwrite:
+      if (task->notifyPending) {
+        return pdFAIL;
+      }
+      task->notifyValue = value;
+      break;
+    case eNoAction:
+      break;
+  }
+  task->notifyPending = true;
+  simCounters.notifications++;
+  if (task->state == SIM_BLOCKED && task->wait == SIM_WAIT_NOTIFY) {
+    makeReady(task, nowUs);
+  }
+  return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  return xTaskNotify(task, 0, eIncrement);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken) {
+  xTaskNotify(task, 0, eIncrement);
+  if (higherPriorityTaskWoken != NULL) {
+    *higherPriorityTaskWoken = pdFALSE;
+  }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  std::unique_lock<std::mutex> held(lock);
+  SimTask *me = self;
+  if (me->notifyValue == 0 && ticks != 0) {
+    blockSelf(held, SIM_WAIT_NOTIFY, NULL, tickDeadline(ticks));
+  }
+  uint32_t value = me->notifyValue;
+  if (value != 0) {
+    me->notifyValue = clearOnExit ? 0 : value - 1;
+  }
+  me->notifyPending = false;
+  return value;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t *value,
+                           TickType_t ticks) {
+  std::unique_lock<std::mutex> held(lock);
+  SimTask *me = self;
+  if (!me->notifyPending) {
+    me->notifyValue &= ~clearOnEntry;
+    if (ticks != 0) {
+      blockSelf(held, SIM_WAIT_NOTIFY, NULL, tickDeadline(ticks));
+    }
+  }
+  if (value != NULL) {
+    *value = me->notifyValue;
+  }
+  if (!me->notifyPending) {
+    return pdFALSE;
+  }
+  me->notifyValue &= ~clearOnExit;
+  me->notifyPending = false;
+  return pdTRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Mutexes
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  SimSemaphore *semaphore = (SimSemaphore *)malloc(sizeof(SimSemaphore));
+  semaphore->holder = NULL;
+  return semaphore;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+  free(semaphore);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+  std::unique_lock<std::mutex> held(lock);
+  if (semaphore->holder == NULL) {
+    semaphore->holder = self;
+    simCounters.mutexTakes++;
+    return pdTRUE;
+  }
+  if (ticks == 0) {
+    return pdFALSE;
+  }
+  simCounters.mutexContended++;
+  int64_t startUs = nowUs;
+  bool taken = blockSelf(held, SIM_WAIT_SEMAPHORE, semaphore, tickDeadline(ticks));
+  uint32_t waitedUs = (uint32_t)(nowUs - startUs);
+  simCounters.mutexWaitUs += waitedUs;
+  if (waitedUs > simCounters.mutexMaxWaitUs) {
+    simCounters.mutexMaxWaitUs = waitedUs;
+  }
+  if (taken) {
+    simCounters.mutexTakes++;
+  }
+  return taken ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  std::unique_lock<std::mutex> held(lock);
+  if (semaphore->holder != self) {
+    return pdFALSE;
+  }
+  // Ownership passes straight to the first waiter
+  SimTask *waiter = firstWaiter(SIM_WAIT_SEMAPHORE, semaphore);
+  semaphore->holder = waiter;
+  if (waiter != NULL) {
+    makeReady(waiter, nowUs);
+  }
+  return pdTRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Queues
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  SimQueue *queue = (SimQueue *)malloc(sizeof(SimQueue));
+  queue->storage = (uint8_t *)malloc(length * itemSize);
+  queue->length = length;
+  queue->itemSize = itemSize;
+  queue->head = 0;
+  queue->count = 0;
+  return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+  std::unique_lock<std::mutex> held(lock);
+  int64_t deadlineUs = tickDeadline(ticks);
+  while (queue->count == queue->length) {
+    if (ticks == 0 || !blockSelf(held, SIM_WAIT_QUEUE_SEND, queue, deadlineUs)) {
+      return pdFALSE;
+    }
+  }
+  UBaseType_t tail = (queue->head + queue->count) % queue->length;
+  memcpy(queue->storage + tail * queue->itemSize, item, queue->itemSize);
+  queue->count++;
+  simCounters.queueSends++;
+  SimTask *waiter = firstWaiter(SIM_WAIT_QUEUE_RECEIVE, queue);
+  if (waiter != NULL) {
+    makeReady(waiter, nowUs);
+  }
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+  std::unique_lock<std::mutex> held(lock);
+  int64_t deadlineUs = tickDeadline(ticks);
+  while (queue->count == 0) {
+    if (ticks == 0 || !blockSelf(held, SIM_WAIT_QUEUE_RECEIVE, queue, deadlineUs)) {
+      return pdFALSE;
+    }
+  }
+  memcpy(item, queue->storage + queue->head * queue->itemSize, queue->itemSize);
+  queue->head = (queue->head + 1) % queue->length;
+  queue->count--;
+  SimTask *waiter = firstWaiter(SIM_WAIT_QUEUE_SEND, queue);
+  if (waiter != NULL) {
+    makeReady(waiter, nowUs);
+  }
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::unique_lock<std::mutex> held(lock);
+  return queue->count;
+}
+
+// ---------------------------------------------------------------------------
+// Trace facility: run time is CPU time in microseconds, idle is the rest
+
+UBaseType_t uxTaskGetNumberOfTasks() {
+  std::unique_lock<std::mutex> held(lock);
+  UBaseType_t count = SIM_CORES;
+  for (int i = 0; i < taskCount; i++) {
+    if (tasks[i].affinity != SIM_CORES && tasks[i].state != SIM_DELETED) {
+      count++;
+    }
+  }
+  return count;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *statuses, UBaseType_t count,
+                                 uint32_t *totalRunTime) {
+  std::unique_lock<std::mutex> held(lock);
+  UBaseType_t filled = 0;
+  for (int core = 0; core < SIM_CORES && filled < count; core++) {
+    SimTask *idle = &idleTasks[core];
+    snprintf(idle->name, sizeof(idle->name), "IDLE%d", core);
+    TaskStatus_t &status = statuses[filled++];
+    status.xHandle = idle;
+    status.pcTaskName = idle->name;
+    status.xTaskNumber = filled;
+    status.eCurrentState = eReady;
+    status.uxCurrentPriority = tskIDLE_PRIORITY;
+    status.uxBasePriority = tskIDLE_PRIORITY;
+    status.ulRunTimeCounter = (uint32_t)(nowUs - (int64_t)coreBusyUs[core]);
+    status.pxStackBase = NULL;
+    status.usStackHighWaterMark = 1024;
+    status.xCoreID = core;
+  }
+  for (int i = 0; i < taskCount && filled < count; i++) {
+    SimTask *task = &tasks[i];
+    if (task->affinity == SIM_CORES || task->state == SIM_DELETED) {
+      continue;
+    }
+    static const eTaskState states[] = {eReady, eRunning, eRunning, eBlocked, eDeleted};
+    TaskStatus_t &status = statuses[filled++];
+    status.xHandle = task;
+    status.pcTaskName = task->name;
+    status.xTaskNumber = filled;
+    status.eCurrentState = states[task->state];
+    status.uxCurrentPriority = task->priority;
+    status.uxBasePriority = task->priority;
+    status.ulRunTimeCounter = (uint32_t)task->busyUs;
+    status.pxStackBase = NULL;
+    status.usStackHighWaterMark = task->stackBytes;
+    status.xCoreID = task->affinity >= 0 ? task->affinity : tskNO_AFFINITY;
+  }
+  if (totalRunTime != NULL) {
+    *totalRunTime = (uint32_t)nowUs;
+  }
+  return filled;
+}
+
+// ---------------------------------------------------------------------------
+// esp_timer: callbacks run in the "esp_timer" task, as with ESP_TIMER_TASK
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void *arg;
+  int64_t fireUs;  // 0 when stopped
+  uint64_t periodUs;
+  esp_timer *next;
+};
+
+static esp_timer *timers = NULL;
+static TaskHandle_t timerTask = NULL;
+
+int64_t esp_timer_get_time() {
+  simConsume(1);  // Reading the timer takes about a microsecond
+  return nowUs;
+}
+
+static void timerTaskMain(void *parameters) {
+  while (true) {
+    int64_t nextUs = SIM_FOREVER;
+    for (esp_timer *timer = timers; timer != NULL; timer = timer->next) {
+      if (timer->fireUs != 0 && timer->fireUs <= nowUs) {
+        timer->fireUs = timer->periodUs ? timer->fireUs + timer->periodUs : 0;
+        timer->callback(timer->arg);
+      }
+      if (timer->fireUs != 0 && timer->fireUs < nextUs) {
+        nextUs = timer->fireUs;
+      }
+    }
+    std::unique_lock<std::mutex> held(lock);
+    if (timerTask->notifyValue == 0) {
+      blockSelf(held, SIM_WAIT_NOTIFY, NULL, nextUs);
+    }
+    timerTask->notifyValue = 0;
+  }
+}
+
+static void rearmTimerTask() {
+  if (timerTask == NULL) {
+    timerTask = createTask(timerTaskMain, "esp_timer", 3584, NULL, 22, 0);
+  }
+  xTaskNotifyGive(timerTask);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle) {
+  esp_timer *timer = (esp_timer *)calloc(1, sizeof(esp_timer));
+  if (timer == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  timer->callback = args->callback;
+  timer->arg = args->arg;
+  {
+    std::unique_lock<std::mutex> held(lock);
+    timer->next = timers;
+    timers = timer;
+  }
+  *handle = timer;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs) {
+  if (timer->fireUs != 0) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->fireUs = nowUs + (int64_t)timeoutUs;
+  timer->periodUs = 0;
+  rearmTimerTask();
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs) {
+  if (timer->fireUs != 0) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->fireUs = nowUs + (int64_t)periodUs;
+  timer->periodUs = periodUs;
+  rearmTimerTask();
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (timer->fireUs == 0) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->fireUs = 0;
+  return ESP_OK;
+}
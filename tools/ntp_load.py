@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+"""Load-test the clock's SNTP server with many stand-in NTP clients.
+
+Sends mode-3 requests from several UDP sockets (one per stand-in client) at
+a fixed rate, optionally in bursts, and checks every reply the way a client
+would: mode 4, originate timestamp echoing our transmit timestamp, version
+echoed, receive <= transmit. The summary shows loss, the reply rate
+achieved, leap/stratum/reference as served, root delay and dispersion, and
+percentiles of round-trip delay, clock offset and the server's own
+receive-to-transmit time (T3 - T2).
+
+--self-test starts a local stand-in server on 127.0.0.1 that answers like
+the firmware, to check the tool itself without a device.
+
+Usage:
+    tools/ntp_load.py 192.168.1.50
+    tools/ntp_load.py 192.168.1.50 --rate 500 --seconds 20 --clients 16
+    tools/ntp_load.py 192.168.1.50 --rate 800 --burst 200
+    tools/ntp_load.py --self-test
+"""
+
+import argparse
+import select
+import socket
+import struct
+import threading
+import time
+
+NTP_EPOCH_DELTA = 2208988800  # 1900-01-01 to 1970-01-01
+PACKET = struct.Struct('!BBbbII4sQQQQ')
+
+
+def to_ntp(t):
+    return (int(t) + NTP_EPOCH_DELTA) << 32 | int((t % 1) * (1 << 32))
+
+
+def from_ntp(value):
+    return (value >> 32) - NTP_EPOCH_DELTA + (value & 0xFFFFFFFF) / (1 << 32)
+
+
+def short_to_s(value):
+    return value / 65536.0
+
+
+def percentile(values, p):
+    if not values:
+        return float('nan')
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100.0))]
+
+
+def stand_in_server(sock, stop):
+    """Answer like the firmware: stratum 2, leap 0, 10 ms root delay."""
+    refid = socket.inet_aton('127.0.0.1')
+    reference = to_ntp(time.time())
+    while not stop.is_set():
+        ready, _, _ = select.select([sock], [], [], 0.1)
+        if not ready:
+            continue
+        data, addr = sock.recvfrom(512)
+        t2 = time.time()
+        if len(data) < 48 or data[0] & 7 != 3:
+            continue
+        version = (data[0] >> 3) & 7
+        transmit = data[40:48]
+        reply = bytearray(PACKET.pack((0 << 6) | (version << 3) | 4, 2, data[2], -20,
+                                      int(0.010 * 65536), int(0.001 * 65536), refid,
+                                      reference, 0, to_ntp(t2), 0))
+        reply[24:32] = transmit
+        reply[40:48] = struct.pack('!Q', to_ntp(time.time()))
+        sock.sendto(bytes(reply), addr)
+
+
+def run(args):
+    stop = threading.Event()
+    server = None
+    if args.self_test:
+        listener = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        listener.bind(('127.0.0.1', 0))
+        args.host, args.port = listener.getsockname()
+        server = threading.Thread(target=stand_in_server, args=(listener, stop), daemon=True)
+        server.start()
+
+    target = (socket.gethostbyname(args.host), args.port)
+    clients = []
+    for _ in range(args.clients):
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        sock.setblocking(False)
+        clients.append(sock)
+
+    outstanding = {}  # transmit timestamp -> send time
+    sent = replies = invalid = send_errors = 0
+    leaps, strata, refids = {}, {}, {}
+    delays, offsets, serve_times = [], [], []
+    root_delay = root_dispersion = None
+
+    burst = max(1, args.burst)
+    interval = burst / float(args.rate)
+    start = time.time()
+    next_send = start
+    end = start + args.seconds
+    sequence = 0
+    while True:
+        now = time.time()
+        if now >= next_send and now < end:
+            for _ in range(burst):
+                sock = clients[sequence % len(clients)]
+                t1 = time.time()
+                # Low fraction bits carry a sequence number so every request is unique
+                transmit = (to_ntp(t1) & ~0xFFFF) | (sequence & 0xFFFF)
+                packet = bytearray(48)
+                packet[0] = (0 << 6) | (4 << 3) | 3
+                packet[40:48] = struct.pack('!Q', transmit)
+                try:
+                    sock.sendto(bytes(packet), target)
+                    outstanding[transmit] = t1
+                    sent += 1
+                except (BlockingIOError, OSError):
+                    send_errors += 1
+                sequence += 1
+            next_send += interval
+        if now >= end + args.timeout:
+            break
+
+        wait = max(0.0, min(next_send, end + args.timeout) - time.time())
+        ready, _, _ = select.select(clients, [], [], wait)
+        for sock in ready:
+            while True:
+                try:
+                    data = sock.recv(512)
+                except (BlockingIOError, OSError):
+                    break
+                t4 = time.time()
+                if len(data) < 48:
+                    invalid += 1
+                    continue
+                (flags, stratum, _poll, _precision, rdelay, rdisp, refid,
+                 _reference, originate, receive, transmit) = PACKET.unpack(data[:48])
+                t1 = outstanding.pop(originate, None)
+                if t1 is None or flags & 7 != 4 or (flags >> 3) & 7 != 4:
+                    invalid += 1
+                    continue
+                t2, t3 = from_ntp(receive), from_ntp(transmit)
+                if t3 < t2:
+                    invalid += 1
+                    continue
+                replies += 1
+                leap = flags >> 6
+                leaps[leap] = leaps.get(leap, 0) + 1
+                strata[stratum] = strata.get(stratum, 0) + 1
+                refids[socket.inet_ntoa(refid)] = True
+                root_delay, root_dispersion = short_to_s(rdelay), short_to_s(rdisp)
+                delays.append((t4 - t1) - (t3 - t2))
+                offsets.append(((t2 - t1) + (t3 - t4)) / 2)
+                serve_times.append(t3 - t2)
+
+    stop.set()
+    if server:
+        server.join()
+
+    elapsed = args.seconds
+    lost = sent - replies - invalid
+    print('sent: %d (%.0f/s)  replies: %d (%.0f/s)  lost: %d (%.1f%%)  invalid: %d  send errors: %d'
+          % (sent, sent / elapsed, replies, replies / elapsed, lost,
+             100.0 * lost / sent if sent else 0, invalid, send_errors))
+    if not replies:
+        return
+    print('leap: %s  stratum: %s  refid: %s'
+          % (', '.join('%d x%d' % kv for kv in sorted(leaps.items())),
+             ', '.join('%d x%d' % kv for kv in sorted(strata.items())),
+             ', '.join(sorted(refids))))
+    print('root delay: %.3f ms  root dispersion: %.3f ms' % (root_delay * 1e3, root_dispersion * 1e3))
+    for name, values in (('delay', delays), ('offset', offsets), ('server T3-T2', serve_times)):
+        print('%-13s p50 %8.3f ms  p99 %8.3f ms  max %8.3f ms'
+              % (name, percentile(values, 50) * 1e3, percentile(values, 99) * 1e3,
+                 max(values) * 1e3))
+    if 3 in leaps:
+        print('note: leap 3 replies mean the clock has not synced since boot or was set by hand')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('host', nargs='?', help='clock IP address or hostname')
+    parser.add_argument('--port', type=int, default=123)
+    parser.add_argument('--clients', type=int, default=8, help='UDP sockets (source ports)')
+    parser.add_argument('--rate', type=float, default=200, help='requests per second in total')
+    parser.add_argument('--burst', type=int, default=1, help='requests sent back to back')
+    parser.add_argument('--seconds', type=float, default=10)
+    parser.add_argument('--timeout', type=float, default=1.0, help='wait for late replies')
+    parser.add_argument('--self-test', action='store_true', help='run against a local stand-in')
+    args = parser.parse_args()
+    if not args.host and not args.self_test:
+        parser.error('host is required unless --self-test is given')
+    run(args)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,393 @@
+// Host check for the SNTP client (src/sntp_client.*) and the DS1307 drift
+// estimate that sets the sync interval (src/rtc_drift.*).
+//
+// The client runs unchanged on real UDP sockets: WiFiUDP, WiFi.hostByName()
+// and the in-memory clock are small POSIX stand-ins below. Three stand-in
+// servers listen on 127.0.0.2-4, each with a known clock offset and a known
+// round-trip delay (half slept before stamping T2, half after T3), next to
+// a name that does not resolve, which must cost no request:
+//   - the fastest server answers with leap 3 (unsynchronized) and must be
+//     rejected;
+//   - of the two good ones the client must keep the smaller delay, with the
+//     offset and delay it measured within the scheduling tolerance;
+//   - a second round, with one server silent, ends on SNTP_TIMEOUT_MS and
+//     switches to the recovered server.
+// The drift estimate is then fed RTC errors from a DS1307 running at known
+// rates and must report the rate, the moving average and the clamped sync
+// interval, and ignore samples it cannot trust (short baseline, reset,
+// hand-set time).
+//
+// Build and run from the repository root:
+//   g++ -std=gnu++11 -O2 -Wall -Itools/native/include -Isrc -DCLOCK_LATENCY=0 tools/sntp_client_test.cpp src/sntp_client.cpp src/rtc_drift.cpp -lpthread -o sntp_client_test && ./sntp_client_test
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "rtc_drift.h"
+#include "sntp_client.h"
+#include "soft_clock.h"
+
+#define TEST_PORT 41123             // Stand-in servers, unprivileged
+#define TOLERANCE_US 4000           // Scheduling slack on a loaded host
+
+static int failures = 0;
+
+static void fail(const char *name, const char *what) {
+  printf("FAIL %s: %s\n", name, what);
+  failures++;
+}
+
+// Stand-ins for what the client links against
+
+static int64_t hostNowUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+unsigned long millis() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)(ts.tv_sec * 1000UL + ts.tv_nsec / 1000000UL);
+}
+
+int64_t softClockNowUs() {
+  return hostNowUs();
+}
+
+void logWrite(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  printf("     ");
+  vprintf(format, args);
+  printf("\n");
+  va_end(args);
+}
+
+WiFiClass WiFi;
+
+int WiFiClass::hostByName(const char *name, IPAddress &address) {
+  // "ntpN.test" is 127.0.0.N; anything else does not resolve
+  int n;
+  if (sscanf(name, "ntp%d.test", &n) != 1) {
+    return 0;
+  }
+  address = IPAddress(127, 0, 0, (uint8_t)n);
+  return 1;
+}
+
+static sockaddr_in socketAddress(IPAddress address, uint16_t port) {
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = (uint32_t)address;  // IPAddress keeps network order
+  return addr;
+}
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+  socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in addr = socketAddress(IPAddress(127, 0, 0, 1), port);
+  if (socket < 0 || bind(socket, (sockaddr *)&addr, sizeof(addr)) != 0) {
+    return 0;
+  }
+  return 1;
+}
+
+void WiFiUDP::stop() {
+  if (socket >= 0) {
+    close(socket);
+    socket = -1;
+  }
+}
+
+int WiFiUDP::beginPacket(IPAddress address, uint16_t port) {
+  sendTo = address;
+  sendToPort = port;
+  sendLength = 0;
+  return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *data, size_t length) {
+  if (length > sizeof(sendBuffer) - sendLength) {
+    length = sizeof(sendBuffer) - sendLength;
+  }
+  memcpy(sendBuffer + sendLength, data, length);
+  sendLength += length;
+  return length;
+}
+
+int WiFiUDP::endPacket() {
+  sockaddr_in addr = socketAddress(sendTo, sendToPort);
+  return sendto(socket, sendBuffer, sendLength, 0, (sockaddr *)&addr, sizeof(addr)) ==
+         (ssize_t)sendLength;
+}
+
+int WiFiUDP::parsePacket() {
+  sockaddr_in from;
+  socklen_t fromLength = sizeof(from);
+  ssize_t length = recvfrom(socket, packet, sizeof(packet), MSG_DONTWAIT, (sockaddr *)&from,
+                            &fromLength);
+  if (length <= 0) {
+    packetLength = 0;
+    return 0;
+  }
+  packetLength = (size_t)length;
+  packetRead = 0;
+  packetFrom = IPAddress((uint32_t)from.sin_addr.s_addr);
+  packetFromPort = ntohs(from.sin_port);
+  return (int)length;
+}
+
+int WiFiUDP::read(uint8_t *data, size_t length) {
+  if (length > packetLength - packetRead) {
+    length = packetLength - packetRead;
+  }
+  memcpy(data, packet + packetRead, length);
+  packetRead += length;
+  return (int)length;
+}
+
+void WiFiUDP::flush() {
+  packetRead = packetLength;
+}
+
+// Stand-in NTP server: answers every request on 127.0.0.<host>:TEST_PORT
+// from the host clock plus offsetUs, after a round trip of delayUs
+
+struct StandIn {
+  uint8_t host;
+  int64_t offsetUs;
+  int64_t delayUs;
+  uint8_t leap;
+  bool silent;
+  int fd;
+};
+
+static std::atomic<bool> serversRunning{true};
+
+static void writeU64(uint8_t *p, uint64_t value) {
+  for (int i = 7; i >= 0; i--) {
+    p[i] = value & 0xFF;
+    value >>= 8;
+  }
+}
+
+static void serve(StandIn *server) {
+  uint8_t packet[64];
+  while (serversRunning.load()) {
+    sockaddr_in from;
+    socklen_t fromLength = sizeof(from);
+    ssize_t length = recvfrom(server->fd, packet, sizeof(packet), 0, (sockaddr *)&from, &fromLength);
+    if (length < 48 || server->silent) {
+      continue;
+    }
+    usleep((useconds_t)(server->delayUs / 2));
+    uint8_t reply[48];
+    memset(reply, 0, sizeof(reply));
+    reply[0] = (uint8_t)((server->leap << 6) | (4 << 3) | 4);
+    reply[1] = 2;                           // Stratum
+    reply[6] = 0x20;                        // Root delay, 1/8 s
+    memcpy(reply + 24, packet + 40, 8);     // Originate = the client's transmit
+    writeU64(reply + 32, sntpFromUnixUs(hostNowUs() + server->offsetUs));
+    writeU64(reply + 40, sntpFromUnixUs(hostNowUs() + server->offsetUs));
+    usleep((useconds_t)(server->delayUs / 2));
+    sendto(server->fd, reply, sizeof(reply), 0, (sockaddr *)&from, fromLength);
+  }
+}
+
+static bool openStandIn(StandIn &server) {
+  server.fd = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in addr = socketAddress(IPAddress(127, 0, 0, server.host), TEST_PORT);
+  timeval timeout = {0, 100000};
+  setsockopt(server.fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  return server.fd >= 0 && bind(server.fd, (sockaddr *)&addr, sizeof(addr)) == 0;
+}
+
+static bool near(int64_t value, int64_t expected, int64_t tolerance) {
+  return llabs(value - expected) <= tolerance;
+}
+
+// Function to run one round and wait for it to finish
+static bool runRound(SntpClient &client, SntpResult &result, unsigned long &elapsedMs) {
+  unsigned long startMs = millis();
+  if (!client.start()) {
+    return false;
+  }
+  while (!client.poll(result)) {
+    usleep(1000);
+  }
+  elapsedMs = millis() - startMs;
+  return true;
+}
+
+static void checkRound() {
+  StandIn servers[] = {
+    {2, 250000, 80000, 0, false, -1},   // Good, slow
+    {3, -40000, 20000, 0, false, -1},   // Good, fastest that counts
+    {4, 900000, 2000, 3, false, -1},    // Fastest, but not synchronized
+  };
+  const char *const names[] = {"ntp2.test", "ntp3.test", "ntp4.test", "nowhere.invalid"};
+  const uint8_t standIns = sizeof(servers) / sizeof(servers[0]);
+
+  std::vector<std::thread> threads;
+  for (uint8_t i = 0; i < standIns; i++) {
+    if (!openStandIn(servers[i])) {
+      fail("round", "could not bind a stand-in server");
+      return;
+    }
+    threads.push_back(std::thread(serve, &servers[i]));
+  }
+
+  SntpClient client(names, standIns + 1, TEST_PORT);
+  SntpResult result;
+  unsigned long elapsedMs = 0;
+  if (!runRound(client, result, elapsedMs)) {
+    fail("round", "start() sent nothing");
+  } else {
+    // The unresolved name costs no request; the rejected reply still counts
+    if (result.requests != 3 || result.responses != 3) {
+      fail("round", "expected 3 requests and 3 responses");
+    }
+    if (elapsedMs >= SNTP_TIMEOUT_MS) {
+      fail("round", "did not finish on the last reply");
+    }
+    if (!result.ok || result.serverIndex != 1) {
+      fail("round", "did not keep the smallest-delay valid sample");
+    } else {
+      const SntpSample &best = result.best;
+      if (!near(best.offsetUs, servers[1].offsetUs, TOLERANCE_US)) {
+        fail("round", "offset off the stand-in's clock");
+      }
+      if (best.delayUs < servers[1].delayUs - 1000 ||
+          best.delayUs > servers[1].delayUs + TOLERANCE_US) {
+        fail("round", "delay off the stand-in's round trip");
+      }
+      if (best.stratum != 2 || best.leap != 0 || best.rootDelayUs != 125000) {
+        fail("round", "header fields not carried over");
+      }
+      printf("ok   round: kept %s, offset %lld us (want %lld), delay %lld us (want %lld), %lu ms\n",
+             client.serverName(result.serverIndex), (long long)best.offsetUs,
+             (long long)servers[1].offsetUs, (long long)best.delayUs,
+             (long long)servers[1].delayUs, elapsedMs);
+    }
+  }
+
+  // Second round on the same socket and cached addresses: the slow server
+  // goes silent, the unsynchronized one recovers and is now the best
+  servers[0].silent = true;
+  servers[2].leap = 0;
+  servers[2].offsetUs = 10000;
+  servers[2].delayUs = 6000;
+  if (!runRound(client, result, elapsedMs) || !result.ok || result.serverIndex != 2 ||
+      !near(result.best.offsetUs, servers[2].offsetUs, TOLERANCE_US)) {
+    fail("second round", "did not switch to the new fastest server");
+  } else if (result.requests != 3 || result.responses != 2 || elapsedMs < SNTP_TIMEOUT_MS) {
+    fail("second round", "did not wait out the silent server");
+  } else {
+    printf("ok   second round: kept %s, offset %lld us, silent server timed out after %lu ms\n",
+           client.serverName(result.serverIndex), (long long)result.best.offsetUs, elapsedMs);
+  }
+
+  serversRunning.store(false);
+  for (size_t i = 0; i < threads.size(); i++) {
+    threads[i].join();
+    close(servers[i].fd);
+  }
+}
+
+// DS1307 running `ppm` fast since it was set `sinceS` seconds ago
+static int64_t rtcErrorUs(int64_t setErrorUs, double ppm, int64_t sinceS) {
+  return setErrorUs + (int64_t)(ppm * (double)sinceS);
+}
+
+static void checkDrift() {
+  const int64_t hourUs = 3600LL * 1000000LL;
+  RtcDrift drift;
+  rtcDriftInit(drift);
+  if (drift.known || drift.syncIntervalMs != NTP_SYNC_INTERVAL_DEFAULT_MS) {
+    fail("drift", "not unknown at the default interval after init");
+  }
+
+  // No reference write yet
+  if (rtcDriftUpdate(drift, 5000, hourUs)) {
+    fail("drift", "sample taken without a reference write");
+  }
+
+  // Set 1.2 ms late at t = 1 h; 20 ppm fast measured an hour on
+  int64_t t0 = hourUs;
+  rtcDriftWritten(drift, t0, -1200);
+  if (rtcDriftUpdate(drift, rtcErrorUs(-1200, 20.0, 300), t0 + 300LL * 1000000LL)) {
+    fail("drift", "sample taken on a 5 min baseline");
+  }
+  if (!rtcDriftUpdate(drift, rtcErrorUs(-1200, 20.0, 3600), t0 + hourUs) || !drift.known ||
+      !near((int64_t)(drift.ppm * 100), 2000, 1)) {
+    fail("drift", "first sample not taken as the rate");
+  }
+  // 100 ms budget at 20 ppm: 5000 s
+  if (drift.syncIntervalMs != 5000000) {
+    fail("drift", "interval does not keep the drift within the budget");
+  }
+  printf("ok   drift: %.2f ppm, next sync in %u min\n", drift.ppm,
+         (unsigned)(drift.syncIntervalMs / 60000));
+
+  // Re-set on the edge; 30 ppm over the next two hours moves the average
+  int64_t t1 = t0 + hourUs;
+  rtcDriftWritten(drift, t1, 0);
+  if (!rtcDriftUpdate(drift, rtcErrorUs(0, 30.0, 7200), t1 + 2 * hourUs) ||
+      !near((int64_t)(drift.ppm * 100), 2300, 1)) {
+    fail("drift", "moving average not 0.7 old + 0.3 new");
+  }
+
+  // A jump of seconds is a reset, not drift
+  float before = drift.ppm;
+  if (rtcDriftUpdate(drift, 6000000, t1 + 3 * hourUs) || drift.ppm != before) {
+    fail("drift", "multi-second error taken as drift");
+  }
+
+  // Fast RTC: clamped to the shortest interval
+  rtcDriftInit(drift);
+  rtcDriftWritten(drift, t0, 0);
+  rtcDriftUpdate(drift, rtcErrorUs(0, -400.0, 3600), t0 + hourUs);
+  if (drift.ppm > -399.9f || drift.syncIntervalMs != NTP_SYNC_INTERVAL_MIN_MS) {
+    fail("drift", "-400 ppm not clamped to the shortest interval");
+  }
+
+  // Near-perfect RTC: clamped to the longest interval
+  rtcDriftInit(drift);
+  rtcDriftWritten(drift, t0, 0);
+  rtcDriftUpdate(drift, 0, t0 + 12 * hourUs);
+  if (drift.syncIntervalMs != NTP_SYNC_INTERVAL_MAX_MS) {
+    fail("drift", "0 ppm not clamped to the longest interval");
+  }
+
+  // A hand-set time is no reference
+  rtcDriftForget(drift);
+  if (rtcDriftUpdate(drift, 50000, t0 + 24 * hourUs)) {
+    fail("drift", "sample taken after a hand-set time");
+  }
+  printf("ok   drift: average, clamps and rejected samples\n");
+}
+
+int main() {
+  checkRound();
+  checkDrift();
+
+  if (failures) {
+    printf("%d failure(s)\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""Open many /events subscribers against a clock and report what they get.
+
+Each client holds one Server-Sent Events connection for the test duration
+and counts "time" events. The summary shows how many subscribers were
+accepted, how many were turned away (503) and the per-client event rate,
+which should stay at ~1/s regardless of the client count.
+
+Usage:
+    tools/sse_load.py 192.168.1.50
+    tools/sse_load.py 192.168.1.50 --clients 20 --seconds 30
+"""
+
+import argparse
+import asyncio
+import time
+
+
+async def subscriber(host, port, seconds):
+    try:
+        reader, writer = await asyncio.wait_for(asyncio.open_connection(host, port), 5)
+    except (OSError, asyncio.TimeoutError):
+        return 'refused', 0, []
+    writer.write(b'GET /events HTTP/1.1\r\nHost: %s\r\nAccept: text/event-stream\r\n\r\n'
+                 % host.encode())
+    await writer.drain()
+
+    status = (await reader.readline()).decode(errors='replace').split()
+    if len(status) < 2 or status[1] != '200':
+        writer.close()
+        return status[1] if len(status) > 1 else 'closed', 0, []
+
+    events = 0
+    gaps = []
+    last = None
+    deadline = time.monotonic() + seconds
+    while time.monotonic() < deadline:
+        try:
+            line = await asyncio.wait_for(reader.readline(), max(0.1, deadline - time.monotonic()))
+        except asyncio.TimeoutError:
+            break
+        if not line:
+            break
+        if line.startswith(b'data:'):
+            now = time.monotonic()
+            if last is not None:
+                gaps.append(now - last)
+            last = now
+            events += 1
+    writer.close()
+    return '200', events, gaps
+
+
+async def run(args):
+    results = await asyncio.gather(*(subscriber(args.host, args.port, args.seconds)
+                                     for _ in range(args.clients)))
+    accepted = [r for r in results if r[0] == '200']
+    print('clients: %d  accepted: %d  rejected: %d'
+          % (args.clients, len(accepted), args.clients - len(accepted)))
+    for status in sorted(set(r[0] for r in results if r[0] != '200')):
+        print('  status %s: %d' % (status, sum(1 for r in results if r[0] == status)))
+    if accepted:
+        rates = [r[1] / args.seconds for r in accepted]
+        gaps = [g for r in accepted for g in r[2]]
+        print('events/s per client: min %.2f  avg %.2f  max %.2f'
+              % (min(rates), sum(rates) / len(rates), max(rates)))
+        if gaps:
+            print('max gap between events: %.0f ms' % (max(gaps) * 1000))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('host', help='clock IP address or hostname')
+    parser.add_argument('--port', type=int, default=80)
+    parser.add_argument('--clients', type=int, default=20)
+    parser.add_argument('--seconds', type=float, default=20)
+    asyncio.run(run(parser.parse_args()))
+
+
+if __name__ == '__main__':
+    main()
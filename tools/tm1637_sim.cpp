@@ -0,0 +1,307 @@
+// Host check for the TM1637 waveform encoder and both display backends.
+//
+// For a set of typical frames (power-on, colon blink, minute and hour
+// changes, brightness) and a few thousand random ones it:
+//   - encodes the flush with tm1637WaveFlush(), as both display classes do;
+//   - plays it through tm1637WavePlay(), the bit-bang backends' player, and
+//     records both lines at 1 us resolution;
+//   - packs it with tm1637WaveItems(), the RMT backend's packer, and expands
+//     the items back to 1 us samples as the peripheral would;
+//   - requires the two traces to match bit for bit;
+//   - decodes the trace as a TM1637 would (start/stop while CLK is high,
+//     data latched on CLK rising, ninth clock is ACK with DIO released) and
+//     compares the bytes with the transactions the protocol calls for;
+//   - checks that CLK and DIO never change in the same microsecond and that
+//     DIO only moves while CLK is low, outside start and stop;
+//   - checks that displays in a lockstep bank (same dirty digits, different
+//     data) share an identical CLK waveform, and prints the bus time per N.
+//
+// Build and run from the repository root:
+//   g++ -std=gnu++11 -O2 -Wall -Wextra -Isrc tools/tm1637_sim.cpp src/tm1637_wave.cpp -o tm1637_sim && ./tm1637_sim
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "tm1637_wave.h"
+
+typedef std::vector<uint8_t> Trace;  // One CLK | DIO sample per microsecond
+typedef std::vector<std::vector<uint8_t> > Transactions;
+
+static int failures = 0;
+
+static void fail(const char *name, const char *what) {
+  printf("FAIL %s: %s\n", name, what);
+  failures++;
+}
+
+// Bit-bang backend: each tick holds the lines for TM1637_TICK_US
+static void recordTick(uint16_t, uint8_t sample, uint8_t, void *arg) {
+  Trace &trace = *(Trace *)arg;
+  trace.insert(trace.end(), TM1637_TICK_US, sample);
+}
+
+static Trace playBitBang(const Tm1637Wave &wave) {
+  Trace trace;
+  tm1637WavePlay(wave, recordTick, &trace);
+  return trace;
+}
+
+// RMT backend: one line packed into items, replayed until the zero duration
+#define MAX_ITEMS 96
+
+static std::vector<uint32_t> packLine(const Tm1637Wave &wave, uint8_t line) {
+  std::vector<uint32_t> items(MAX_ITEMS);
+  items.resize(tm1637WaveItems(wave, line, items.data(), items.size()));
+  return items;
+}
+
+static std::vector<uint8_t> expandLine(const std::vector<uint32_t> &items) {
+  std::vector<uint8_t> levels;
+  for (size_t i = 0; i < items.size(); i++) {
+    if (TM1637_ITEM_DURATION0(items[i]) == 0) {
+      break;
+    }
+    levels.insert(levels.end(), TM1637_ITEM_DURATION0(items[i]),
+                  (uint8_t)TM1637_ITEM_LEVEL0(items[i]));
+    if (TM1637_ITEM_DURATION1(items[i]) == 0) {
+      break;
+    }
+    levels.insert(levels.end(), TM1637_ITEM_DURATION1(items[i]),
+                  (uint8_t)TM1637_ITEM_LEVEL1(items[i]));
+  }
+  return levels;
+}
+
+static Trace playRmt(const Tm1637Wave &wave) {
+  std::vector<uint8_t> clk = expandLine(packLine(wave, TM1637_WAVE_CLK));
+  std::vector<uint8_t> dio = expandLine(packLine(wave, TM1637_WAVE_DIO));
+  Trace trace;
+  if (clk.size() != dio.size()) {
+    return trace;
+  }
+  for (size_t i = 0; i < clk.size(); i++) {
+    trace.push_back((clk[i] ? TM1637_WAVE_CLK : 0) | (dio[i] ? TM1637_WAVE_DIO : 0));
+  }
+  return trace;
+}
+
+// TM1637 receiver model
+static bool decode(const Trace &trace, Transactions &out, const char *name) {
+  uint8_t prev = TM1637_WAVE_CLK | TM1637_WAVE_DIO;
+  bool inFrame = false;
+  int bit = 0;
+  uint8_t value = 0;
+  for (size_t i = 0; i < trace.size(); i++) {
+    uint8_t now = trace[i];
+    uint8_t changed = now ^ prev;
+    bool clkHigh = prev & TM1637_WAVE_CLK;
+    if (changed == (TM1637_WAVE_CLK | TM1637_WAVE_DIO)) {
+      fail(name, "CLK and DIO change together");
+      return false;
+    }
+    if ((changed & TM1637_WAVE_DIO) && clkHigh) {
+      if (now & TM1637_WAVE_DIO) {
+        // The stop's own clock reads as one low bit of a byte that never completes
+        if (!inFrame || bit != 1 || value != 0) {
+          fail(name, "stop outside a byte boundary");
+          return false;
+        }
+        inFrame = false;
+      } else {
+        if (inFrame) {
+          fail(name, "start inside a frame");
+          return false;
+        }
+        inFrame = true;
+        bit = 0;
+        value = 0;
+        out.push_back(std::vector<uint8_t>());
+      }
+    }
+    if ((changed & TM1637_WAVE_CLK) && (now & TM1637_WAVE_CLK)) {
+      if (!inFrame) {
+        fail(name, "clock outside a frame");
+        return false;
+      }
+      if (bit < 8) {
+        value |= ((now & TM1637_WAVE_DIO) ? 1 : 0) << bit;
+        bit++;
+      } else {
+        if (!(now & TM1637_WAVE_DIO)) {
+          fail(name, "DIO driven low in the ACK slot");
+          return false;
+        }
+        out.back().push_back(value);
+        bit = 0;
+        value = 0;
+      }
+    }
+    prev = now;
+  }
+  if (inFrame || prev != (TM1637_WAVE_CLK | TM1637_WAVE_DIO)) {
+    fail(name, "bus not idle at the end");
+    return false;
+  }
+  return true;
+}
+
+// What the chip should receive for a flush, from the datasheet: a
+// data-command plus address-and-data transaction per write, the burst for
+// three digits or more, then the display control command
+static Transactions expectedTransactions(const uint8_t digits[TM1637_DIGITS], uint8_t dirtyMask,
+                                         int brightness) {
+  Transactions expected;
+  int dirtyCount = __builtin_popcount(dirtyMask);
+  if (dirtyCount >= 3) {
+    expected.push_back(std::vector<uint8_t>(1, TM1637_CMD_DATA_AUTO));
+    std::vector<uint8_t> data(1, TM1637_CMD_ADDRESS);
+    for (int i = 0; i < TM1637_DIGITS; i++) {
+      data.push_back(digits[i]);
+    }
+    expected.push_back(data);
+  } else if (dirtyCount > 0) {
+    expected.push_back(std::vector<uint8_t>(1, TM1637_CMD_DATA_FIXED));
+    for (uint8_t i = 0; i < TM1637_DIGITS; i++) {
+      if (dirtyMask & (1 << i)) {
+        std::vector<uint8_t> data(1, TM1637_CMD_ADDRESS | i);
+        data.push_back(digits[i]);
+        expected.push_back(data);
+      }
+    }
+  }
+  if (brightness >= 0) {
+    expected.push_back(std::vector<uint8_t>(1, TM1637_CMD_DISPLAY_ON | brightness));
+  }
+  return expected;
+}
+
+static void check(const char *name, const uint8_t digits[TM1637_DIGITS], uint8_t dirtyMask, int brightness,
+                  bool verbose) {
+  Tm1637Wave wave;
+  uint8_t written = tm1637WaveFlush(wave, digits, dirtyMask, brightness);
+  Transactions expected = expectedTransactions(digits, dirtyMask, brightness);
+  if (wave.overflow) {
+    fail(name, "waveform overflow");
+    return;
+  }
+
+  Trace bitBang = playBitBang(wave);
+  Trace rmt = playRmt(wave);
+  if (bitBang.size() != rmt.size() || memcmp(bitBang.data(), rmt.data(), rmt.size()) != 0) {
+    fail(name, "bit-bang and RMT waveforms differ");
+    return;
+  }
+
+  Transactions decoded;
+  if (!decode(bitBang, decoded, name)) {
+    return;
+  }
+  if (decoded != expected) {
+    fail(name, "decoded bytes differ from the frame");
+    return;
+  }
+  int dirtyCount = __builtin_popcount(dirtyMask);
+  if (written != (dirtyCount >= 3 ? TM1637_DIGITS : dirtyCount)) {
+    fail(name, "wrong count of data bytes written");
+    return;
+  }
+
+  if (verbose) {
+    size_t items = packLine(wave, TM1637_WAVE_CLK).size() + packLine(wave, TM1637_WAVE_DIO).size();
+    printf("ok   %-18s %3u ticks %5u us %2u transactions %3u RMT items\n", name,
+           (unsigned)wave.length, (unsigned)bitBang.size(), (unsigned)decoded.size(),
+           (unsigned)items);
+  }
+}
+
+// Bank (lockstep) precondition: with a shared dirty mask, every display's
+// waveform has the same length and the same CLK samples, whatever the data
+static void checkBank(uint8_t displays, bool verbose) {
+  uint8_t digits[8][TM1637_DIGITS];
+  for (uint8_t d = 0; d < displays; d++) {
+    for (int i = 0; i < 4; i++) {
+      digits[d][i] = (uint8_t)rand();
+    }
+  }
+  uint8_t dirtyMask = (uint8_t)(rand() & 0x0F) | (verbose ? 0x0F : 0);
+  int brightness = verbose ? 7 : ((rand() & 1) ? rand() % 8 : -1);
+
+  Tm1637Wave first;
+  Tm1637Wave wave;
+  tm1637WaveFlush(first, digits[0], dirtyMask, brightness);
+  for (uint8_t d = 1; d < displays; d++) {
+    tm1637WaveFlush(wave, digits[d], dirtyMask, brightness);
+    if (wave.length != first.length) {
+      fail("bank", "waveform lengths differ");
+      return;
+    }
+    for (uint16_t t = 0; t < wave.length; t++) {
+      if ((wave.samples[t] ^ first.samples[t]) & TM1637_WAVE_CLK) {
+        fail("bank", "CLK differs between displays");
+        return;
+      }
+    }
+  }
+  if (verbose) {
+    unsigned frameUs = first.length * TM1637_TICK_US;
+    printf("ok   bank N=%u           full frame %5u us in lockstep, %5u us one by one\n",
+           (unsigned)displays, frameUs, frameUs * displays);
+  }
+}
+
+// Dirty mask: exactly the digits that changed, or all before the first flush
+static void checkDirtyMask(const uint8_t digits[TM1637_DIGITS]) {
+  uint8_t shown[TM1637_DIGITS];
+  uint8_t changed = (uint8_t)(rand() & 0x0F);
+  for (int i = 0; i < TM1637_DIGITS; i++) {
+    shown[i] = (changed & (1 << i)) ? (uint8_t)~digits[i] : digits[i];
+  }
+  if (tm1637DirtyMask(digits, shown, true) != changed) {
+    fail("dirty mask", "changed digits not flagged");
+  }
+  if (tm1637DirtyMask(digits, shown, false) != 0x0F) {
+    fail("dirty mask", "unknown contents not flagged in full");
+  }
+}
+
+int main() {
+  const uint8_t time1234[4] = {0x06, 0x5B | 0x80, 0x4F, 0x66};
+  const uint8_t time1234NoColon[4] = {0x06, 0x5B, 0x4F, 0x66};
+  const uint8_t blank[4] = {0, 0, 0, 0};
+  const uint8_t ones[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+
+  check("power-on", time1234, 0x0F, 7, true);
+  check("colon blink", time1234NoColon, 0x02, -1, true);
+  check("minute change", time1234, 0x0C, -1, true);
+  check("hour change", time1234, 0x0F, -1, true);
+  check("brightness only", time1234, 0x00, 3, true);
+  check("blank + dim", blank, 0x0F, 0, true);
+  check("all segments", ones, 0x0F, 7, true);
+
+  srand(1637);
+  for (int i = 0; i < 5000; i++) {
+    uint8_t digits[TM1637_DIGITS];
+    for (int d = 0; d < TM1637_DIGITS; d++) {
+      digits[d] = (uint8_t)rand();
+    }
+    checkDirtyMask(digits);
+    check("random", digits, (uint8_t)(rand() & 0x0F), (rand() & 1) ? rand() % 8 : -1, false);
+  }
+
+  for (uint8_t n = 1; n <= 8; n *= 2) {
+    checkBank(n, true);
+  }
+  for (int i = 0; i < 1000; i++) {
+    checkBank(1 + rand() % 8, false);
+  }
+
+  if (failures) {
+    printf("%d failure(s)\n", failures);
+    return 1;
+  }
+  printf("ok   5000 random frames\n");
+  return 0;
+}
@@ -0,0 +1,181 @@
+// Host check for the POSIX TZ converter (src/tz_engine.*) against glibc.
+//
+// Each zone is set both as the active zone and in a display slot, and as TZ
+// for glibc. Over 2020-2031 the local offset is compared every 15 minutes,
+// and every change glibc reports is located to the second and compared from
+// both sides, together with the DST flag and tzInfoAt()'s next transition.
+// A second pass converts random instants in random order, so the cached
+// window is also entered backwards and across years. The zones cover both
+// hemispheres, Mm.w.d, Jn and n rules, fractional offsets, and rule times
+// that are negative or past 24 h (which move the change to another day).
+//
+// Build and run from the repository root:
+//   g++ -std=gnu++11 -O2 -Wall -Itools/native/include -Isrc tools/tz_engine_test.cpp src/tz_engine.cpp -o tz_engine_test && ./tz_engine_test
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tz_engine.h"
+
+#define FIRST_UTC_S 1577836800LL  // 2020-01-01
+#define LAST_UTC_S 1956528000LL   // 2032-01-01
+#define STEP_S 900
+#define RANDOM_SAMPLES 20000
+
+static const char *const zones[] = {
+  "CET-1CEST,M3.5.0,M10.5.0/3",              // Europe
+  "EST5EDT,M3.2.0,M11.1.0",                  // North America
+  "AEST-10AEDT,M10.1.0,M4.1.0/3",            // Sydney, southern
+  "NZST-12NZDT,M9.5.0,M4.1.0/3",             // Auckland, southern
+  "<-04>4<-03>,M9.1.6/24,M4.1.6/24",         // Santiago: 24:00 on Saturday
+  "<-03>3<-02>,M3.5.0/-2,M10.5.0/-1",        // Nuuk: negative rule times
+  "IST-2IDT,M3.4.4/26,M10.5.0",              // Israel: 26:00 on Thursday
+  "<+1030>-10:30<+11>-11,M10.1.0,M4.1.0",    // Lord Howe: 30 min DST
+  "<+13>-13<+14>,M9.5.0/3,M4.1.0/4",         // Past UTC+12, southern
+  "<+02>-2<+03>,J60/2,J300/3",               // Jn: Feb 29 is never counted
+  "<-03>3<-02>,J280/0,J75/0",                // Jn, southern
+  "<+01>-1<+02>,59/2,299/3",                 // n: Feb 29 in leap years
+  "<-05>5<-04>,300/25,90/30",                // n, southern, past 24 h
+  "<+0545>-5:45",                            // Fixed, no DST
+  "IST-5:30",
+  "<-0930>9:30",
+};
+
+static const char *const invalid[] = {
+  "", "AB1", "CET", "CET-1CEST,M13.1.0,M10.5.0", "CET-1CEST,M3.5.7,M10.5.0",
+  "CET-1CEST,J0,J300", "CET-1CEST,366,10", "CET-1CEST,M3.5.0", "CET-25",
+};
+
+static int failures = 0;
+
+static void fail(const char *name, const char *what) {
+  printf("FAIL %s: %s\n", name, what);
+  failures++;
+}
+
+// Stand-ins for the FreeRTOS critical sections; the test is single-threaded
+void simEnterCritical(portMUX_TYPE *mux) {
+}
+
+void simExitCritical(portMUX_TYPE *mux) {
+}
+
+// glibc's view of a UTC second under the current TZ
+static long glibcOffsetS(long long utcS, bool *dst) {
+  time_t t = (time_t)utcS;
+  struct tm local;
+  localtime_r(&t, &local);
+  if (dst) {
+    *dst = local.tm_isdst > 0;
+  }
+  return local.tm_gmtoff;
+}
+
+// Compare both converters with glibc at a UTC instant; false on a mismatch
+static bool sameOffset(const char *zone, int64_t utcUs) {
+  long long utcS = utcUs / 1000000LL;
+  bool dst;
+  long want = glibcOffsetS(utcS, &dst);
+  long active = (long)((tzLocalUs(utcUs) - utcUs) / 1000000LL);
+  long slot = (long)((tzSlotLocalUs(0, utcUs) - utcUs) / 1000000LL);
+  TzInfo info;
+  tzInfoAt(utcUs, info);
+  if (active == want && slot == want && info.offsetS == want && info.dst == dst) {
+    return true;
+  }
+  time_t t = (time_t)utcS;
+  struct tm utc;
+  gmtime_r(&t, &utc);
+  char when[32];
+  strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &utc);
+  char what[160];
+  snprintf(what, sizeof(what), "at %s UTC glibc %+ld s%s, tzLocalUs %+ld s, slot %+ld s, "
+           "tzInfoAt %+ld s%s", when, want, dst ? " dst" : "", active, slot,
+           (long)info.offsetS, info.dst ? " dst" : "");
+  fail(zone, what);
+  return false;
+}
+
+static void checkZone(const char *zone) {
+  if (!tzSet(zone) || !tzSlotSet(0, zone)) {
+    fail(zone, "rejected");
+    return;
+  }
+  setenv("TZ", zone, 1);
+  tzset();
+
+  int transitions = 0;
+  int before = failures;
+  long long previousS = FIRST_UTC_S;
+  long previousOffset = glibcOffsetS(previousS, NULL);
+  for (long long s = FIRST_UTC_S + STEP_S; s <= LAST_UTC_S && failures - before < 5; s += STEP_S) {
+    long offset = glibcOffsetS(s, NULL);
+    if (!sameOffset(zone, s * 1000000LL + 500000)) {
+      previousS = s;
+      previousOffset = offset;
+      continue;
+    }
+    if (offset != previousOffset) {
+      // First second of the new offset
+      long long low = previousS;
+      long long high = s;
+      while (high - low > 1) {
+        long long mid = low + (high - low) / 2;
+        (glibcOffsetS(mid, NULL) == previousOffset ? low : high) = mid;
+      }
+      int64_t changeUs = high * 1000000LL;
+      TzInfo info;
+      tzInfoAt(changeUs - 1, info);
+      if (info.nextTransitionUs != changeUs) {
+        char what[96];
+        snprintf(what, sizeof(what), "next transition %lld s, glibc changes at %lld s",
+                 (long long)(info.nextTransitionUs / 1000000LL), high);
+        fail(zone, what);
+      }
+      sameOffset(zone, changeUs - 1);
+      sameOffset(zone, changeUs);
+      transitions++;
+    }
+    previousS = s;
+    previousOffset = offset;
+  }
+
+  // Random order: the cache is entered from both sides and across years
+  unsigned int seed = 1;
+  for (int i = 0; i < RANDOM_SAMPLES && failures - before < 5; i++) {
+    long long span = (LAST_UTC_S - FIRST_UTC_S) * 1000LL;
+    long long ms = (((long long)rand_r(&seed) << 31) | rand_r(&seed)) % span;
+    sameOffset(zone, (FIRST_UTC_S * 1000LL + ms) * 1000LL);
+  }
+
+  if (failures == before) {
+    printf("ok   %-40s %3d transitions\n", zone, transitions);
+  }
+}
+
+static void checkInvalid() {
+  int before = failures;
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+    if (tzValid(invalid[i])) {
+      fail(invalid[i], "accepted");
+    }
+  }
+  if (failures == before) {
+    printf("ok   %u malformed zones rejected\n", (unsigned)(sizeof(invalid) / sizeof(invalid[0])));
+  }
+}
+
+int main() {
+  for (size_t i = 0; i < sizeof(zones) / sizeof(zones[0]); i++) {
+    checkZone(zones[i]);
+  }
+  checkInvalid();
+
+  if (failures) {
+    printf("%d failure(s)\n", failures);
+    return 1;
+  }
+  return 0;
+}